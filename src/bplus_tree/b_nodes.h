@@ -7,8 +7,59 @@
 
 #pragma once
 
+#include "key_search.h"
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @brief Layout of the search index of an indexed inner node. Every level holds the largest key of each block of block_size entries of the level below,
+ * level 0 are the keys themselves. The levels are stored behind the keys in the key array, from the lowest to the highest one with at most one block
+ */
+struct BIndexLayout
+{
+    /// entries of a block, one cache line of keys
+    static constexpr int block_size = 8;
+    /// log2 of block_size
+    static constexpr int block_shift = 3;
+
+    /// maximum number of keys of the node
+    int capacity = 0;
+    /// number of levels above the keys
+    int levels = 0;
+    /// position of every level in the key array
+    int offsets[8] = {};
+
+    /**
+     * @brief Computes the layout that fits the most keys together with their index into an array
+     * @param array_size The number of entries of the key array
+     * @return the layout
+     */
+    static constexpr BIndexLayout compute(int array_size)
+    {
+        BIndexLayout layout;
+        for (int capacity = array_size - 1; capacity > 0; capacity--)
+        {
+            layout = BIndexLayout();
+            layout.capacity = capacity;
+            int size = capacity;
+            int offset = capacity;
+            while (size > block_size)
+            {
+                size = (size + block_size - 1) / block_size;
+                layout.levels++;
+                layout.offsets[layout.levels] = offset;
+                offset += size;
+            }
+            if (offset <= array_size)
+                break;
+        }
+        return layout;
+    }
+};
+
 /**
- * @brief Structure for the inner node
+ * @brief Structure for the inner node. An indexed inner node keeps fewer keys and uses the rest of the key array for a search index, see BIndexLayout.
+ * A search then reads one block per level instead of jumping through the whole array
  */
 template <int PAGE_SIZE>
 struct BInnerNode
@@ -21,42 +72,81 @@ struct BInnerNode
     // 4 bytes - size of keys, not child ids
     /// maximum capacity of node
     int max_size;
-    // 4 bytes padding to make it the same size as outer node
-    char padding[8];
+    // 1 byte
+    /// if the keys are followed by a search index
+    bool indexed;
+    // 7 bytes padding to make it the same size as outer node
+    char padding[7];
 
     int64_t keys[((PAGE_SIZE - 32) / 2) / 8];
     uint64_t child_ids[((PAGE_SIZE - 32) / 2) / 8];
 
+    /// layout of the search index of an indexed node
+    static constexpr BIndexLayout index_layout = BIndexLayout::compute(((PAGE_SIZE - 32) / 2) / 8);
+
     /**
      * @brief Constructor for the inner node
+     * @param indexed_arg If the keys are followed by a search index
      */
-    BInnerNode()
+    BInnerNode(bool indexed_arg = false)
     {
         header.inner = true;
         current_index = 0;
-        max_size = ((PAGE_SIZE - 32) / 2) / 8 - 1;
+        indexed = indexed_arg;
+        max_size = indexed_arg ? index_layout.capacity : ((PAGE_SIZE - 32) / 2) / 8 - 1;
         assert(max_size > 2 && "Node size is too small");
     }
 
     /**
-     * @brief Searches through the tree with binary search
+     * @brief Writes the search index of an indexed node again, has to be called after the keys were changed
+     */
+    void update_index()
+    {
+        if (!indexed)
+            return;
+        for (int level = 1; level <= index_layout.levels; level++)
+        {
+            int span = 1 << (BIndexLayout::block_shift * level);
+            int entries = (current_index + span - 1) / span;
+            for (int i = 0; i < entries; i++)
+            {
+                keys[index_layout.offsets[level] + i] = keys[std::min((i + 1) * span, current_index) - 1];
+            }
+        }
+    }
+
+    /**
+     * @brief Searches through the search index from the highest level down, every level narrows the search to one block of the level below
      * @param key the key to look for
      * @return the index of the key
      */
-    int binary_search(int64_t key)
+    int indexed_search(int64_t key)
     {
-        int left = 0, right = current_index;
-
-        while (left < right)
+        int block = 0;
+        for (int level = index_layout.levels; level > 0; level--)
         {
-            int middle = left + (right - left) / 2;
-
-            if (keys[middle] < key)
-                left = middle + 1;
-            else
-                right = middle;
+            // the entries of the level that cover the current keys, a key larger than all of them leads past the end
+            int span = 1 << (BIndexLayout::block_shift * level);
+            int entries = (current_index + span - 1) / span;
+            int start = block * BIndexLayout::block_size;
+            int count = std::max(0, std::min(BIndexLayout::block_size, entries - start));
+            block = start + KeySearch::count_smaller(keys + index_layout.offsets[level] + std::min(start, entries), count, key);
         }
-        return left;
+        int start = std::min(block * BIndexLayout::block_size, current_index);
+        int count = std::min(BIndexLayout::block_size, current_index - start);
+        return start + KeySearch::count_smaller(keys + start, count, key);
+    }
+
+    /**
+     * @brief Searches through the tree with binary search
+     * @param key the key to look for
+     * @return the index of the key
+     */
+    int binary_search(int64_t key)
+    {
+        if (indexed)
+            return indexed_search(key);
+        return KeySearch::lower_bound(keys, current_index, key);
     }
 
     /**
@@ -93,6 +183,7 @@ struct BInnerNode
         keys[index] = key;
         child_ids[index + 1] = child_id;
         current_index++;
+        update_index();
     }
 
     /**
@@ -112,6 +203,7 @@ struct BInnerNode
         keys[0] = key;
         child_ids[0] = child_id;
         current_index++;
+        update_index();
     }
 
     /**
@@ -131,6 +223,7 @@ struct BInnerNode
                 child_ids[i] = child_ids[i + 1];
             }
             current_index--;
+            update_index();
         }
     }
 
@@ -146,6 +239,7 @@ struct BInnerNode
         }
         child_ids[current_index - 1] = child_ids[current_index];
         current_index--;
+        update_index();
     }
 
     /**
@@ -168,6 +262,7 @@ struct BInnerNode
     {
         int index = binary_search(key);
         keys[index] = exchange_key;
+        update_index();
     }
 
     /**
@@ -199,7 +294,8 @@ struct BInnerNode
 };
 
 /**
- * @brief Structure for the outer node
+ * @brief Structure for the outer node. A packed outer node stores its keys as differences to its smallest key in as few bytes as the largest difference needs, so more entries fit if the keys are close together.
+ * Its smallest key and the width are kept in front of the keys, the values are stored from the end of the node backwards, so they stay in place when the width changes
  */
 template <int PAGE_SIZE>
 struct BOuterNode
@@ -210,7 +306,7 @@ struct BOuterNode
     /// info about current capacity of node
     int current_index;
     // 4 bytes
-    /// maximum capacity of node
+    /// maximum capacity of node, a packed node holds at least this many entries
     int max_size;
     // 8 bytes
     /// Id of next outer leaf
@@ -219,16 +315,161 @@ struct BOuterNode
     int64_t keys[((PAGE_SIZE - 32) / 2) / 8];
     int64_t values[((PAGE_SIZE - 32) / 2) / 8];
 
+    /// number of entries in the arrays of a node that is not packed
+    static constexpr int array_size = ((PAGE_SIZE - 32) / 2) / 8;
+
+    /// bytes a packed node uses for its smallest key and the width in front of the keys
+    static constexpr int packed_prefix = 16;
+
+    /// bytes a packed node has for its keys and values
+    static constexpr int packed_size = 2 * array_size * 8 - packed_prefix;
+
     /**
      * @brief Constructor for the outer node
+     * @param packed_arg If the keys are packed
      */
-    BOuterNode()
+    BOuterNode(bool packed_arg = false)
     {
         header.inner = false;
+        header.packed = packed_arg;
         current_index = 0;
-        max_size = ((PAGE_SIZE - 32) / 2) / 8;
+        // with the widest keys every entry takes as much space as in a node that is not packed
+        max_size = packed_arg ? packed_size / 16 : array_size;
         assert(max_size > 2 && "Node size is too small");
         next_lef_id = 0;
+        if (packed_arg)
+        {
+            keys[0] = 0;
+            keys[1] = 0;
+        }
+    }
+
+    /**
+     * @brief Returns the number of bytes a difference between two keys needs
+     * @param difference The difference
+     * @return the number of bytes, 0 if the difference is 0
+     */
+    static int get_width(uint64_t difference)
+    {
+        return difference == 0 ? 0 : (64 - __builtin_clzll(difference) + 7) / 8;
+    }
+
+    /**
+     * @brief Returns the number of entries a packed node holds with keys of a width. The number is bounded, so both halves of a split node take one more entry with the widest keys
+     * @param width The width of the keys in bytes
+     * @return the number of entries
+     */
+    int get_capacity(int width)
+    {
+        return std::min(packed_size / (width + 8), 2 * max_size - 2);
+    }
+
+    /**
+     * @brief Returns the smallest key of a packed node, all keys are stored as differences to it
+     * @return the base key
+     */
+    int64_t &get_base()
+    {
+        return keys[0];
+    }
+
+    /**
+     * @brief Returns the number of bytes of a key in a packed node
+     * @return the width
+     */
+    uint8_t &get_key_width()
+    {
+        return *reinterpret_cast<uint8_t *>(&keys[1]);
+    }
+
+    /**
+     * @brief Returns the difference of a key in a packed node to the base key. The key is read with one unaligned 8 byte load and a mask, the values behind the keys make sure the load stays inside the node
+     * @param index The index of the key
+     * @param width The width of the keys
+     * @return the difference
+     */
+    uint64_t get_difference(int index, int width)
+    {
+        uint64_t difference;
+        std::memcpy(&difference, reinterpret_cast<char *>(keys) + packed_prefix + index * width, 8);
+        return width == 8 ? difference : difference & ((uint64_t(1) << (8 * width)) - 1);
+    }
+
+    /**
+     * @brief Writes the difference of a key in a packed node to the base key
+     * @param index The index of the key
+     * @param width The width of the keys
+     * @param difference The difference
+     */
+    void set_difference(int index, int width, uint64_t difference)
+    {
+        std::memcpy(reinterpret_cast<char *>(keys) + packed_prefix + index * width, &difference, width);
+    }
+
+    /**
+     * @brief Returns the value at an index in a packed node, value i is the i-th one from the end of the node
+     * @param index The index of the value
+     * @return the value
+     */
+    int64_t &get_packed_value(int index)
+    {
+        return values[array_size - 1 - index];
+    }
+
+    /**
+     * @brief Writes all keys of a packed node again with a new base key and width
+     * @param base The new base key, smaller or equal to all keys
+     * @param width The new width, large enough for all differences
+     */
+    void repack(int64_t base, int width)
+    {
+        uint64_t old_keys[2 * array_size];
+        for (int i = 0; i < current_index; i++)
+        {
+            old_keys[i] = get_key(i);
+        }
+        get_base() = base;
+        get_key_width() = width;
+        for (int i = 0; i < current_index; i++)
+        {
+            set_difference(i, width, old_keys[i] - static_cast<uint64_t>(base));
+        }
+    }
+
+    /**
+     * @brief Returns the width the keys of a packed node need to take a key
+     * @param key The key
+     * @return the width
+     */
+    int get_width_with(int64_t key)
+    {
+        if (current_index == 0)
+            return 0;
+        int64_t base = std::min(get_base(), key);
+        int64_t largest = std::max(get_key(current_index - 1), key);
+        return std::max<int>(get_width(static_cast<uint64_t>(largest) - static_cast<uint64_t>(base)), key >= get_base() ? get_key_width() : 0);
+    }
+
+    /**
+     * @brief Returns the key at an index
+     * @param index The index of the key
+     * @return the key
+     */
+    int64_t get_key(int index)
+    {
+        if (!header.packed)
+            return keys[index];
+        return static_cast<int64_t>(static_cast<uint64_t>(get_base()) + get_difference(index, get_key_width()));
+    }
+
+    /**
+     * @brief Returns the value at an index
+     * @param index The index of the value
+     * @return the value
+     */
+    int64_t get_value_at(int index)
+    {
+        return header.packed ? get_packed_value(index) : values[index];
     }
 
     /**
@@ -239,17 +480,25 @@ struct BOuterNode
     int binary_search(int64_t key)
     {
         int left = 0, right = current_index;
-
-        while (left < right)
+        if (header.packed)
         {
-            int middle = left + (right - left) / 2;
-
-            if (keys[middle] < key)
-                left = middle + 1;
-            else
-                right = middle;
+            // all keys are at least the base key, so the differences are compared without decoding the keys
+            if (current_index == 0 || key < get_base())
+                return 0;
+            uint64_t difference = static_cast<uint64_t>(key) - static_cast<uint64_t>(get_base());
+            int width = get_key_width();
+            // branchless, the differences before left are smaller than the difference, the ones from left + count on are not
+            int count = current_index;
+            while (count > 1)
+            {
+                int half = count / 2;
+                left = get_difference(left + half, width) < difference ? left + half : left;
+                count -= half;
+            }
+            return left + (get_difference(left, width) < difference);
         }
-        return left;
+
+        return KeySearch::lower_bound(keys, right, key);
     }
 
     /**
@@ -259,7 +508,31 @@ struct BOuterNode
      */
     void insert(int64_t key, int64_t value)
     {
-        assert(!is_full() && "Inserting into outer node when its full.");
+        assert(!is_full(key) && "Inserting into outer node when its full.");
+        if (header.packed)
+        {
+            if (current_index == 0)
+            {
+                get_base() = key;
+                get_key_width() = 0;
+            }
+            else if (key < get_base() || get_width_with(key) > get_key_width())
+            {
+                repack(std::min(get_base(), key), get_width_with(key));
+            }
+            int index = binary_search(key);
+            int width = get_key_width();
+            char *position = reinterpret_cast<char *>(keys) + packed_prefix + index * width;
+            std::memmove(position + width, position, (current_index - index) * width);
+            set_difference(index, width, static_cast<uint64_t>(key) - static_cast<uint64_t>(get_base()));
+            // the values behind the index move one place towards the start of the node
+            int64_t *last_value = values + array_size - current_index;
+            std::memmove(last_value - 1, last_value, (current_index - index) * sizeof(int64_t));
+            get_packed_value(index) = value;
+            current_index++;
+            return;
+        }
+
         // find index where to insert
         int index = binary_search(key);
 
@@ -285,9 +558,12 @@ struct BOuterNode
     {
         int index = binary_search(key);
 
-        if (index != current_index && keys[index] == key)
+        if (index != current_index && get_key(index) == key)
         {
-            values[index] = value;
+            if (header.packed)
+                get_packed_value(index) = value;
+            else
+                values[index] = value;
         }
     }
 
@@ -299,8 +575,19 @@ struct BOuterNode
     {
         int index = binary_search(key);
 
-        if (index != current_index && keys[index] == key)
+        if (index != current_index && get_key(index) == key)
         {
+            if (header.packed)
+            {
+                // the base key stays, it is still smaller than all keys
+                int width = get_key_width();
+                char *position = reinterpret_cast<char *>(keys) + packed_prefix + index * width;
+                std::memmove(position, position + width, (current_index - index - 1) * width);
+                int64_t *last_value = values + array_size - current_index;
+                std::memmove(last_value + 1, last_value, (current_index - index - 1) * sizeof(int64_t));
+                current_index--;
+                return;
+            }
             for (int i = index + 1; i < current_index; i++)
             {
                 keys[i - 1] = keys[i];
@@ -318,23 +605,57 @@ struct BOuterNode
     {
         int index = binary_search(key);
 
-        if (index != current_index && keys[index] == key)
+        if (index != current_index && get_key(index) == key)
         {
-            return values[index];
+            return get_value_at(index);
         }
 
         return INT64_MIN;
     }
 
+    /**
+     * @brief Keeps the first entries and clears the others, so the free part of the node compresses to almost nothing in the data file. A packed node gets the smallest width for the remaining keys
+     * @param count The number of entries that are kept
+     */
+    void truncate(int count)
+    {
+        if (!header.packed)
+        {
+            std::fill(keys + count, keys + array_size, 0);
+            std::fill(values + count, values + array_size, 0);
+            current_index = count;
+            return;
+        }
+        current_index = count;
+        if (count > 0)
+            repack(get_key(0), get_width(static_cast<uint64_t>(get_key(count - 1)) - static_cast<uint64_t>(get_key(0))));
+        char *free_start = reinterpret_cast<char *>(keys) + packed_prefix + count * get_key_width();
+        std::memset(free_start, 0, reinterpret_cast<char *>(values + array_size - count) - free_start);
+    }
+
     /**
      * @brief Checks if the node is full
      * @return true if it is false if it is not full
      */
     bool is_full()
     {
+        if (header.packed)
+            return current_index >= get_capacity(get_key_width());
         return current_index >= max_size;
     }
 
+    /**
+     * @brief Checks if the node is full for a key, a packed node might need wider keys to take it
+     * @param key The key that should be inserted
+     * @return true if it is full, false if the key fits
+     */
+    bool is_full(int64_t key)
+    {
+        if (header.packed)
+            return current_index >= get_capacity(get_width_with(key));
+        return is_full();
+    }
+
     /**
      * @brief Checks if you can delete from the node
      * @return true if an element can be deleted, false if not
@@ -10,10 +10,16 @@
 #include "../data/buffer_manager.h"
 #include "../radix_tree/radix_tree.h"
 #include "b_nodes.h"
+#include "tree_latch.h"
 #include <array>
+#include <algorithm>
 #include <math.h>
+#include <cmath>
 #include <iostream>
 #include <cassert>
+#include <functional>
+#include <thread>
+#include <vector>
 #include "spdlog/spdlog.h"
 #include "../utils/tree_operations.h"
 
@@ -37,6 +43,12 @@ private:
     /// root of tree
     uint64_t root_id = 0;
 
+    /// taken shared by operations that read or change single leaves, changes of the structure of the tree take it exclusively
+    TreeLatch latch;
+
+    /// if new roots and the inner nodes of a bulk load carry a search index, split nodes keep the layout of the node they are split from
+    bool indexed_inner_nodes = false;
+
     /**
      * @brief Inserts recursively into the tree
      * @param header The header of the current node
@@ -50,18 +62,18 @@ private:
             // outer node
             BOuterNode<PAGE_SIZE> *node = (BOuterNode<PAGE_SIZE> *)header;
             // case where the tree only has one outer node
-            if (root_id == node->header.page_id && node->is_full())
+            if (root_id == node->header.page_id && node->is_full(key))
             {
                 // only when outer leaf is full, otherwise we will split node before
-                // split outer node and save key
-                int split_index = get_split_index(node->max_size);
+                // split outer node and save key, a packed node can hold more than max_size entries
+                int split_index = get_split_index(node->current_index);
                 // Because the node size has a lower limit, this does not cause issues
-                int64_t split_key = node->keys[split_index - 1];
+                int64_t split_key = node->get_key(split_index - 1);
                 uint64_t new_outer_id = split_outer_node(header, split_index);
 
                 // create new inner node for root
                 BHeader *new_root_node_address = buffer_manager->create_new_page();
-                BInnerNode<PAGE_SIZE> *new_root_node = new (new_root_node_address) BInnerNode<PAGE_SIZE>();
+                BInnerNode<PAGE_SIZE> *new_root_node = new (new_root_node_address) BInnerNode<PAGE_SIZE>(indexed_inner_nodes);
 
                 new_root_node->child_ids[0] = node->header.page_id;
                 new_root_node->insert(split_key, new_outer_id);
@@ -97,9 +109,9 @@ private:
                 int64_t split_key = node->keys[split_index - 1];
                 uint64_t new_inner_id = split_inner_node(header, split_index);
 
-                // create new inner node for root
+                // create new inner node for root, with the layout of the old root
                 BHeader *new_root_node_address = buffer_manager->create_new_page();
-                BInnerNode<PAGE_SIZE> *new_root_node = new (new_root_node_address) BInnerNode<PAGE_SIZE>();
+                BInnerNode<PAGE_SIZE> *new_root_node = new (new_root_node_address) BInnerNode<PAGE_SIZE>(node->indexed);
 
                 new_root_node->child_ids[0] = node->header.page_id;
                 new_root_node->insert(split_key, new_inner_id);
@@ -153,12 +165,12 @@ private:
                 {
                     BOuterNode<PAGE_SIZE> *child = (BOuterNode<PAGE_SIZE> *)child_header;
 
-                    if (child->is_full())
+                    if (child->is_full(key))
                     {
                         // split the outer node
-                        int split_index = get_split_index(child->max_size);
+                        int split_index = get_split_index(child->current_index);
                         // Because the node size has a lower limit, this does not cause issues
-                        int64_t split_key = child->keys[split_index - 1];
+                        int64_t split_key = child->get_key(split_index - 1);
                         uint64_t new_outer_id = split_outer_node(child_header, split_index);
 
                         // Insert new child and then call function again
@@ -213,7 +225,7 @@ private:
                 root_id = node->child_ids[0];
                 buffer_manager->unfix_page(header->page_id, false);
                 buffer_manager->delete_page(header->page_id);
-                delete_value(key);
+                recursive_delete(buffer_manager->request_page(root_id), key);
             }
             else
             {
@@ -310,31 +322,20 @@ private:
     }
 
     /**
-     * @brief Get the value to a key recursively
-     * @param header The header of the current node
-     * @param key The key corresponding to the value
+     * @brief Descends to the leaf that holds a key. The inner nodes only change under the exclusive latch, so under the shared latch they are read without checking their versions
+     * @param key The key
+     * @return the fixed leaf
      */
-    int64_t recursive_get_value(BHeader *header, int64_t key)
+    BHeader *find_leaf(int64_t key)
     {
-        if (!header->inner)
+        BHeader *header = buffer_manager->request_page(root_id);
+        while (header->inner)
         {
-            BOuterNode<PAGE_SIZE> *node = (BOuterNode<PAGE_SIZE> *)header;
-            int64_t value = node->get_value(key);
-            if (cache)
-            {
-                if (value != INT64_MIN)
-                    cache->insert(key, header->page_id, header);
-            }
-            buffer_manager->unfix_page(header->page_id, false);
-            return value;
-        }
-        else
-        {
-            BInnerNode<PAGE_SIZE> *node = (BInnerNode<PAGE_SIZE> *)header;
-            BHeader *child_header = buffer_manager->request_page(node->next_page(key));
+            BHeader *child_header = buffer_manager->request_page(((BInnerNode<PAGE_SIZE> *)header)->next_page(key));
             buffer_manager->unfix_page(header->page_id, false);
-            return recursive_get_value(child_header, key);
+            header = child_header;
         }
+        return header;
     }
 
     /**
@@ -348,23 +349,24 @@ private:
         assert(!header->inner && "Splitting node which is not an outer node");
 
         BOuterNode<PAGE_SIZE> *node = (BOuterNode<PAGE_SIZE> *)header;
-        assert(index_to_split < node->max_size && "Splitting at an index which is bigger than the size");
+        assert(index_to_split < node->current_index && "Splitting at an index which is bigger than the size");
 
-        // Create new outer node
+        // Create new outer node, it keeps the layout of the node that is split
         BHeader *new_header = buffer_manager->create_new_page();
-        BOuterNode<PAGE_SIZE> *new_outer_node = new (new_header) BOuterNode<PAGE_SIZE>();
+        BOuterNode<PAGE_SIZE> *new_outer_node = new (new_header) BOuterNode<PAGE_SIZE>(node->header.packed);
 
         // It is important that index_to_split is already increases by 2
         if (cache)
         {
-            cache->update_range(node->keys[index_to_split], node->keys[node->current_index - 1], new_header->page_id, new_header);
+            cache->update_range(node->get_key(index_to_split), node->get_key(node->current_index - 1), new_header->page_id, new_header);
         }
 
-        for (int i = index_to_split; i < node->max_size; i++)
+        for (int i = index_to_split; i < node->current_index; i++)
         {
-            new_outer_node->insert(node->keys[i], node->values[i]);
-            node->current_index--;
+            new_outer_node->insert(node->get_key(i), node->get_value_at(i));
         }
+        // the moved entries are cleared, so the free half of the node compresses to almost nothing in the data file
+        node->truncate(index_to_split);
 
         // set correct chaining
         u_int64_t next_temp = node->next_lef_id;
@@ -389,9 +391,9 @@ private:
         BInnerNode<PAGE_SIZE> *node = (BInnerNode<PAGE_SIZE> *)header;
         assert(index_to_split < node->max_size && "Splitting at an index which is bigger than the size");
 
-        // Create new inner node
+        // Create new inner node, with the layout of the node it is split from
         BHeader *new_header = buffer_manager->create_new_page();
-        BInnerNode<PAGE_SIZE> *new_inner_node = new (new_header) BInnerNode<PAGE_SIZE>();
+        BInnerNode<PAGE_SIZE> *new_inner_node = new (new_header) BInnerNode<PAGE_SIZE>(node->indexed);
 
         new_inner_node->child_ids[0] = node->child_ids[index_to_split];
         for (int i = index_to_split; i < node->max_size; i++)
@@ -400,6 +402,9 @@ private:
             node->current_index--;
         }
         node->current_index--;
+        std::fill(node->keys + node->current_index, node->keys + node->max_size, 0);
+        std::fill(node->child_ids + node->current_index + 1, node->child_ids + node->max_size + 1, 0);
+        node->update_index();
 
         // unfixing the new page as we finished writing
         buffer_manager->unfix_page(new_header->page_id, true);
@@ -447,6 +452,7 @@ private:
                         {
                             child->insert_first(node->keys[index - 1], substitute->child_ids[substitute->current_index]);
                             node->keys[index - 1] = substitute->keys[substitute->current_index - 1];
+                            node->update_index();
 
                             substitute->delete_value(substitute->keys[substitute->current_index - 1]);
                             buffer_manager->unfix_page(node->child_ids[index - 1], true);
@@ -465,6 +471,7 @@ private:
                         {
                             child->insert(node->keys[index], substitute->child_ids[0]);
                             node->keys[index] = substitute->keys[0];
+                            node->update_index();
                             substitute->delete_first_pair();
                             buffer_manager->unfix_page(node->child_ids[index + 1], true);
                             return true;
@@ -496,11 +503,12 @@ private:
                         if (substitute->can_delete())
                         {
                             // save biggest key and value from left in right node
-                            child->insert(substitute->keys[substitute->current_index - 1], substitute->values[substitute->current_index - 1]);
+                            child->insert(substitute->get_key(substitute->current_index - 1), substitute->get_value_at(substitute->current_index - 1));
                             if (cache)
-                                cache->insert(substitute->keys[substitute->current_index - 1], child_header->page_id, child_header);
-                            substitute->delete_value(substitute->keys[substitute->current_index - 1]);
-                            node->keys[index - 1] = substitute->keys[substitute->current_index - 1];
+                                cache->insert(substitute->get_key(substitute->current_index - 1), child_header->page_id, child_header);
+                            substitute->delete_value(substitute->get_key(substitute->current_index - 1));
+                            node->keys[index - 1] = substitute->get_key(substitute->current_index - 1);
+                            node->update_index();
 
                             // unfix
                             buffer_manager->unfix_page(node->child_ids[index - 1], true);
@@ -519,11 +527,12 @@ private:
                         if (substitute->can_delete())
                         {
                             // save biggest key and value from right to left
-                            child->insert(substitute->keys[0], substitute->values[0]);
+                            child->insert(substitute->get_key(0), substitute->get_value_at(0));
                             if (cache)
-                                cache->insert(substitute->keys[0], child_header->page_id, child_header);
-                            node->keys[index] = substitute->keys[0];
-                            substitute->delete_value(substitute->keys[0]);
+                                cache->insert(substitute->get_key(0), child_header->page_id, child_header);
+                            node->keys[index] = substitute->get_key(0);
+                            node->update_index();
+                            substitute->delete_value(substitute->get_key(0));
 
                             // unfix
                             buffer_manager->unfix_page(node->child_ids[index + 1], true);
@@ -639,12 +648,12 @@ private:
                             // add all from right node to left node
                             if (cache)
                             {
-                                cache->update_range(child->keys[0], child->keys[child->current_index - 1], merge_header->page_id, merge_header);
+                                cache->update_range(child->get_key(0), child->get_key(child->current_index - 1), merge_header->page_id, merge_header);
                             }
 
                             for (int i = 0; i < child->current_index; i++)
                             {
-                                merge->insert(child->keys[i], child->values[i]);
+                                merge->insert(child->get_key(i), child->get_value_at(i));
                             }
 
                             merge->next_lef_id = child->next_lef_id;
@@ -671,12 +680,12 @@ private:
                             // add all from right node to left node
                             if (cache)
                             {
-                                cache->update_range(merge->keys[0], merge->keys[merge->current_index - 1], child_header->page_id, child_header);
+                                cache->update_range(merge->get_key(0), merge->get_key(merge->current_index - 1), child_header->page_id, child_header);
                             }
 
                             for (int i = 0; i < merge->current_index; i++)
                             {
-                                child->insert(merge->keys[i], merge->values[i]);
+                                child->insert(merge->get_key(i), merge->get_value_at(i));
                             }
 
                             child->next_lef_id = merge->next_lef_id;
@@ -711,7 +720,7 @@ private:
         {
             BOuterNode<PAGE_SIZE> *node = (BOuterNode<PAGE_SIZE> *)header;
             // last one is still the key that will be deleted
-            int64_t key = node->keys[node->current_index - 2];
+            int64_t key = node->get_key(node->current_index - 2);
             buffer_manager->unfix_page(header->page_id, false);
             return key;
         }
@@ -725,52 +734,157 @@ private:
     }
 
     /**
-     * @brief Update the value for a key recursively
+     * @brief Start at element key and get range consecutive elements
      * @param header The pointer to the current node
      * @param key The key corresponding to a value
-     * @param value The value corresponding to the key
+     * @param range The number of elements that are scanned
+     * @return The sum of the elements
      */
-    void update_recursive(BHeader *header, int64_t key, int64_t value)
+    int64_t scan_recursive(BHeader *header, int64_t key, int range)
     {
         if (!header->inner)
         {
-            BOuterNode<PAGE_SIZE> *node = (BOuterNode<PAGE_SIZE> *)header;
-            node->update(key, value);
-            if (cache)
-            {
-                cache->insert(key, header->page_id, header);
-            }
-            buffer_manager->unfix_page(node->header.page_id, true);
+            return TreeOperations::scan<PAGE_SIZE>(buffer_manager, cache, header, key, range);
         }
         else
         {
             BInnerNode<PAGE_SIZE> *node = (BInnerNode<PAGE_SIZE> *)header;
-            BHeader *child_header = buffer_manager->request_page(node->next_page(key));
+            int child_index = node->binary_search(key);
+            BHeader *child_header = buffer_manager->request_page(node->child_ids[child_index]);
+            if (!child_header->inner)
+            {
+                // the scan continues in the right siblings of the leaf, they can be read ahead without walking the leaf chain
+                int leaf_capacity = ((BOuterNode<PAGE_SIZE> *)child_header)->max_size;
+                int last_child_index = std::min(node->current_index, child_index + range / leaf_capacity + 1);
+                for (int i = child_index + 1; i <= last_child_index; i++)
+                {
+                    buffer_manager->prefetch_page(node->child_ids[i]);
+                }
+            }
             buffer_manager->unfix_page(header->page_id, false);
-            update_recursive(child_header, key, value);
+            return scan_recursive(child_header, key, range);
         }
     }
 
     /**
-     * @brief Start at element key and get range consecutive elements
-     * @param header The pointer to the current node
-     * @param key The key corresponding to a value
-     * @param range The number of elements that are scanned
-     * @return The sum of the elements
+     * @brief Moves the nodes below a node and the node itself into the lowest free pages, children before their parent
+     * @param page_id The page id of the current node
+     * @param previous_leaf_id The page id of the last leaf that was visited, 0 before the first one
+     * @param on_relocation Called after a node was moved and the reference to it was updated, the tree is consistent at that point
+     * @return the page id of the node after it was moved
      */
-    int64_t scan_recursive(BHeader *header, int64_t key, int range)
+    uint64_t compact_recursive(uint64_t page_id, uint64_t &previous_leaf_id, const std::function<void()> &on_relocation)
     {
-        if (!header->inner)
+        BHeader *header = buffer_manager->request_page(page_id);
+        bool inner = header->inner;
+        for (int i = 0; inner; i++)
         {
-            return TreeOperations::scan<PAGE_SIZE>(buffer_manager, cache, header, key, range);
+            BInnerNode<PAGE_SIZE> *node = (BInnerNode<PAGE_SIZE> *)header;
+            if (i > node->current_index)
+                break;
+            // the node is released while its children are visited, so only a few pages are fixed at any time
+            uint64_t child_id = node->child_ids[i];
+            buffer_manager->unfix_page(page_id, false);
+            uint64_t new_child_id = compact_recursive(child_id, previous_leaf_id, on_relocation);
+            header = buffer_manager->request_page(page_id);
+            if (new_child_id != child_id)
+            {
+                ((BInnerNode<PAGE_SIZE> *)header)->child_ids[i] = new_child_id;
+                buffer_manager->unfix_page(page_id, true);
+                if (on_relocation)
+                    on_relocation();
+                header = buffer_manager->request_page(page_id);
+            }
+        }
+
+        if (buffer_manager->peek_unused_page_id() < page_id)
+        {
+            // the node is copied into a page closer to the start of the file, the old page is freed
+            BHeader *new_header = buffer_manager->create_new_page();
+            uint64_t new_page_id = new_header->page_id;
+            std::memcpy((char *)new_header, (char *)header, PAGE_SIZE);
+            new_header->page_id = new_page_id;
+            if (!inner)
+            {
+                BOuterNode<PAGE_SIZE> *node = (BOuterNode<PAGE_SIZE> *)new_header;
+                if (cache && node->current_index > 0)
+                {
+                    cache->update_range(node->get_key(0), node->get_key(node->current_index - 1), new_page_id, new_header);
+                }
+                if (previous_leaf_id != 0)
+                {
+                    BOuterNode<PAGE_SIZE> *previous = (BOuterNode<PAGE_SIZE> *)buffer_manager->request_page(previous_leaf_id);
+                    previous->next_lef_id = new_page_id;
+                    buffer_manager->unfix_page(previous_leaf_id, true);
+                }
+            }
+            buffer_manager->unfix_page(new_page_id, true);
+            buffer_manager->unfix_page(page_id, false);
+            buffer_manager->delete_page(page_id);
+            page_id = new_page_id;
         }
         else
         {
-            BInnerNode<PAGE_SIZE> *node = (BInnerNode<PAGE_SIZE> *)header;
-            BHeader *child_header = buffer_manager->request_page(node->next_page(key));
-            buffer_manager->unfix_page(header->page_id, false);
-            return scan_recursive(child_header, key, range);
+            buffer_manager->unfix_page(page_id, false);
         }
+
+        if (!inner)
+            previous_leaf_id = page_id;
+        return page_id;
+    }
+
+    /**
+     * @brief Returns how many entries a bulk loaded outer node takes before the next one is started
+     * @param node The outer node
+     * @param key The next key, a packed node might need wider keys to take it
+     * @param fill_factor Fraction of the capacity that is filled
+     * @return the number of entries
+     */
+    int get_fill_limit(BOuterNode<PAGE_SIZE> *node, int64_t key, double fill_factor)
+    {
+        int capacity = node->header.packed ? node->get_capacity(node->get_width_with(key)) : node->max_size;
+        return std::max(1, static_cast<int>(std::ceil(fill_factor * capacity)));
+    }
+
+    /**
+     * @brief Builds one level of inner nodes of a bulk loaded tree above the nodes of the level below
+     * @param children The page ids of the nodes below in key order, each with the largest key in its subtree
+     * @param fill_factor Fraction of the keys of a node that is filled
+     * @param on_node Called after every node that was written
+     * @return the page ids of the new nodes, each with the largest key in its subtree
+     */
+    std::vector<std::pair<uint64_t, int64_t>> bulk_load_level(const std::vector<std::pair<uint64_t, int64_t>> &children, double fill_factor, const std::function<void()> &on_node)
+    {
+        // the maximum number of keys of an inner node, see BInnerNode
+        int max_keys = indexed_inner_nodes ? BInnerNode<PAGE_SIZE>::index_layout.capacity : ((PAGE_SIZE - 32) / 2) / 8 - 1;
+        uint64_t children_per_node = std::max(2, static_cast<int>(std::ceil(fill_factor * max_keys))) + 1;
+        uint64_t node_count = (children.size() + children_per_node - 1) / children_per_node;
+
+        std::vector<std::pair<uint64_t, int64_t>> level;
+        level.reserve(node_count);
+        uint64_t start = 0;
+        for (uint64_t n = 0; n < node_count; n++)
+        {
+            // the children are spread evenly, so the last node does not end up with a single child
+            uint64_t end = start + children.size() / node_count + (n < children.size() % node_count ? 1 : 0);
+            BHeader *header = buffer_manager->create_new_page();
+            BInnerNode<PAGE_SIZE> *node = new (header) BInnerNode<PAGE_SIZE>(indexed_inner_nodes);
+            node->child_ids[0] = children[start].first;
+            for (uint64_t i = start + 1; i < end; i++)
+            {
+                // the key in front of a child is the largest key of the child before it
+                node->keys[node->current_index] = children[i - 1].second;
+                node->child_ids[node->current_index + 1] = children[i].first;
+                node->current_index++;
+            }
+            node->update_index();
+            level.emplace_back(header->page_id, children[end - 1].second);
+            buffer_manager->unfix_page(header->page_id, true);
+            if (on_node)
+                on_node();
+            start = end;
+        }
+        return level;
     }
 
     /**
@@ -896,7 +1010,7 @@ private:
 
             for (int i = 0; i < node->current_index; i++)
             {
-                if (node->keys[i] > key)
+                if (node->get_key(i) > key)
                 {
                     return false;
                 }
@@ -946,7 +1060,7 @@ private:
 
             for (int i = 0; i < node->current_index; i++)
             {
-                if (node->keys[i] < key)
+                if (node->get_key(i) < key)
                 {
                     return false;
                 }
@@ -1002,7 +1116,7 @@ private:
                 count++;
                 if (i > 0)
                 {
-                    if (node->keys[i - 1] > node->keys[i])
+                    if (node->get_key(i - 1) > node->get_key(i))
                     {
                         return false;
                     }
@@ -1045,33 +1159,115 @@ public:
      * @brief Constructor for the B+ tree
      * @param buffer_manager_arg The buffer manager
      * @param cache_arg The chache
+     * @param packed_leaves_arg If the keys in the outer nodes are packed, new outer nodes take the layout of the node they are split from
+     * @param indexed_inner_nodes_arg If the inner nodes carry a search index behind their keys
      */
-    BPlusTree(BufferManager *buffer_manager_arg, RadixTree<PAGE_SIZE> *cache_arg = nullptr) : buffer_manager(buffer_manager_arg), cache(cache_arg)
+    BPlusTree(BufferManager *buffer_manager_arg, RadixTree<PAGE_SIZE> *cache_arg = nullptr, bool packed_leaves_arg = false, bool indexed_inner_nodes_arg = false) : buffer_manager(buffer_manager_arg), cache(cache_arg), indexed_inner_nodes(indexed_inner_nodes_arg)
     {
         logger = spdlog::get("logger");
         BHeader *root = buffer_manager->create_new_page();
         buffer_manager->unfix_page(root->page_id, true);
-        new (root) BOuterNode<PAGE_SIZE>();
+        new (root) BOuterNode<PAGE_SIZE>(packed_leaves_arg);
         root_id = root->page_id;
     };
 
     /**
-     * @brief Insert an element into the tree
+     * @brief Constructor for a B+ tree whose pages are already on disc
+     * @param buffer_manager_arg The buffer manager
+     * @param cache_arg The chache
+     * @param root_id_arg The page id of the existing root
+     */
+    BPlusTree(BufferManager *buffer_manager_arg, RadixTree<PAGE_SIZE> *cache_arg, uint64_t root_id_arg) : buffer_manager(buffer_manager_arg), cache(cache_arg), root_id(root_id_arg)
+    {
+        logger = spdlog::get("logger");
+        // the tree keeps the layout of the inner nodes it was created with
+        BHeader *root = buffer_manager->request_page(root_id);
+        indexed_inner_nodes = root->inner && ((BInnerNode<PAGE_SIZE> *)root)->indexed;
+        buffer_manager->unfix_page(root_id, false);
+    };
+
+    /**
+     * @brief Returns the page id of the root, needed to open the tree again
+     * @return the page id of the root
+     */
+    uint64_t get_root_id()
+    {
+        return root_id;
+    }
+
+    /**
+     * @brief Insert an element into the tree. A leaf with space takes the key under the shared latch, a full leaf is split under the exclusive latch
      * @param key The key that will be inserted
      * @param value The value that will be inserted
      */
     void insert(int64_t key, int64_t value)
     {
+        latch.lock_shared();
+        BHeader *header = find_leaf(key);
+        BOuterNode<PAGE_SIZE> *node = (BOuterNode<PAGE_SIZE> *)header;
+        buffer_manager->lock_version(header);
+        bool inserted = !node->is_full(key);
+        if (inserted)
+            node->insert(key, value);
+        buffer_manager->unlock_version(header);
+        if (inserted && cache)
+            cache->insert(key, header->page_id, header);
+        buffer_manager->unfix_page(header->page_id, inserted);
+        latch.unlock_shared();
+        if (inserted)
+            return;
+
+        // the split changes the structure of the tree, the insert starts again from the root without other operations in the tree
+        latch.lock();
         recursive_insert(buffer_manager->request_page(root_id), key, value);
+        latch.unlock();
     }
 
     /**
-     * @brief Delete an element from the tree
+     * @brief Delete an element from the tree. The key is deleted from its leaf under the shared latch if no node on the path has to be merged or substituted
+     * and no inner node holds the key, otherwise under the exclusive latch
      * @param key The key that will be deleted
      */
     void delete_value(int64_t key)
     {
+        latch.lock_shared();
+        BHeader *header = buffer_manager->request_page(root_id);
+        // a root without keys is replaced by its child first
+        bool in_place = !header->inner || ((BInnerNode<PAGE_SIZE> *)header)->current_index > 0;
+        while (in_place && header->inner)
+        {
+            BInnerNode<PAGE_SIZE> *node = (BInnerNode<PAGE_SIZE> *)header;
+            if (node->contains(key))
+            {
+                in_place = false;
+                break;
+            }
+            BHeader *child_header = buffer_manager->request_page(node->next_page(key));
+            buffer_manager->unfix_page(header->page_id, false);
+            header = child_header;
+            if (header->inner && !((BInnerNode<PAGE_SIZE> *)header)->can_delete())
+                in_place = false;
+        }
+        if (in_place)
+        {
+            BOuterNode<PAGE_SIZE> *node = (BOuterNode<PAGE_SIZE> *)header;
+            buffer_manager->lock_version(header);
+            // the root has no lower bound for its size
+            in_place = header->page_id == root_id || node->can_delete();
+            if (in_place)
+                node->delete_value(key);
+            buffer_manager->unlock_version(header);
+            if (in_place && cache)
+                cache->delete_reference(key);
+        }
+        buffer_manager->unfix_page(header->page_id, in_place);
+        latch.unlock_shared();
+        if (in_place)
+            return;
+
+        latch.lock();
         recursive_delete(buffer_manager->request_page(root_id), key);
+        latch.unlock();
     }
 
     /**
@@ -1081,7 +1277,22 @@ public:
      */
     int64_t get_value(int64_t key)
     {
-        return recursive_get_value(buffer_manager->request_page(root_id), key);
+        latch.lock_shared();
+        BHeader *header = find_leaf(key);
+        BOuterNode<PAGE_SIZE> *node = (BOuterNode<PAGE_SIZE> *)header;
+        int64_t value;
+        uint64_t version;
+        // the leaf is read again if a writer changed it at the same time, the reader itself writes nothing to the leaf
+        do
+        {
+            version = buffer_manager->read_version(header);
+            value = node->get_value(key);
+        } while (!buffer_manager->validate_version(header, version));
+        if (cache && value != INT64_MIN)
+            cache->insert(key, header->page_id, header);
+        buffer_manager->unfix_page(header->page_id, false);
+        latch.unlock_shared();
+        return value;
     }
 
     /**
@@ -1092,7 +1303,10 @@ public:
      */
     int64_t scan(int64_t key, int range)
     {
-        return scan_recursive(buffer_manager->request_page(root_id), key, range);
+        latch.lock_shared();
+        int64_t sum = scan_recursive(buffer_manager->request_page(root_id), key, range);
+        latch.unlock_shared();
+        return sum;
     }
 
     /**
@@ -1102,7 +1316,165 @@ public:
      */
     void update(int64_t key, int64_t value)
     {
-        return update_recursive(buffer_manager->request_page(root_id), key, value);
+        latch.lock_shared();
+        BHeader *header = find_leaf(key);
+        buffer_manager->lock_version(header);
+        ((BOuterNode<PAGE_SIZE> *)header)->update(key, value);
+        buffer_manager->unlock_version(header);
+        if (cache)
+            cache->insert(key, header->page_id, header);
+        buffer_manager->unfix_page(header->page_id, true);
+        latch.unlock_shared();
+    }
+
+    /**
+     * @brief Moves the nodes into the free pages at the start of the data file, so the pages at its end become free and can be cut off
+     * @param on_relocation Called after every move, once the tree is consistent again
+     */
+    void compact(const std::function<void()> &on_relocation = nullptr)
+    {
+        latch.lock();
+        uint64_t previous_leaf_id = 0;
+        uint64_t new_root_id = compact_recursive(root_id, previous_leaf_id, on_relocation);
+        if (new_root_id != root_id)
+        {
+            root_id = new_root_id;
+            if (on_relocation)
+                on_relocation();
+        }
+        latch.unlock();
+    }
+
+    /**
+     * @brief Loads an empty tree with entries sorted by their keys. The leaves are filled from left to right and the inner levels are built bottom up,
+     * so no node is searched or split and the nodes of a level get consecutive pages. The cache is not filled, it is filled by the lookups that follow
+     * @param entries The keys and values, sorted by the keys, which must be unique
+     * @param fill_factor Fraction of the nodes that is filled, between 0.5 and 1. The space that is left takes inserts without splitting the nodes
+     * @param on_node Called after every node that was written
+     */
+    void bulk_load(const std::vector<std::pair<int64_t, int64_t>> &entries, double fill_factor = 0.9, const std::function<void()> &on_node = nullptr)
+    {
+        if (fill_factor < 0.5 || fill_factor > 1)
+        {
+            logger->error("The fill factor {} is not between 0.5 and 1", fill_factor);
+            exit(1);
+        }
+        BHeader *header = buffer_manager->request_page(root_id);
+        if (header->inner || ((BOuterNode<PAGE_SIZE> *)header)->current_index != 0)
+        {
+            logger->error("Only an empty b+ tree can be bulk loaded");
+            exit(1);
+        }
+        latch.lock();
+
+        // the empty root becomes the first leaf, the other leaves take its layout
+        bool packed = header->packed;
+        BOuterNode<PAGE_SIZE> *leaf = (BOuterNode<PAGE_SIZE> *)header;
+        // the finished nodes of the level that is built, each with the largest key in its subtree
+        std::vector<std::pair<uint64_t, int64_t>> level;
+        for (uint64_t i = 0; i < entries.size(); i++)
+        {
+            int64_t key = entries[i].first;
+            assert((i == 0 || entries[i - 1].first < key) && "Bulk loading entries that are not sorted");
+            if (leaf->current_index > 0 && (leaf->is_full(key) || leaf->current_index >= get_fill_limit(leaf, key, fill_factor)))
+            {
+                BHeader *next_header = buffer_manager->create_new_page();
+                uint64_t next_id = next_header->page_id;
+                new (next_header) BOuterNode<PAGE_SIZE>(packed);
+                leaf->next_lef_id = next_id;
+                level.emplace_back(leaf->header.page_id, leaf->get_key(leaf->current_index - 1));
+                buffer_manager->unfix_page(leaf->header.page_id, true);
+                buffer_manager->unfix_page(next_id, true);
+                if (on_node)
+                    on_node();
+                // requested again, so its changes belong to the next operation of the log
+                leaf = (BOuterNode<PAGE_SIZE> *)buffer_manager->request_page(next_id);
+            }
+            leaf->insert(key, entries[i].second);
+        }
+
+        if (!level.empty() && leaf->is_too_empty())
+        {
+            // the last leaf takes entries from the one before it, otherwise the first delete from it would merge it
+            BOuterNode<PAGE_SIZE> *previous = (BOuterNode<PAGE_SIZE> *)buffer_manager->request_page(level.back().first);
+            int first = previous->current_index - (previous->current_index - leaf->current_index) / 2;
+            int index = previous->current_index;
+            while (index > first && !leaf->is_full(previous->get_key(index - 1)))
+            {
+                index--;
+                leaf->insert(previous->get_key(index), previous->get_value_at(index));
+            }
+            previous->truncate(index);
+            level.back().second = previous->get_key(index - 1);
+            buffer_manager->unfix_page(previous->header.page_id, true);
+        }
+        level.emplace_back(leaf->header.page_id, leaf->current_index > 0 ? leaf->get_key(leaf->current_index - 1) : 0);
+        buffer_manager->unfix_page(leaf->header.page_id, true);
+        if (on_node)
+            on_node();
+
+        while (level.size() > 1)
+        {
+            level = bulk_load_level(level, fill_factor, on_node);
+        }
+        root_id = level[0].first;
+        latch.unlock();
+    }
+
+    /**
+     * @brief Loads an empty tree with entries in any order. The entries are sorted in chunks on several threads and the chunks are merged in pairs,
+     * also in parallel, before the tree is bulk loaded with them
+     * @param entries The keys and values, the keys must be unique. They are sorted in place
+     * @param thread_count The number of chunks that are sorted at the same time
+     * @param fill_factor Fraction of the nodes that is filled, between 0.5 and 1
+     * @param on_node Called after every node that was written
+     */
+    void bulk_load_unsorted(std::vector<std::pair<int64_t, int64_t>> &entries, unsigned thread_count, double fill_factor = 0.9, const std::function<void()> &on_node = nullptr)
+    {
+        uint64_t chunk_size = std::max<uint64_t>(1, (entries.size() + std::max(1u, thread_count) - 1) / std::max(1u, thread_count));
+        // chunk c holds the entries from bounds[c] up to bounds[c + 1]
+        std::vector<uint64_t> bounds;
+        for (uint64_t start = 0; start < entries.size(); start += chunk_size)
+        {
+            bounds.push_back(start);
+        }
+        bounds.push_back(entries.size());
+
+        std::vector<std::thread> threads;
+        for (uint64_t c = 0; c + 1 < bounds.size(); c++)
+        {
+            threads.emplace_back([&entries, begin = bounds[c], end = bounds[c + 1]]
+                                 { std::sort(entries.begin() + begin, entries.begin() + end); });
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+
+        // every round merges neighbouring chunks, so the number of chunks halves
+        while (bounds.size() > 2)
+        {
+            threads.clear();
+            std::vector<uint64_t> merged_bounds;
+            uint64_t c = 0;
+            for (; c + 2 < bounds.size(); c += 2)
+            {
+                threads.emplace_back([&entries, begin = bounds[c], middle = bounds[c + 1], end = bounds[c + 2]]
+                                     { std::inplace_merge(entries.begin() + begin, entries.begin() + middle, entries.begin() + end); });
+                merged_bounds.push_back(bounds[c]);
+            }
+            // a chunk without a partner is merged in the next round
+            if (c + 1 < bounds.size())
+                merged_bounds.push_back(bounds[c]);
+            merged_bounds.push_back(entries.size());
+            for (std::thread &thread : threads)
+            {
+                thread.join();
+            }
+            bounds = merged_bounds;
+        }
+
+        bulk_load(entries, fill_factor, on_node);
     }
 
     /**
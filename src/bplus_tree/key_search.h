@@ -0,0 +1,193 @@
+/**
+ * @file    key_search.h
+ *
+ * @author  Matteo Wohlrapp
+ * @date    17.10.2026
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <immintrin.h>
+
+/**
+ * @brief Finds the position of a key in the sorted keys of a node. A branchless binary search narrows the keys down to a window of two cache lines,
+ * which is then compared at once with AVX-512 or AVX2 if the processor has it and with a scalar loop otherwise
+ */
+class KeySearch
+{
+public:
+    /**
+     * @brief Instruction sets the search can use
+     */
+    enum class Kernel
+    {
+        SCALAR,
+        AVX2,
+        AVX512
+    };
+
+    /// number of keys the binary search narrows down to, two cache lines
+    static constexpr int window_size = 16;
+
+    /**
+     * @brief Returns the best kernel the processor supports
+     * @return the kernel
+     */
+    static Kernel best_kernel()
+    {
+        static const Kernel kernel = __builtin_cpu_supports("avx512f") ? Kernel::AVX512 : __builtin_cpu_supports("avx2") ? Kernel::AVX2
+                                                                                                                       : Kernel::SCALAR;
+        return kernel;
+    }
+
+    /**
+     * @brief Returns if the processor can run a kernel
+     * @param kernel The kernel
+     * @return if it is supported
+     */
+    static bool supports(Kernel kernel)
+    {
+        switch (kernel)
+        {
+        case Kernel::AVX512:
+            return __builtin_cpu_supports("avx512f");
+        case Kernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+        default:
+            return true;
+        }
+    }
+
+    /**
+     * @brief Returns the index of the first key that is greater or equal to the key, with a chosen kernel
+     * @param keys The sorted keys
+     * @param count The number of keys
+     * @param key The key to look for
+     * @param kernel The kernel, must be supported by the processor
+     * @return the index, count if all keys are smaller
+     */
+    static int lower_bound(const int64_t *keys, int count, int64_t key, Kernel kernel)
+    {
+        // the keys before base are smaller than the key, the keys from base + count on are not
+        const int64_t *base = keys;
+        while (count > window_size)
+        {
+            int half = count / 2;
+            base = base[half] < key ? base + half : base;
+            count -= half;
+        }
+
+        return static_cast<int>(base - keys) + count_smaller(base, count, key, kernel);
+    }
+
+    /**
+     * @brief Returns the index of the first key that is greater or equal to the key
+     * @param keys The sorted keys
+     * @param count The number of keys
+     * @param key The key to look for
+     * @return the index, count if all keys are smaller
+     */
+    static int lower_bound(const int64_t *keys, int count, int64_t key)
+    {
+        return lower_bound(keys, count, key, best_kernel());
+    }
+
+    /**
+     * @brief Counts the keys of a window that are smaller than the key, with a chosen kernel
+     * @param keys The window
+     * @param count The number of keys in the window, at most window_size
+     * @param key The key
+     * @param kernel The kernel, must be supported by the processor
+     * @return the number of smaller keys
+     */
+    static int count_smaller(const int64_t *keys, int count, int64_t key, Kernel kernel)
+    {
+        switch (kernel)
+        {
+        case Kernel::AVX512:
+            return count_smaller_avx512(keys, count, key);
+        case Kernel::AVX2:
+            return count_smaller_avx2(keys, count, key);
+        default:
+            return count_smaller_scalar(keys, count, key);
+        }
+    }
+
+    /**
+     * @brief Counts the keys of a window that are smaller than the key
+     * @param keys The window
+     * @param count The number of keys in the window, at most window_size
+     * @param key The key
+     * @return the number of smaller keys
+     */
+    static int count_smaller(const int64_t *keys, int count, int64_t key)
+    {
+        return count_smaller(keys, count, key, best_kernel());
+    }
+
+private:
+    /**
+     * @brief Counts the keys of a window that are smaller than the key, one at a time
+     * @param keys The window
+     * @param count The number of keys in the window
+     * @param key The key
+     * @return the number of smaller keys
+     */
+    static int count_smaller_scalar(const int64_t *keys, int count, int64_t key)
+    {
+        int smaller = 0;
+        for (int i = 0; i < count; i++)
+        {
+            smaller += keys[i] < key;
+        }
+        return smaller;
+    }
+
+    /**
+     * @brief Counts the keys of a window that are smaller than the key, four at a time
+     * @param keys The window
+     * @param count The number of keys in the window
+     * @param key The key
+     * @return the number of smaller keys
+     */
+    __attribute__((target("avx2,popcnt"))) static int count_smaller_avx2(const int64_t *keys, int count, int64_t key)
+    {
+        __m256i key_simd = _mm256_set1_epi64x(key);
+        int smaller = 0;
+        int i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256i keys_simd = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+            __m256i cmp = _mm256_cmpgt_epi64(key_simd, keys_simd);
+            smaller += _mm_popcnt_u32(_mm256_movemask_pd(_mm256_castsi256_pd(cmp)));
+        }
+        return smaller + count_smaller_scalar(keys + i, count - i, key);
+    }
+
+    /**
+     * @brief Counts the keys of a window that are smaller than the key, eight at a time, the rest with a masked load
+     * @param keys The window
+     * @param count The number of keys in the window
+     * @param key The key
+     * @return the number of smaller keys
+     */
+    __attribute__((target("avx512f,popcnt"))) static int count_smaller_avx512(const int64_t *keys, int count, int64_t key)
+    {
+        __m512i key_simd = _mm512_set1_epi64(key);
+        int smaller = 0;
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m512i keys_simd = _mm512_loadu_si512(keys + i);
+            smaller += _mm_popcnt_u32(_mm512_cmplt_epi64_mask(keys_simd, key_simd));
+        }
+        if (i < count)
+        {
+            __mmask8 mask = static_cast<__mmask8>((1u << (count - i)) - 1);
+            __m512i keys_simd = _mm512_maskz_loadu_epi64(mask, keys + i);
+            smaller += _mm_popcnt_u32(_mm512_mask_cmplt_epi64_mask(mask, keys_simd, key_simd));
+        }
+        return smaller;
+    }
+};
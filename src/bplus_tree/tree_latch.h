@@ -0,0 +1,105 @@
+/**
+ * @file    tree_latch.h
+ *
+ * @author  Matteo Wohlrapp
+ * @date    17.10.2026
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Reader writer latch of a whole tree. Every thread announces itself as a reader in a slot of its own, so readers only write cache lines no other thread uses.
+ * A writer waits until all slots are empty, so taking the latch exclusively is slow and only done for changes of the structure of the tree
+ */
+class TreeLatch
+{
+private:
+    /// number of slots, threads beyond it share slots
+    static constexpr uint64_t slot_count = 128;
+
+    /**
+     * @brief Number of readers of one slot, on a cache line of its own
+     */
+    struct alignas(64) Slot
+    {
+        std::atomic<uint32_t> readers{0};
+    };
+
+    Slot slots[slot_count];
+
+    /// if a writer holds the latch or waits for the readers to leave
+    alignas(64) std::atomic<bool> writer{false};
+
+    /// serializes the writers
+    std::mutex writer_mutex;
+
+    /**
+     * @brief Returns the slot of the calling thread
+     * @return the slot
+     */
+    Slot &get_slot()
+    {
+        static std::atomic<uint64_t> next_thread{0};
+        thread_local uint64_t thread_index = next_thread.fetch_add(1, std::memory_order_relaxed);
+        return slots[thread_index % slot_count];
+    }
+
+public:
+    /**
+     * @brief Takes the latch shared, waits while a writer holds it
+     */
+    void lock_shared()
+    {
+        Slot &slot = get_slot();
+        while (true)
+        {
+            // the announcement and the check of the writer are sequentially consistent, so either the writer sees the reader or the reader sees the writer
+            slot.readers.fetch_add(1);
+            if (!writer.load())
+                return;
+            slot.readers.fetch_sub(1);
+            while (writer.load(std::memory_order_relaxed))
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+     * @brief Releases the latch after it was taken shared
+     */
+    void unlock_shared()
+    {
+        get_slot().readers.fetch_sub(1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Takes the latch exclusively, waits until all readers left
+     */
+    void lock()
+    {
+        writer_mutex.lock();
+        writer.store(true);
+        for (Slot &slot : slots)
+        {
+            while (slot.readers.load() != 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /**
+     * @brief Releases the latch after it was taken exclusively
+     */
+    void unlock()
+    {
+        writer.store(false, std::memory_order_release);
+        writer_mutex.unlock();
+    }
+};
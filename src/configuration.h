@@ -7,12 +7,16 @@
 
 #pragma once
 
+#include <filesystem>
+#include <string>
+#include <vector>
+
 /**
  * @brief namespace that contains all important variables for the configuration of the database
  */
 namespace Configuration
 {
-    /// sets the overall page_size for the pages written to memory. Subject to constraints: [((PAGE_SIZE - 32) / 2) / 8] > 2, also dividable by 16 for header alginment
+    /// sets the overall page_size for the pages written to memory. Subject to constraints: [((PAGE_SIZE - 32) / 2) / 8] > 2, also dividable by 16 for header alginment. Run configurations use it, workloads can choose another one with --page_size
     constexpr int page_size = 4096;
 
     struct Configuration
@@ -33,5 +37,24 @@ namespace Configuration
         bool run_workload = false;            /// if a workload or a run config should be run
         bool script = false;
         double coefficient = 0.01; /// coefficient of the distribution
+        std::string buffer_policy = "clock"; /// replacement policy of the buffer manager
+        bool huge_pages = false;             /// if the buffer is backed by huge pages
+        double clean_fraction = 0;           /// fraction of the buffer kept clean by the background flusher, 0 disables it
+        uint64_t prefetch_depth = 0;         /// maximum number of leaves read ahead during scans, 0 disables prefetching
+        bool direct_io = false;              /// if the data file bypasses the page cache of the kernel
+        bool io_uring = false;               /// if pages are read and written through io_uring
+        bool mmap = false;                   /// if pages are read from a memory mapping of the data file
+        bool persistent = false;             /// if the database is kept after the run and opened again by the next one
+        bool wal = false;                    /// if inserts, updates and deletes are written to a log before they are applied
+        uint64_t wal_commit_interval = 1000; /// time in microseconds log records are collected before they are committed together
+        bool compression = false;            /// if pages are compressed in the data file
+        bool packed_leaves = false;          /// if the keys in the outer nodes of the b+ tree are packed
+        bool indexed_inner_nodes = false;    /// if the inner nodes of the b+ tree carry a search index behind their keys
+        int page_size = 4096;                /// size of the pages of workloads, one of PageSize::supported
+        uint64_t stripe_count = 1;           /// number of data files the pages are striped across
+        std::vector<std::filesystem::path> stripe_paths; /// folders of the data files, one for every stripe, the others are placed in ./db
+        double fill_factor = 0.9;            /// fraction of the nodes of the b+ tree that is filled when the records are loaded
+        uint64_t thread_count = 1;           /// number of threads the operations of a workload are split across
+        char workload = 0;                   /// workload that is run, 0 runs the general workload
     };
 }
@@ -3,162 +3,784 @@
 #include "../configuration.h"
 #include <iostream>
 #include <stdlib.h>
-#include <random>
+#include <cstddef>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <new>
+#include <cstring>
+#include <chrono>
 
-BufferManager::BufferManager(StorageManager *storage_manager_arg, uint64_t buffer_size_arg, int page_size_arg) : storage_manager(storage_manager_arg), buffer_size(buffer_size_arg), page_size(page_size_arg)
+BufferManager::BufferManager(StorageManager *storage_manager_arg, uint64_t buffer_size_arg, int page_size_arg, const std::string &buffer_policy_arg, bool huge_pages_arg, double clean_fraction_arg, uint64_t prefetch_depth_arg) : storage_manager(storage_manager_arg), clean_fraction(clean_fraction_arg), prefetch_depth(prefetch_depth_arg), buffer_size(buffer_size_arg), page_size(page_size_arg)
 {
     logger = spdlog::get("logger");
-    dist = std::uniform_int_distribution<int>(0, buffer_size);
+    frame_size = offsetof(BFrame, header) + page_size;
+    // frames start on a cache line so the flags and the beginning of the page share one line
+    frame_stride = (frame_size + 63) & ~size_t(63);
+    allocate_arena(huge_pages_arg);
+
+    page_id_map.reserve(shard_count);
+    for (uint64_t i = 0; i < shard_count; i++)
+    {
+        page_id_map.push_back(std::make_unique<PageTableShard>(buffer_size / shard_count + 1));
+    }
+
+    frames.reserve(buffer_size);
+    free_frames.reserve(buffer_size);
+    for (uint64_t i = 0; i < buffer_size; i++)
+    {
+        BFrame *frame = new (arena + i * frame_stride) BFrame();
+        frame->index = i;
+        frames.push_back(frame);
+    }
+    // hand out the frames from the front of the arena first
+    for (uint64_t i = buffer_size; i > 0; i--)
+    {
+        free_frames.push_back(i - 1);
+    }
+
+    replacement_policy = create_replacement_policy(buffer_policy_arg, frames, buffer_size);
+    if (!replacement_policy)
+    {
+        logger->error("Unknown buffer policy: " + buffer_policy_arg);
+        exit(1);
+    }
+
+    if (clean_fraction > 0)
+    {
+        flusher = std::thread(&BufferManager::run_flusher, this);
+    }
+    if (prefetch_depth > 0)
+    {
+        prefetcher = std::thread(&BufferManager::run_prefetcher, this);
+    }
+}
+
+void BufferManager::allocate_arena(bool huge_pages)
+{
+    size_t os_page_size = sysconf(_SC_PAGESIZE);
+    // one page more, so an optimistic read of a page that is changed at the same time never reads past the arena
+    arena_size = (buffer_size * frame_stride + page_size + os_page_size - 1) / os_page_size * os_page_size;
+    void *memory = MAP_FAILED;
+    if (huge_pages)
+    {
+        // explicit huge pages need a reserved pool, the mapping has to be a multiple of 2 MB
+        size_t huge_page_size = 2 * 1024 * 1024;
+        size_t huge_arena_size = (arena_size + huge_page_size - 1) / huge_page_size * huge_page_size;
+        memory = mmap(nullptr, huge_arena_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED)
+            arena_size = huge_arena_size;
+        else
+            logger->info("No huge pages available for the buffer, falling back to transparent huge pages");
+    }
+    if (memory == MAP_FAILED)
+    {
+        memory = mmap(nullptr, arena_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+        {
+            logger->error("Could not allocate the memory for the buffer.");
+            exit(1);
+        }
+        if (huge_pages)
+            madvise(memory, arena_size, MADV_HUGEPAGE);
+    }
+    arena = static_cast<char *>(memory);
 }
 
 void BufferManager::destroy()
 {
-    for (auto &pair : page_id_map)
+    if (flusher.joinable())
+    {
+        stop_flusher = true;
+        flusher_condition.notify_one();
+        flusher.join();
+    }
+    if (prefetcher.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> guard(prefetch_mutex);
+            stop_prefetcher = true;
+        }
+        prefetch_condition.notify_one();
+        prefetcher.join();
+    }
+    // all dirty pages are written in one batch
+    std::vector<BHeader *> dirty_pages;
+    for (auto &shard : page_id_map)
+    {
+        for (auto &entry : shard->table)
+        {
+            if (entry.frame->dirty)
+            {
+                dirty_pages.push_back(&entry.frame->header);
+            }
+        }
+    }
+    save_pages(dirty_pages);
+    for (BFrame *frame : frames)
+    {
+        frame->~BFrame();
+    }
+    munmap(arena, arena_size);
+    arena = nullptr;
+    frames.clear();
+}
+
+void BufferManager::run_flusher()
+{
+    uint64_t max_dirty = (1 - clean_fraction) * buffer_size;
+    std::vector<char> copies(flush_batch_size * page_size);
+    std::vector<BHeader *> batch;
+    uint64_t cursor = 0;
+    while (!stop_flusher)
+    {
+        batch.clear();
+        if (dirty_count > max_dirty)
+        {
+            // the miss mutex keeps the frames from being evicted and reused while they are copied
+            std::unique_lock<std::mutex> miss_lock(miss_mutex);
+            // the storage mutex is kept until the copies are written, so the pages can not be read from disc before the writes arrived
+            std::lock_guard<std::mutex> storage_guard(storage_mutex);
+            // sweep in arena order, a frame is visited again only after all others were checked
+            for (uint64_t visited = 0; visited < frames.size() && batch.size() < flush_batch_size && dirty_count > max_dirty && !stop_flusher; visited++)
+            {
+                BFrame *frame = frames[cursor];
+                cursor = cursor + 1 == frames.size() ? 0 : cursor + 1;
+                char *copy = copies.data() + batch.size() * page_size;
+                if (frame->dirty && frame->fix_count == 0 && copy_dirty_frame(frame, copy))
+                    batch.push_back(reinterpret_cast<BHeader *>(copy));
+            }
+            miss_lock.unlock();
+            // the whole batch is handed to the storage manager at once
+            if (!batch.empty())
+                save_pages(batch);
+        }
+        flush_count += batch.size();
+        // keep going without a break as long as full batches are written
+        if (batch.size() < flush_batch_size)
+        {
+            std::unique_lock<std::mutex> lock(flusher_mutex);
+            flusher_condition.wait_for(lock, std::chrono::milliseconds(1));
+        }
+    }
+}
+
+bool BufferManager::copy_dirty_frame(BFrame *frame, char *copy)
+{
+    PageTableShard &shard = get_shard(frame->page_id);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    if (shard.table.find(frame->page_id) != frame || frame->fix_count > 0 || !frame->dirty)
+        return false;
+    std::memcpy(copy, &frame->header, page_size);
+    clear_dirty(frame);
+    return true;
+}
+
+void BufferManager::run_prefetcher()
+{
+    std::vector<std::pair<uint64_t, uint64_t>> batch;
+    while (true)
+    {
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(prefetch_mutex);
+            prefetch_condition.wait(lock, [this]
+                                    { return stop_prefetcher || !prefetch_queue.empty(); });
+            if (stop_prefetcher)
+                return;
+            // the queued pages are read together, the leaves they point to are read in the next round
+            while (!prefetch_queue.empty() && batch.size() < prefetch_batch_size)
+            {
+                batch.push_back(prefetch_queue.front());
+                prefetch_queue.pop_front();
+                queued_page_ids.erase(batch.back().first);
+            }
+        }
+
+        std::vector<std::unique_ptr<char[]>> pages;
+        std::vector<BHeader *> headers;
+        std::vector<uint64_t> page_ids;
+        std::vector<uint64_t> follow_leaves;
+        for (auto &[page_id, follow] : batch)
+        {
+            if (find_frame(page_id))
+                continue;
+            pages.emplace_back(new char[page_size]);
+            headers.push_back(reinterpret_cast<BHeader *>(pages.back().get()));
+            page_ids.push_back(page_id);
+            follow_leaves.push_back(follow);
+        }
+        if (pages.empty())
+            continue;
+
+        // the copies are stored while the storage mutex is held, a later write of a page drops it again
+        std::lock_guard<std::mutex> storage_guard(storage_mutex);
+        storage_manager->load_pages(headers, page_ids);
+        std::lock_guard<std::mutex> guard(prefetch_mutex);
+        for (size_t i = 0; i < pages.size(); i++)
+        {
+            add_prefetched_page(page_ids[i], std::move(pages[i]), follow_leaves[i]);
+        }
+    }
+}
+
+void BufferManager::add_prefetched_page(uint64_t page_id, std::unique_ptr<char[]> page, uint64_t follow_leaves)
+{
+    if (prefetched_pages.count(page_id))
+        return;
+    if (prefetched_pages.size() >= prefetch_capacity)
+    {
+        // drop the oldest copy that is still there, copies that were taken or written are skipped
+        while (!prefetched_pages.erase(prefetch_order.front()))
+            prefetch_order.pop_front();
+        prefetch_order.pop_front();
+        prefetch_miss_count++;
+    }
+    // copies that were taken or written leave their entry behind, clean up once they dominate the order
+    if (prefetch_order.size() >= 2 * prefetch_capacity)
+    {
+        std::deque<uint64_t> live_order;
+        for (uint64_t prefetched_page_id : prefetch_order)
+        {
+            if (prefetched_pages.count(prefetched_page_id))
+                live_order.push_back(prefetched_page_id);
+        }
+        prefetch_order = std::move(live_order);
+    }
+    prefetch_order.push_back(page_id);
+    prefetch_count++;
+    BHeader *header = reinterpret_cast<BHeader *>(page.get());
+    uint64_t next_leaf_id = *reinterpret_cast<uint64_t *>(page.get() + next_leaf_offset);
+    if (follow_leaves > 0 && !header->inner && next_leaf_id != 0 && !queued_page_ids.count(next_leaf_id))
+    {
+        prefetch_queue.emplace_back(next_leaf_id, follow_leaves - 1);
+        queued_page_ids.insert(next_leaf_id);
+    }
+    prefetched_pages.emplace(page_id, std::move(page));
+}
+
+void BufferManager::wait_for_log(const std::vector<BHeader *> &headers)
+{
+    if (!write_ahead_log)
+        return;
+    uint64_t lsn = 0;
+    for (BHeader *header : headers)
+    {
+        lsn = std::max(lsn, header->get_lsn());
+    }
+    write_ahead_log->wait_durable(lsn);
+}
+
+void BufferManager::save_page(BHeader *header)
+{
+    wait_for_log({header});
+    storage_manager->save_page(header);
+    if (prefetch_depth > 0)
+    {
+        std::lock_guard<std::mutex> guard(prefetch_mutex);
+        prefetched_pages.erase(header->page_id);
+    }
+}
+
+void BufferManager::save_pages(const std::vector<BHeader *> &headers)
+{
+    wait_for_log(headers);
+    storage_manager->save_pages(headers);
+    if (prefetch_depth > 0)
     {
-        if (pair.second->dirty)
+        std::lock_guard<std::mutex> guard(prefetch_mutex);
+        for (BHeader *header : headers)
         {
-            storage_manager->save_page(&pair.second->header);
+            prefetched_pages.erase(header->page_id);
         }
-        free(pair.second);
     }
 }
 
+void BufferManager::load_page(BHeader *header, uint64_t page_id)
+{
+    if (prefetch_depth > 0)
+    {
+        std::lock_guard<std::mutex> guard(prefetch_mutex);
+        auto it = prefetched_pages.find(page_id);
+        if (it != prefetched_pages.end())
+        {
+            std::memcpy(header, it->second.get(), page_size);
+            prefetched_pages.erase(it);
+            prefetch_hit_count++;
+            return;
+        }
+    }
+    storage_manager->load_page(header, page_id);
+}
+
+void BufferManager::prefetch_page(uint64_t page_id, uint64_t follow_leaves)
+{
+    if (prefetch_depth == 0 || page_id == 0 || find_frame(page_id))
+        return;
+    {
+        std::lock_guard<std::mutex> guard(prefetch_mutex);
+        if (prefetched_pages.count(page_id) || queued_page_ids.count(page_id))
+            return;
+        prefetch_queue.emplace_back(page_id, std::min(follow_leaves, prefetch_depth - 1));
+        queued_page_ids.insert(page_id);
+    }
+    prefetch_condition.notify_one();
+}
+
+BFrame *BufferManager::find_frame(uint64_t page_id)
+{
+    PageTableShard &shard = get_shard(page_id);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    return shard.table.find(page_id);
+}
+
+BFrame *BufferManager::fix_if_present(uint64_t page_id)
+{
+    BFrame *frame;
+    {
+        PageTableShard &shard = get_shard(page_id);
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        frame = shard.table.find(page_id);
+        // the fix is taken under the shard mutex, so the page can not be evicted in between
+        if (frame)
+            frame->fix_count++;
+    }
+    if (frame)
+        replacement_policy->on_access(frame->index);
+    return frame;
+}
+
 BHeader *BufferManager::request_page(uint64_t page_id)
 {
-    std::map<uint64_t, BFrame *>::iterator it = page_id_map.find(page_id);
-    if (it == page_id_map.end())
+    BFrame *frame = fix_if_present(page_id);
+    if (!frame)
     {
         // means the page is not in the buffer and we need to fetch it from memory
-        fetch_page_from_disk(page_id);
-        it = page_id_map.find(page_id);
+        std::lock_guard<std::mutex> miss_guard(miss_mutex);
+        // another thread might have loaded the page while we were waiting
+        frame = fix_if_present(page_id);
+        if (!frame)
+            frame = fetch_page_from_disk(page_id);
     }
-    // fix page
-    it->second->fix_count++;
-    it->second->marked = true;
-    return &it->second->header;
+    if (in_operation())
+        take_before_image(frame);
+    return &frame->header;
 }
 
 BHeader *BufferManager::create_new_page()
 {
-    BFrame *frame_address;
-    // check if buffer is full and then evict pages
-    if (current_buffer_size >= buffer_size)
+    std::lock_guard<std::mutex> miss_guard(miss_mutex);
+    uint64_t page_id;
     {
-        frame_address = evict_page();
-    }
-    else
-    {
-        // insert element in the buffer pool and save the index for the page id in the map
-        // Frame size is page_size + 4 for the fix_count, the marker and the dirty flag
-        frame_address = (BFrame *)malloc(page_size + 8);
-        current_buffer_size++;
+        std::lock_guard<std::mutex> storage_guard(storage_mutex);
+        page_id = storage_manager->get_unused_page_id();
     }
+    BFrame *frame_address = get_free_frame(page_id);
     // fix page
     frame_address->fix_count = 1;
-    frame_address->marked = true;
-    frame_address->dirty = true;
-    uint64_t page_id = storage_manager->get_unused_page_id();
+    set_dirty(frame_address);
+    frame_address->page_id = page_id;
+    // new pages start empty, the same way recovery creates them again
+    std::memset(&frame_address->header, 0, page_size);
     frame_address->header.page_id = page_id;
     frame_address->header.inner = false;
-    page_id_map.emplace(page_id, frame_address);
+    if (in_operation())
+    {
+        uint64_t lsn = write_ahead_log->append_allocate(page_id);
+        frame_address->header.set_lsn(lsn);
+        frame_address->rec_lsn = lsn;
+        // a page id that is used again gets a new before image
+        take_before_image(frame_address, true);
+    }
+    replacement_policy->on_insert(frame_address->index, page_id);
+
+    PageTableShard &shard = get_shard(page_id);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    shard.table.insert(page_id, frame_address);
     return &frame_address->header;
 }
 
 void BufferManager::delete_page(uint64_t page_id)
 {
-    // storage_manager->delete_page(page_id);
-    std::map<uint64_t, BFrame *>::iterator it = page_id_map.find(page_id);
-    if (it != page_id_map.end())
+    std::lock_guard<std::mutex> miss_guard(miss_mutex);
+    BFrame *frame;
     {
-        assert(it->second->fix_count == 0 && "Fix count is not zero when deleting");
-        BFrame *temp = it->second;
-        temp->header.page_id = 0;
-        temp->marked = false;
-        temp->dirty = false;
-        temp->fix_count = 0;
+        PageTableShard &shard = get_shard(page_id);
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        frame = shard.table.find(page_id);
+        if (frame)
+        {
+            assert(frame->fix_count == 0 && "Fix count is not zero when deleting");
+            shard.table.erase(page_id);
+        }
     }
+    if (in_operation())
+        log_free(page_id, frame);
+    if (frame)
+    {
+        // the content is gone, so it is never written, and references to the page in the cache do not match anymore
+        clear_dirty(frame);
+        frame->header.page_id = 0;
+        replacement_policy->on_remove(frame->index);
+        free_frames.push_back(frame->index);
+        current_buffer_size--;
+    }
+    {
+        std::lock_guard<std::mutex> storage_guard(storage_mutex);
+        storage_manager->delete_page(page_id);
+    }
+    if (prefetch_depth > 0)
+    {
+        std::lock_guard<std::mutex> guard(prefetch_mutex);
+        prefetched_pages.erase(page_id);
+    }
+}
+
+uint64_t BufferManager::peek_unused_page_id()
+{
+    std::lock_guard<std::mutex> storage_guard(storage_mutex);
+    return storage_manager->peek_unused_page_id();
+}
+
+uint64_t BufferManager::truncate()
+{
+    // a page that is cut off must not come back during recovery, so its deletion has to be in the log first
+    if (write_ahead_log)
+        write_ahead_log->wait_durable(write_ahead_log->get_end_lsn() - 1);
+    std::lock_guard<std::mutex> storage_guard(storage_mutex);
+    return storage_manager->truncate();
 }
 
 void BufferManager::fix_page(uint64_t page_id)
 {
-    std::map<uint64_t, BFrame *>::iterator it = page_id_map.find(page_id);
-    if (it != page_id_map.end())
+    BFrame *frame = fix_if_present(page_id);
+    if (frame && in_operation())
+        take_before_image(frame);
+}
+
+void BufferManager::unfix_page(uint64_t page_id, bool dirty)
+{
+    PageTableShard &shard = get_shard(page_id);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    BFrame *frame = shard.table.find(page_id);
+    if (frame)
     {
-        assert(it->second->fix_count == 0 && "Trying to fix page that is not unfixed");
-        it->second->marked = true;
-        it->second->fix_count++;
+        assert(frame->fix_count > 0 && "Trying to unfix page that is not fixed");
+        // the dirty flag is set before the fix is released, so an evicting thread sees it
+        if (dirty)
+        {
+            if (in_operation())
+                log_update(frame);
+            set_dirty(frame);
+        }
+        frame->fix_count--;
     }
 }
 
-void BufferManager::unfix_page(uint64_t page_id, bool dirty)
+void BufferManager::latch_page(BHeader *header, bool exclusive)
+{
+    BFrame *frame = get_frame(header);
+    if (exclusive)
+        frame->latch.lock();
+    else
+        frame->latch.lock_shared();
+}
+
+void BufferManager::unlatch_page(BHeader *header, bool exclusive)
 {
-    std::map<uint64_t, BFrame *>::iterator it = page_id_map.find(page_id);
-    if (it != page_id_map.end())
+    BFrame *frame = get_frame(header);
+    if (exclusive)
+        frame->latch.unlock();
+    else
+        frame->latch.unlock_shared();
+}
+
+uint64_t BufferManager::read_version(BHeader *header)
+{
+    BFrame *frame = get_frame(header);
+    uint64_t version = frame->version.load(std::memory_order_acquire);
+    while (version & 1)
     {
-        assert(it->second->fix_count == 1 && "Trying to unfix page that is not fixed with 1");
-        it->second->fix_count--;
-        it->second->dirty = it->second->dirty || dirty;
+        std::this_thread::yield();
+        version = frame->version.load(std::memory_order_acquire);
     }
+    return version;
 }
 
-BFrame *BufferManager::evict_page()
+bool BufferManager::validate_version(BHeader *header, uint64_t version)
 {
-    //  Randomly access a page from the map and evict if unmarked - if marked, set to unmark and try next page
-    while (true)
+    // the reads of the page must not move behind the second read of the version
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return get_frame(header)->version.load(std::memory_order_relaxed) == version;
+}
+
+void BufferManager::lock_version(BHeader *header)
+{
+    BFrame *frame = get_frame(header);
+    uint64_t version = frame->version.load(std::memory_order_relaxed);
+    while ((version & 1) || !frame->version.compare_exchange_weak(version, version + 1, std::memory_order_acquire))
+    {
+        if (version & 1)
+        {
+            std::this_thread::yield();
+            version = frame->version.load(std::memory_order_relaxed);
+        }
+    }
+    // the changes to the page must not move in front of the locked version
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void BufferManager::unlock_version(BHeader *header)
+{
+    get_frame(header)->version.fetch_add(1, std::memory_order_release);
+}
+
+BFrame *BufferManager::get_free_frame(uint64_t page_id)
+{
+    // check if buffer is full and then evict pages
+    if (free_frames.empty())
     {
-        int random_index = dist(rd) % current_buffer_size;
-        std::map<uint64_t, BFrame *>::iterator it = page_id_map.begin();
-        std::advance(it, random_index);
+        return evict_page(page_id);
+    }
+    BFrame *frame = frames[free_frames.back()];
+    free_frames.pop_back();
+    current_buffer_size++;
+    return frame;
+}
 
-        if (it->second->fix_count == 0)
+BFrame *BufferManager::evict_page(uint64_t page_id)
+{
+    while (true)
+    {
+        uint64_t frame_index = replacement_policy->choose_victim(page_id);
+        if (frame_index == ReplacementPolicy::no_victim)
         {
-            if (it->second->marked)
+            logger->error("No page can be evicted, all pages in the buffer are fixed.");
+            exit(1);
+        }
+        BFrame *frame = frames[frame_index];
+        {
+            PageTableShard &shard = get_shard(frame->page_id);
+            std::lock_guard<std::mutex> guard(shard.mutex);
+            if (frame->fix_count == 0)
             {
-                it->second->marked = false;
+                shard.table.erase(frame->page_id);
             }
             else
             {
-                if (it->second->dirty)
-                {
-                    storage_manager->save_page(&it->second->header);
-                }
-                BFrame *frame = it->second;
-                page_id_map.erase(it->first);
-                return frame;
+                frame = nullptr;
             }
         }
+        if (!frame)
+        {
+            // the page was fixed by another thread after it was chosen, hand it back to the policy and choose again
+            replacement_policy->on_insert(frame_index, frames[frame_index]->page_id);
+            continue;
+        }
+
+        // the page is not reachable through the page table anymore, so nobody else accesses the frame
+        if (frame->dirty)
+        {
+            std::lock_guard<std::mutex> storage_guard(storage_mutex);
+            save_page(&frame->header);
+            clear_dirty(frame);
+            dirty_eviction_count++;
+            // the flusher fell behind, wake it up
+            flusher_condition.notify_one();
+        }
+        eviction_count++;
+        return frame;
     }
 }
 
-void BufferManager::fetch_page_from_disk(uint64_t page_id)
+BFrame *BufferManager::fetch_page_from_disk(uint64_t page_id)
+{
+    BFrame *frame_address = get_free_frame(page_id);
+    // the page is fixed before it becomes visible to other threads
+    frame_address->fix_count = 1;
+    frame_address->page_id = page_id;
+    {
+        std::lock_guard<std::mutex> storage_guard(storage_mutex);
+        load_page(&frame_address->header, page_id);
+    }
+    assert((page_id == frame_address->header.page_id) && "Page_id requested and page_id from disk are not equal.");
+    replacement_policy->on_insert(frame_address->index, page_id);
+
+    PageTableShard &shard = get_shard(page_id);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    shard.table.insert(page_id, frame_address);
+    return frame_address;
+}
+
+void BufferManager::mark_dirty(uint64_t page_id)
 {
-    BFrame *frame_address;
-    if (current_buffer_size >= buffer_size)
+    BFrame *frame = find_frame(page_id);
+    if (frame)
     {
-        frame_address = evict_page();
+        if (in_operation())
+            log_update(frame);
+        set_dirty(frame);
+    }
+}
+
+void BufferManager::set_write_ahead_log(WriteAheadLog *write_ahead_log_arg)
+{
+    write_ahead_log = write_ahead_log_arg;
+}
+
+void BufferManager::begin_operation()
+{
+    if (write_ahead_log)
+        operation_thread = std::this_thread::get_id();
+}
+
+void BufferManager::end_operation()
+{
+    if (!in_operation())
+        return;
+    write_ahead_log->end_operation();
+    operation_thread = std::thread::id();
+    for (auto &[page_id, image] : before_images)
+    {
+        spare_images.push_back(std::move(image));
+    }
+    before_images.clear();
+}
+
+void BufferManager::take_before_image(BFrame *frame, bool replace)
+{
+    auto it = before_images.find(frame->page_id);
+    if (it != before_images.end() && !replace)
+        return;
+    if (it == before_images.end())
+    {
+        if (spare_images.empty())
+        {
+            it = before_images.emplace(frame->page_id, std::make_unique<char[]>(page_size)).first;
+        }
+        else
+        {
+            it = before_images.emplace(frame->page_id, std::move(spare_images.back())).first;
+            spare_images.pop_back();
+        }
+    }
+    std::memcpy(it->second.get(), &frame->header, page_size);
+}
+
+void BufferManager::log_update(BFrame *frame)
+{
+    auto it = before_images.find(frame->page_id);
+    if (it == before_images.end())
+        return;
+    uint64_t lsn = write_ahead_log->append_update(&frame->header, it->second.get());
+    uint64_t no_lsn = 0;
+    // only the first change since the page was written decides where redo has to start
+    if (lsn != 0)
+        frame->rec_lsn.compare_exchange_strong(no_lsn, lsn);
+}
+
+void BufferManager::log_free(uint64_t page_id, BFrame *frame)
+{
+    // the before image holds the content as far as it is logged, changes after it were never logged and are lost with the page
+    auto it = before_images.find(page_id);
+    if (it != before_images.end())
+    {
+        write_ahead_log->append_free(page_id, it->second.get());
+        spare_images.push_back(std::move(it->second));
+        before_images.erase(it);
+    }
+    else if (frame)
+    {
+        write_ahead_log->append_free(page_id, reinterpret_cast<char *>(&frame->header));
     }
     else
     {
-        frame_address = (BFrame *)malloc(page_size + 8);
-        current_buffer_size++;
+        std::unique_ptr<char[]> page = std::make_unique<char[]>(page_size);
+        {
+            std::lock_guard<std::mutex> storage_guard(storage_mutex);
+            load_page(reinterpret_cast<BHeader *>(page.get()), page_id);
+        }
+        write_ahead_log->append_free(page_id, page.get());
     }
-    frame_address->fix_count = 0;
-    frame_address->dirty = false;
-    storage_manager->load_page(&frame_address->header, page_id);
-    assert((page_id == frame_address->header.page_id) && "Page_id requested and page_id from disk are not equal.");
-    page_id_map.emplace(page_id, frame_address);
 }
 
-void BufferManager::mark_dirty(uint64_t page_id)
+void BufferManager::checkpoint()
 {
-    std::map<uint64_t, BFrame *>::iterator it = page_id_map.find(page_id);
-    if (it != page_id_map.end())
+    if (!write_ahead_log)
+        return;
+    // pages that stayed dirty since before the previous checkpoint are written now, so redo never has to go back further than that
+    uint64_t previous_checkpoint_lsn = write_ahead_log->get_checkpoint_lsn();
+    std::vector<char> copies;
+    std::vector<BFrame *> old_frames;
+    for (BFrame *frame : frames)
+    {
+        uint64_t rec_lsn = frame->rec_lsn;
+        if (frame->dirty && rec_lsn != 0 && rec_lsn < previous_checkpoint_lsn)
+            old_frames.push_back(frame);
+    }
+    for (size_t start = 0; start < old_frames.size(); start += flush_batch_size)
     {
-        it->second->dirty = true;
+        std::vector<BHeader *> batch;
+        copies.resize(flush_batch_size * page_size);
+        std::unique_lock<std::mutex> miss_lock(miss_mutex);
+        std::lock_guard<std::mutex> storage_guard(storage_mutex);
+        for (size_t i = start; i < std::min(start + flush_batch_size, old_frames.size()); i++)
+        {
+            char *copy = copies.data() + batch.size() * page_size;
+            if (copy_dirty_frame(old_frames[i], copy))
+                batch.push_back(reinterpret_cast<BHeader *>(copy));
+        }
+        miss_lock.unlock();
+        if (!batch.empty())
+            save_pages(batch);
     }
+
+    // the oldest change that is only in the buffer is where redo starts, without one it starts at the checkpoint itself
+    uint64_t redo_lsn = write_ahead_log->get_end_lsn();
+    for (BFrame *frame : frames)
+    {
+        uint64_t rec_lsn = frame->rec_lsn;
+        if (frame->dirty && rec_lsn != 0)
+            redo_lsn = std::min(redo_lsn, rec_lsn);
+    }
+    std::vector<char> state;
+    {
+        std::lock_guard<std::mutex> storage_guard(storage_mutex);
+        state = storage_manager->get_state();
+    }
+    write_ahead_log->write_checkpoint(redo_lsn, state);
 }
 
 uint64_t BufferManager::get_current_buffer_size()
 {
     return current_buffer_size;
 }
+
+uint64_t BufferManager::get_eviction_count()
+{
+    return eviction_count;
+}
+
+uint64_t BufferManager::get_dirty_eviction_count()
+{
+    return dirty_eviction_count;
+}
+
+uint64_t BufferManager::get_flush_count()
+{
+    return flush_count;
+}
+
+uint64_t BufferManager::get_prefetch_count()
+{
+    return prefetch_count;
+}
+
+uint64_t BufferManager::get_prefetch_hit_count()
+{
+    return prefetch_hit_count;
+}
+
+uint64_t BufferManager::get_prefetch_miss_count()
+{
+    return prefetch_miss_count;
+}
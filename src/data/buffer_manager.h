@@ -9,10 +9,19 @@
 
 #include "../model/b_frame.h"
 #include "storage_manager.h"
+#include "write_ahead_log.h"
+#include "page_table.h"
+#include "replacement_policy.h"
 #include <stdint.h>
 #include <vector>
-#include <map>
-#include <random>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <cstddef>
 #include "spdlog/spdlog.h"
 
 /// forward declaration
@@ -20,24 +29,118 @@ class BufferManagerTest;
 class BPlusTreeTest;
 
 /**
- * @brief Handles the pages currently stored in memory
+ * @brief Handles the pages currently stored in memory. Pages in the buffer can be requested by many threads at the same time, loading and evicting pages is serialized
  */
 class BufferManager
 {
 
 private:
+    /**
+     * @brief Part of the page table with its own mutex, the page ids are distributed over the shards by their lowest bits
+     */
+    struct PageTableShard
+    {
+        std::mutex mutex;
+        PageTable table;
+
+        PageTableShard(uint64_t expected_entries_arg) : table(expected_entries_arg) {}
+    };
+
+    /// number of page table shards, a power of two
+    static constexpr uint64_t shard_count = 64;
+
     std::shared_ptr<spdlog::logger> logger;
     /// write and read to disc
     StorageManager *storage_manager;
     /// data structure for page id mapping
-    std::map<uint64_t, BFrame *> page_id_map;
+    std::vector<std::unique_ptr<PageTableShard>> page_id_map;
+    /// held while a page is loaded, created or evicted, protects the free frames and the victim selection
+    std::mutex miss_mutex;
+    /// serializes the access to the storage manager, taken after the miss mutex
+    std::mutex storage_mutex;
+    /// contiguous memory for all frames, reserved when the buffer manager is created
+    char *arena = nullptr;
+    /// size of the mapping behind the arena
+    size_t arena_size;
+    /// all frames of the arena, the replacement policy refers to them by their position
+    std::vector<BFrame *> frames;
+    /// positions of the frames that do not hold a page
+    std::vector<uint32_t> free_frames;
+    /// decides which page is evicted
+    std::unique_ptr<ReplacementPolicy> replacement_policy;
     /// information about how full the buffer is right now
-    uint64_t current_buffer_size = 0;
+    std::atomic<uint64_t> current_buffer_size{0};
+
+    /// number of pages that were evicted
+    std::atomic<uint64_t> eviction_count{0};
+
+    /// number of evicted pages that had to be written by the evicting thread
+    std::atomic<uint64_t> dirty_eviction_count{0};
+
+    /// number of frames that are dirty right now
+    std::atomic<uint64_t> dirty_count{0};
+
+    /// fraction of the frames the flusher keeps clean, 0 disables the flusher
+    double clean_fraction;
+
+    /// writes dirty pages in the background so evictions find clean victims
+    std::thread flusher;
+    /// tells the flusher to finish
+    std::atomic<bool> stop_flusher{false};
+    std::mutex flusher_mutex;
+    std::condition_variable flusher_condition;
+
+    /// number of pages written by the flusher
+    std::atomic<uint64_t> flush_count{0};
+
+    /// maximum number of pages the flusher writes before it checks the dirty count again
+    static constexpr uint64_t flush_batch_size = 64;
+
+    /// maximum number of leaves that are read ahead along the leaf chain, 0 disables prefetching
+    uint64_t prefetch_depth;
+
+    /// reads pages ahead into the prefetched pages, pages are only placed into frames by the threads that request them
+    std::thread prefetcher;
+    /// tells the prefetcher to finish
+    std::atomic<bool> stop_prefetcher{false};
+    /// protects the prefetch queue and the prefetched pages, taken after the storage mutex
+    std::mutex prefetch_mutex;
+    std::condition_variable prefetch_condition;
+
+    /// pages that should be read ahead together with the number of leaves that should be followed from them
+    std::deque<std::pair<uint64_t, uint64_t>> prefetch_queue;
+    /// page ids in the prefetch queue
+    std::unordered_set<uint64_t> queued_page_ids;
+
+    /// copies of pages that were read ahead and not requested yet
+    std::unordered_map<uint64_t, std::unique_ptr<char[]>> prefetched_pages;
+    /// order in which the pages were read ahead, the oldest ones are dropped first
+    std::deque<uint64_t> prefetch_order;
+
+    /// maximum number of prefetched pages that are kept
+    static constexpr uint64_t prefetch_capacity = 64;
+
+    /// maximum number of queued pages the prefetcher reads together
+    static constexpr uint64_t prefetch_batch_size = 16;
 
-    /// random number generator used for eviction of pages
-    std::random_device rd;
-    /// distributen associated with random number generator
-    std::uniform_int_distribution<int> dist;
+    /// number of pages that were read ahead
+    std::atomic<uint64_t> prefetch_count{0};
+    /// number of requests that were served from a prefetched page
+    std::atomic<uint64_t> prefetch_hit_count{0};
+    /// number of prefetched pages that were dropped before they were requested
+    std::atomic<uint64_t> prefetch_miss_count{0};
+
+    /// logs the changes to the pages, nullptr if no log is written
+    WriteAheadLog *write_ahead_log = nullptr;
+
+    /// thread that runs the current operation, its changes to the pages are logged while it runs. Other threads can read pages at the same time
+    std::atomic<std::thread::id> operation_thread{};
+
+    /// content of the pages the running operation fixed, as it was when they were last logged
+    std::unordered_map<uint64_t, std::unique_ptr<char[]>> before_images;
+
+    /// memory of the before images of finished operations, reused by the next ones
+    std::vector<std::unique_ptr<char[]>> spare_images;
 
     /// how many pages will be stored in the buffer manager
     uint64_t buffer_size;
@@ -45,17 +148,173 @@ private:
     /// the size of the page
     int page_size;
 
+    /// the size of a frame, the page plus the information stored in front of the header
+    size_t frame_size;
+
+    /// distance between two frames in the arena, the frame size rounded up to a cache line
+    size_t frame_stride;
+
+    /**
+     * @brief Reserves the arena for all frames, backed by huge pages if requested and available
+     * @param huge_pages If huge pages should be used
+     */
+    void allocate_arena(bool huge_pages);
+
+    /**
+     * @brief Sets the dirty flag of a frame and keeps track of the number of dirty frames
+     * @param frame The frame
+     */
+    void set_dirty(BFrame *frame)
+    {
+        if (!frame->dirty.exchange(true))
+            dirty_count++;
+    }
+
+    /**
+     * @brief Clears the dirty flag of a frame and keeps track of the number of dirty frames
+     * @param frame The frame
+     */
+    void clear_dirty(BFrame *frame)
+    {
+        if (frame->dirty.exchange(false))
+            dirty_count--;
+        frame->rec_lsn = 0;
+    }
+
+    /**
+     * @brief Copies a page before the running operation changes it, pages that were copied before keep their copy
+     * @param frame The frame of the page
+     * @param replace If an existing copy is replaced, used for new pages
+     */
+    void take_before_image(BFrame *frame, bool replace = false);
+
+    /**
+     * @brief Logs the changes to a page since its before image was taken
+     * @param frame The frame of the page
+     */
+    void log_update(BFrame *frame);
+
+    /**
+     * @brief Logs the deletion of a page together with its last logged content, so it can be brought back if the operation is rolled back
+     * @param page_id The page id
+     * @param frame The frame of the page, nullptr if it is not in the buffer
+     */
+    void log_free(uint64_t page_id, BFrame *frame);
+
+    /**
+     * @brief Loop of the flusher thread, sweeps over the frames and writes dirty pages while more frames than allowed are dirty
+     */
+    void run_flusher();
+
+    /**
+     * @brief Loop of the prefetcher thread, reads the queued pages and follows the leaf chain
+     */
+    void run_prefetcher();
+
+    /**
+     * @brief Waits until the log records of the latest changes to pages are durable, a page must not reach the disc before its log records
+     * @param headers The headers of the pages
+     */
+    void wait_for_log(const std::vector<BHeader *> &headers);
+
+    /**
+     * @brief Writes a page to disc and drops a prefetched copy of it, the storage mutex must be held
+     * @param header The header of the page
+     */
+    void save_page(BHeader *header);
+
+    /**
+     * @brief Writes several pages to disc in one batch and drops prefetched copies of them, the storage mutex must be held
+     * @param headers The headers of the pages
+     */
+    void save_pages(const std::vector<BHeader *> &headers);
+
+    /**
+     * @brief Stores a page that was read ahead and queues the next leaf if the leaf chain should be followed, the prefetch mutex must be held
+     * @param page_id The page id of the page
+     * @param page The copy of the page
+     * @param follow_leaves The number of following leaves that should be read ahead
+     */
+    void add_prefetched_page(uint64_t page_id, std::unique_ptr<char[]> page, uint64_t follow_leaves);
+
+    /**
+     * @brief Reads a page into a frame, takes a prefetched copy if there is one, the storage mutex must be held
+     * @param header The header of the frame
+     * @param page_id The page id of the page
+     */
+    void load_page(BHeader *header, uint64_t page_id);
+
+    /**
+     * @brief Copies a dirty unfixed page and marks the frame clean, the miss and storage mutex must be held until the copy is written
+     * @param frame The frame
+     * @param copy Memory for the copy of the page
+     * @return true if the page was copied, false if it was fixed, clean or not in the buffer anymore
+     */
+    bool copy_dirty_frame(BFrame *frame, char *copy);
+
+    /**
+     * @brief Returns the shard of the page table that is responsible for a page
+     * @param page_id The page id of the page
+     * @return The shard
+     */
+    PageTableShard &get_shard(uint64_t page_id)
+    {
+        return *page_id_map[page_id & (shard_count - 1)];
+    }
+
+    /**
+     * @brief Looks up a page in the page table
+     * @param page_id The page id of the page
+     * @return The frame of the page, nullptr if the page is not in the buffer
+     */
+    BFrame *find_frame(uint64_t page_id);
+
+    /**
+     * @brief Fixes a page if it is in the buffer
+     * @param page_id The page id of the page
+     * @return The frame of the page, nullptr if the page is not in the buffer
+     */
+    BFrame *fix_if_present(uint64_t page_id);
+
+    /**
+     * @brief Returns the frame that contains a page
+     * @param header The header of the page
+     * @return The frame
+     */
+    static BFrame *get_frame(BHeader *header)
+    {
+        return reinterpret_cast<BFrame *>(reinterpret_cast<char *>(header) - offsetof(BFrame, header));
+    }
+
+    /**
+     * @brief Returns if the calling thread runs an operation whose changes are logged
+     * @return true if the changes of the thread are logged
+     */
+    bool in_operation()
+    {
+        return operation_thread.load(std::memory_order_relaxed) == std::this_thread::get_id();
+    }
+
     /**
      * @brief Get a specific page from disc
      * @param page_id The page id of the page that should be retreived
+     * @return The frame the page was loaded into
      */
-    void fetch_page_from_disk(uint64_t page_id);
+    BFrame *fetch_page_from_disk(uint64_t page_id);
+
+    /**
+     * @brief Returns a frame that can be used for a new page, either takes one from the free frames or evicts a page if the buffer is full
+     * @param page_id The page id of the page that will be placed into the frame
+     * @return The frame
+     */
+    BFrame *get_free_frame(uint64_t page_id);
 
     /**
      * @brief Removes pages from memory to free space for further pages
+     * @param page_id The page id of the page that will be placed into the frame
      * @returns A free frame that can be used to write again
      */
-    BFrame *evict_page();
+    BFrame *evict_page(uint64_t page_id);
 
 public:
     friend class BufferManagerTest;
@@ -66,8 +325,15 @@ public:
      * @param storage_manager_arg A reference to the storage manager
      * @param buffer_size_arg The size of the buffer
      * @param page_size_arg The size of the page that needs to be allocated
+     * @param buffer_policy_arg The replacement policy, one of 'clock', 'lru-k', '2q' or 'arc'
+     * @param huge_pages_arg If the frames should be backed by huge pages
+     * @param clean_fraction_arg Fraction of the frames a background thread keeps clean, 0 disables the background thread
+     * @param prefetch_depth_arg Maximum number of leaves read ahead along the leaf chain, 0 disables prefetching
      */
-    BufferManager(StorageManager *storage_manager_arg, uint64_t buffer_size_arg, int page_size_arg);
+    BufferManager(StorageManager *storage_manager_arg, uint64_t buffer_size_arg, int page_size_arg, const std::string &buffer_policy_arg = "clock", bool huge_pages_arg = false, double clean_fraction_arg = 0, uint64_t prefetch_depth_arg = 0);
+
+    /// offset of the id of the next leaf in a leaf page, used to follow the leaf chain when reading ahead
+    static constexpr size_t next_leaf_offset = 24;
 
     /**
      * @brief Request a page
@@ -76,6 +342,13 @@ public:
      */
     BHeader *request_page(uint64_t page_id);
 
+    /**
+     * @brief Hints that a page will be requested soon, the page is read ahead in the background if it is not in the buffer
+     * @param page_id The page id of the page
+     * @param follow_leaves If the page is a leaf, the number of following leaves in the leaf chain that are read ahead as well
+     */
+    void prefetch_page(uint64_t page_id, uint64_t follow_leaves = 0);
+
     /**
      * @brief Creates a new page
      * @return A pointer to the page
@@ -83,30 +356,104 @@ public:
     BHeader *create_new_page();
 
     /**
-     * @brief Deletes a page from the buffer
+     * @brief Deletes a page, its frame goes back to the free frames and its page id can be given to a new page. The page must not be fixed
      * @param page_id The page id from the page that should be deleted
      */
     void delete_page(uint64_t page_id);
 
     /**
-     * @brief Fixes a page, so no other thread modify it
+     * @brief Returns the page id the next new page gets
+     * @return the lowest page id that is not in use
+     */
+    uint64_t peek_unused_page_id();
+
+    /**
+     * @brief Cuts the free pages at the end off the data file, waits for the log first so the deletions of these pages are durable
+     * @return the number of pages that were cut off
+     */
+    uint64_t truncate();
+
+    /**
+     * @brief Fixes a page, so it is not evicted while it is used. A page can be fixed by several threads at the same time
      * @param page_id The page id of the page that should be fixed
      */
     void fix_page(uint64_t page_id);
 
     /**
-     * @brief Unfixes a page and enables other threads to modify it again
+     * @brief Unfixes a page, once all fixes are released the page can be evicted again
      * @param page_id The page id of the page that should be fixed
      * @param dirty Specifies if the page corresponding to page_id has been modified
      */
     void unfix_page(uint64_t page_id, bool dirty);
 
+    /**
+     * @brief Latches a fixed page, any number of threads can hold the shared latch, the exclusive latch is held by one thread alone
+     * @param header The header of the page
+     * @param exclusive If the latch is taken exclusive to modify the page
+     */
+    void latch_page(BHeader *header, bool exclusive);
+
+    /**
+     * @brief Releases the latch of a page, must be called before the page is unfixed
+     * @param header The header of the page
+     * @param exclusive If the latch was taken exclusive
+     */
+    void unlatch_page(BHeader *header, bool exclusive);
+
+    /**
+     * @brief Starts an optimistic read of a fixed page, waits while a writer changes the page
+     * @param header The header of the page
+     * @return the version of the page, the read is valid if it is still the same afterwards
+     */
+    uint64_t read_version(BHeader *header);
+
+    /**
+     * @brief Finishes an optimistic read of a fixed page
+     * @param header The header of the page
+     * @param version The version returned by read_version
+     * @return true if no writer changed the page since the read started, otherwise the read has to be repeated
+     */
+    bool validate_version(BHeader *header, uint64_t version);
+
+    /**
+     * @brief Locks the version of a fixed page before it is changed, so optimistic readers repeat their reads. Other writers wait
+     * @param header The header of the page
+     */
+    void lock_version(BHeader *header);
+
+    /**
+     * @brief Unlocks the version of a page after it was changed
+     * @param header The header of the page
+     */
+    void unlock_version(BHeader *header);
+
     /**
      * @brief Marks a page dirty
      * @param page_id The page id of the page that should be fixed
      */
     void mark_dirty(uint64_t page_id);
 
+    /**
+     * @brief Sets the log the changes to the pages are written to
+     * @param write_ahead_log_arg The log
+     */
+    void set_write_ahead_log(WriteAheadLog *write_ahead_log_arg);
+
+    /**
+     * @brief Starts an operation, the pages it fixes are copied so their changes can be logged. Operations are run by one thread at a time
+     */
+    void begin_operation();
+
+    /**
+     * @brief Finishes an operation, all its changes are logged and marked as complete
+     */
+    void end_operation();
+
+    /**
+     * @brief Writes a fuzzy checkpoint to the log. Pages that stayed dirty since before the previous checkpoint are written first, the others stay in the buffer, so the log that is replayed after a crash stays short without stopping the operations for long
+     */
+    void checkpoint();
+
     /**
      * @brief Function that needs to be called before exiting the program, saved all pages to the disc, important to be called before the storage manager is destroyed
      */
@@ -117,4 +464,40 @@ public:
      * @return the size of the buffer
      */
     uint64_t get_current_buffer_size();
+
+    /**
+     * @brief Returns the number of pages evicted so far
+     * @return the number of evictions
+     */
+    uint64_t get_eviction_count();
+
+    /**
+     * @brief Returns the number of evicted pages that were dirty and had to be written during the eviction
+     * @return the number of dirty evictions
+     */
+    uint64_t get_dirty_eviction_count();
+
+    /**
+     * @brief Returns the number of pages written by the background flusher
+     * @return the number of flushed pages
+     */
+    uint64_t get_flush_count();
+
+    /**
+     * @brief Returns the number of pages that were read ahead
+     * @return the number of prefetched pages
+     */
+    uint64_t get_prefetch_count();
+
+    /**
+     * @brief Returns the number of requests that were served from a prefetched page
+     * @return the number of prefetch hits
+     */
+    uint64_t get_prefetch_hit_count();
+
+    /**
+     * @brief Returns the number of prefetched pages that were dropped before they were requested
+     * @return the number of prefetch misses
+     */
+    uint64_t get_prefetch_miss_count();
 };
\ No newline at end of file
@@ -9,6 +9,7 @@
 
 #include "buffer_manager.h"
 #include "storage_manager.h"
+#include "write_ahead_log.h"
 #include "../radix_tree/radix_tree.h"
 #include "../configuration.h"
 #include "../bplus_tree/bplus_tree.h"
@@ -24,15 +25,64 @@ class DataManager
 private:
     /// path were files related to the DB should be saved
     std::filesystem::path base_path = "./db";
+    /// name of the log file
+    std::filesystem::path log_file = "wal.log";
 
     std::shared_ptr<spdlog::logger> logger;
 
     StorageManager *storage_manager;
     BufferManager *buffer_manager;
+    WriteAheadLog *write_ahead_log = nullptr;
 
-    BPlusTree<PAGE_SIZE> *bplus_tree;
+    BPlusTree<PAGE_SIZE> *bplus_tree = nullptr;
     RadixTree<PAGE_SIZE> *radix_tree = nullptr;
 
+    /// root of the tree when the running operation started, a changed root is logged when it ends
+    uint64_t operation_root_id = 0;
+
+    /// the log takes the changes of one operation at a time, operations of several threads wait for each other while it is written
+    std::mutex operation_mutex;
+
+    /// if the database was brought back to a consistent state from the log when it was opened
+    bool recovered = false;
+
+    /**
+     * @brief Starts an operation that changes the tree, its changes to the pages are logged
+     */
+    void begin_operation()
+    {
+        if (!write_ahead_log)
+            return;
+        operation_mutex.lock();
+        operation_root_id = bplus_tree ? bplus_tree->get_root_id() : 0;
+        buffer_manager->begin_operation();
+    }
+
+    /**
+     * @brief Finishes an operation that changes the tree and writes a checkpoint once enough log was written
+     */
+    void end_operation()
+    {
+        if (!write_ahead_log)
+            return;
+        if (bplus_tree->get_root_id() != operation_root_id)
+            write_ahead_log->append_root(operation_root_id, bplus_tree->get_root_id());
+        buffer_manager->end_operation();
+        if (write_ahead_log->needs_checkpoint())
+            checkpoint();
+        operation_mutex.unlock();
+    }
+
+    /**
+     * @brief Writes a checkpoint to the log
+     */
+    void checkpoint()
+    {
+        if (bplus_tree)
+            storage_manager->set_root_id(bplus_tree->get_root_id());
+        buffer_manager->checkpoint();
+    }
+
 public:
     friend class Debuger;
 
@@ -41,17 +91,52 @@ public:
      * @param buffer_size_arg The size of the buffer
      * @param cache_arg Whether cache is enabled
      * @param radix_tree_size_arg The size of the radix tree
+     * @param buffer_policy_arg The replacement policy of the buffer manager
+     * @param huge_pages_arg If the buffer should be backed by huge pages
+     * @param clean_fraction_arg Fraction of the buffer that is kept clean by the background flusher, 0 disables it
+     * @param prefetch_depth_arg Maximum number of leaves read ahead during scans, 0 disables prefetching
+     * @param direct_io_arg If the data file should bypass the page cache of the kernel
+     * @param io_uring_arg If pages should be read and written through io_uring
+     * @param mmap_arg If pages should be read from a memory mapping of the data file
+     * @param persistent_arg If an existing database should be opened again and kept when the data manager is destroyed
+     * @param wal_arg If the changes of inserts, updates and deletes should be written to a log, a persistent database is recovered from it after a crash
+     * @param wal_commit_interval_arg Time in microseconds log records are collected before they are committed together, 0 makes every operation wait until its records are durable
+     * @param compression_arg If pages should be compressed in the data file
+     * @param packed_leaves_arg If the keys in the outer nodes of a new tree are packed
+     * @param indexed_inner_nodes_arg If the inner nodes of a new tree carry a search index behind their keys
+     * @param stripe_count_arg Number of data files the pages are striped across
+     * @param stripe_paths_arg Folders of the data files, stripes without one are placed in the base path
+     * @param base_path_arg The directory of the data file and the log
      */
-    DataManager(uint64_t buffer_size_arg, bool cache_arg, uint64_t radix_tree_size_arg)
+    DataManager(uint64_t buffer_size_arg, bool cache_arg, uint64_t radix_tree_size_arg, const std::string &buffer_policy_arg = "clock", bool huge_pages_arg = false, double clean_fraction_arg = 0, uint64_t prefetch_depth_arg = 0, bool direct_io_arg = false, bool io_uring_arg = false, bool mmap_arg = false, bool persistent_arg = false, bool wal_arg = false, uint64_t wal_commit_interval_arg = 0, bool compression_arg = false, bool packed_leaves_arg = false, bool indexed_inner_nodes_arg = false, uint64_t stripe_count_arg = 1, const std::vector<std::filesystem::path> &stripe_paths_arg = {}, std::filesystem::path base_path_arg = "./db") : base_path(base_path_arg)
     {
         logger = spdlog::get("logger");
-        storage_manager = new StorageManager(base_path, PAGE_SIZE);
-        buffer_manager = new BufferManager(storage_manager, buffer_size_arg, PAGE_SIZE);
+        storage_manager = new StorageManager(base_path, PAGE_SIZE, direct_io_arg, io_uring_arg, mmap_arg, persistent_arg, wal_arg, compression_arg, stripe_count_arg, stripe_paths_arg);
+        buffer_manager = new BufferManager(storage_manager, buffer_size_arg, PAGE_SIZE, buffer_policy_arg, huge_pages_arg, clean_fraction_arg, prefetch_depth_arg);
+        if (wal_arg)
+        {
+            write_ahead_log = new WriteAheadLog(base_path / log_file, PAGE_SIZE, wal_commit_interval_arg, persistent_arg);
+            recovered = write_ahead_log->recover(storage_manager);
+            if (storage_manager->is_recovery_needed())
+            {
+                logger->error("{} was not closed correctly and the log contains no checkpoint to recover it from", (base_path / log_file).string());
+                exit(1);
+            }
+            buffer_manager->set_write_ahead_log(write_ahead_log);
+            // recovery starts from here if the database crashes before the first regular checkpoint
+            checkpoint();
+        }
         if (cache_arg)
         {
             radix_tree = new RadixTree<PAGE_SIZE>(radix_tree_size_arg, buffer_manager);
         }
-        bplus_tree = new BPlusTree<PAGE_SIZE>(buffer_manager, radix_tree);
+        // the creation of the first root is logged like any other change
+        begin_operation();
+        if (storage_manager->is_reopened() && storage_manager->get_root_id() != 0)
+            bplus_tree = new BPlusTree<PAGE_SIZE>(buffer_manager, radix_tree, storage_manager->get_root_id());
+        else
+            bplus_tree = new BPlusTree<PAGE_SIZE>(buffer_manager, radix_tree, packed_leaves_arg, indexed_inner_nodes_arg);
+        end_operation();
     }
 
     /**
@@ -70,8 +155,23 @@ public:
      */
     void destroy()
     {
+        // a data file that is kept should not carry the holes of deleted pages into the next run, compressed pages are placed in slots independent of their page id
+        if (storage_manager->is_persistent() && !storage_manager->is_compressed() && storage_manager->peek_unused_page_id() < storage_manager->get_page_count())
+        {
+            uint64_t page_count = storage_manager->get_page_count();
+            compact();
+            logger->info("Compacted the data file from {} to {} pages", page_count, storage_manager->get_page_count());
+        }
+        storage_manager->set_root_id(bplus_tree->get_root_id());
         buffer_manager->destroy();
         storage_manager->destroy();
+        // the pages contain all logged operations now
+        if (write_ahead_log)
+        {
+            write_ahead_log->destroy();
+            delete write_ahead_log;
+            write_ahead_log = nullptr;
+        }
         if (radix_tree)
         {
             radix_tree->destroy();
@@ -82,19 +182,30 @@ public:
         delete bplus_tree;
     }
 
+    /**
+     * @brief Moves the pages of the tree into the free pages at the start of the data file and cuts the free pages at its end off. Runs between other operations, every move is logged as an operation of its own
+     * @return the number of pages that were cut off the data file
+     */
+    uint64_t compact()
+    {
+        begin_operation();
+        bplus_tree->compact([this]
+                            { end_operation(); begin_operation(); });
+        end_operation();
+        return buffer_manager->truncate();
+    }
+
     /**
      * @brief Delete an element from the tree
      * @param key The key that will be deleted
      */
     void delete_value(int64_t key)
     {
-        if (radix_tree)
-        {
-            if (radix_tree->delete_value(key))
-                return;
-        }
+        begin_operation();
         // automatically deleted in bplustree
-        bplus_tree->delete_value(key);
+        if (!radix_tree || !radix_tree->delete_value(key))
+            bplus_tree->delete_value(key);
+        end_operation();
     }
 
     /**
@@ -104,8 +215,28 @@ public:
      */
     void insert(int64_t key, int64_t value)
     {
+        begin_operation();
         // will be automatically added to cache if radix_tree object is passed
         bplus_tree->insert(key, value);
+        end_operation();
+    }
+
+    /**
+     * @brief Loads the empty tree with entries without inserting them one by one, every node that is written is logged as an operation of its own
+     * @param entries The keys and values, the keys must be unique. Entries that are not sorted yet are sorted in place
+     * @param fill_factor Fraction of the nodes that is filled, between 0.5 and 1
+     * @param sorted If the entries are sorted by their keys already, otherwise they are sorted in chunks on all cores first
+     */
+    void bulk_load(std::vector<std::pair<int64_t, int64_t>> &entries, double fill_factor, bool sorted = true)
+    {
+        begin_operation();
+        if (sorted)
+            bplus_tree->bulk_load(entries, fill_factor, [this]
+                                  { end_operation(); begin_operation(); });
+        else
+            bplus_tree->bulk_load_unsorted(entries, std::thread::hardware_concurrency(), fill_factor, [this]
+                                           { end_operation(); begin_operation(); });
+        end_operation();
     }
 
     /**
@@ -148,12 +279,10 @@ public:
      */
     void update(int64_t key, int64_t value)
     {
-        if (radix_tree)
-        {
-            if (radix_tree->update(key, value))
-                return;
-        }
-        bplus_tree->update(key, value);
+        begin_operation();
+        if (!radix_tree || !radix_tree->update(key, value))
+            bplus_tree->update(key, value);
+        end_operation();
     }
 
     /**
@@ -185,6 +314,95 @@ public:
         return 0;
     }
 
+    /**
+     * @brief Returns if an existing database was opened
+     * @return true if the tree of a previous run is available, false otherwise
+     */
+    bool is_reopened()
+    {
+        return storage_manager->is_reopened();
+    }
+
+    /**
+     * @brief Returns the number of records the tree was loaded with, kept across runs of a persistent database
+     * @return the number of records, 0 if the tree was changed after loading
+     */
+    uint64_t get_record_count()
+    {
+        return storage_manager->get_record_count();
+    }
+
+    /**
+     * @brief Sets the number of records the tree was loaded with
+     * @param record_count The number of records, 0 marks the tree as changed
+     */
+    void set_record_count(uint64_t record_count)
+    {
+        storage_manager->set_record_count(record_count);
+    }
+
+    /**
+     * @brief Tells the storage manager how pages are accessed, only has an effect if the data file is memory mapped
+     * @param sequential true if pages are mostly read in scans, false if they are mostly read by point lookups
+     */
+    void advise_access(bool sequential)
+    {
+        storage_manager->advise_access(sequential);
+    }
+
+    /**
+     * @brief Returns if the database was recovered from the log when it was opened
+     * @return true if it was recovered, false otherwise
+     */
+    bool is_recovered()
+    {
+        return recovered;
+    }
+
+    /**
+     * @brief Returns the number of bytes of the log that were read during recovery
+     * @return the number of bytes, 0 if no log is written
+     */
+    uint64_t get_log_replayed_size()
+    {
+        if (write_ahead_log)
+            return write_ahead_log->get_replayed_size();
+        return 0;
+    }
+
+    /**
+     * @brief Returns the number of changes that were applied again during recovery
+     * @return the number of changes, 0 if no log is written
+     */
+    uint64_t get_log_redone_count()
+    {
+        if (write_ahead_log)
+            return write_ahead_log->get_redone_count();
+        return 0;
+    }
+
+    /**
+     * @brief Returns the number of records of an incomplete operation that were rolled back during recovery
+     * @return the number of records, 0 if no log is written
+     */
+    uint64_t get_log_undone_count()
+    {
+        if (write_ahead_log)
+            return write_ahead_log->get_undone_count();
+        return 0;
+    }
+
+    /**
+     * @brief Returns the number of group commits of the log
+     * @return the number of commits, 0 if no log is written
+     */
+    uint64_t get_log_commit_count()
+    {
+        if (write_ahead_log)
+            return write_ahead_log->get_commit_count();
+        return 0;
+    }
+
     /**
      * @brief Returns the current size of the buffer
      * @return the size of the buffer
@@ -193,4 +411,49 @@ public:
     {
         return buffer_manager->get_current_buffer_size();
     }
+
+    /**
+     * @brief Returns the number of pages the buffer manager evicted so far
+     * @return the number of evictions
+     */
+    uint64_t get_eviction_count()
+    {
+        return buffer_manager->get_eviction_count();
+    }
+
+    /**
+     * @brief Returns the number of evicted pages that had to be written by the evicting operation
+     * @return the number of dirty evictions
+     */
+    uint64_t get_dirty_eviction_count()
+    {
+        return buffer_manager->get_dirty_eviction_count();
+    }
+
+    /**
+     * @brief Returns the number of pages that were read ahead
+     * @return the number of prefetched pages
+     */
+    uint64_t get_prefetch_count()
+    {
+        return buffer_manager->get_prefetch_count();
+    }
+
+    /**
+     * @brief Returns the number of requests that were served from a prefetched page
+     * @return the number of prefetch hits
+     */
+    uint64_t get_prefetch_hit_count()
+    {
+        return buffer_manager->get_prefetch_hit_count();
+    }
+
+    /**
+     * @brief Returns the number of prefetched pages that were dropped before they were requested
+     * @return the number of prefetch misses
+     */
+    uint64_t get_prefetch_miss_count()
+    {
+        return buffer_manager->get_prefetch_miss_count();
+    }
 };
\ No newline at end of file
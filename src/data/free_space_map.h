@@ -0,0 +1,285 @@
+/**
+ * @file    free_space_map.h
+ *
+ * @author  Matteo Wohlrapp
+ * @date    16.10.2026
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+/**
+ * @brief Bitmap of the free pages of the data file with a summary on top. A bit of a summary level is set if the word below it has a free page, so the lowest free page is found in one word per level instead of a scan over the whole bitmap
+ */
+class FreeSpaceMap
+{
+private:
+    /// number of bits in a word of every level
+    static constexpr uint64_t word_bits = 64;
+
+    /// levels[0] has one bit per page and 1 marks a free page, every level above has one bit per word of the level below, the last level is a single word
+    std::vector<std::vector<uint64_t>> levels;
+
+    /// number of pages covered by the bitmap, the pages behind it are free
+    uint64_t size = 0;
+
+    /**
+     * @brief Updates the summary bits above a word of the bitmap after it changed
+     * @param word_index The index of the word in the lowest level
+     */
+    void update_summary(uint64_t word_index)
+    {
+        for (size_t level = 1; level < levels.size(); level++)
+        {
+            uint64_t bit = uint64_t(1) << (word_index % word_bits);
+            uint64_t &word = levels[level][word_index / word_bits];
+            bool has_free = levels[level - 1][word_index] != 0;
+            // the levels above only change if this summary bit changes
+            if (has_free == ((word & bit) != 0))
+                return;
+            word ^= bit;
+            word_index /= word_bits;
+        }
+    }
+
+    /**
+     * @brief Builds the summary levels from the lowest level
+     */
+    void rebuild_summaries()
+    {
+        levels.resize(1);
+        while (levels.back().size() > 1)
+        {
+            const std::vector<uint64_t> &below = levels.back();
+            std::vector<uint64_t> summary((below.size() + word_bits - 1) / word_bits, 0);
+            for (uint64_t i = 0; i < below.size(); i++)
+            {
+                if (below[i] != 0)
+                    summary[i / word_bits] |= uint64_t(1) << (i % word_bits);
+            }
+            levels.push_back(std::move(summary));
+        }
+    }
+
+    /**
+     * @brief Finds the next set bit of a level
+     * @param level The level
+     * @param from The first bit that is checked
+     * @return The index of the bit, npos if there is none
+     */
+    uint64_t find_next_in_level(size_t level, uint64_t from) const
+    {
+        const std::vector<uint64_t> &words = levels[level];
+        uint64_t word_index = from / word_bits;
+        if (word_index >= words.size())
+            return npos;
+        uint64_t word = words[word_index] & (~uint64_t(0) << (from % word_bits));
+        if (word != 0)
+            return word_index * word_bits + __builtin_ctzll(word);
+        if (level + 1 == levels.size())
+            return npos;
+        // the summary points to the next word that is not empty
+        word_index = find_next_in_level(level + 1, word_index + 1);
+        if (word_index == npos)
+            return npos;
+        return word_index * word_bits + __builtin_ctzll(words[word_index]);
+    }
+
+    /**
+     * @brief Grows the bitmap so it covers a page, the size is at least doubled so growing stays cheap
+     * @param page_id The page id
+     */
+    void cover(uint64_t page_id)
+    {
+        if (page_id >= size)
+            resize(std::max(page_id + 1, 2 * size));
+    }
+
+public:
+    /// returned if no bit is found
+    static constexpr uint64_t npos = UINT64_MAX;
+
+    /**
+     * @brief Constructor for the free space map
+     * @param size_arg The number of pages that are covered at the start, all of them free
+     */
+    FreeSpaceMap(uint64_t size_arg = 0)
+    {
+        levels.emplace_back(1, 0);
+        resize(size_arg);
+    }
+
+    /**
+     * @brief Returns the number of pages covered by the bitmap
+     * @return the number of pages
+     */
+    uint64_t get_size() const
+    {
+        return size;
+    }
+
+    /**
+     * @brief Grows the bitmap, the added pages are free
+     * @param size_arg The new number of pages, smaller values are ignored
+     */
+    void resize(uint64_t size_arg)
+    {
+        if (size_arg <= size)
+            return;
+        std::vector<uint64_t> &words = levels[0];
+        words.resize(std::max<uint64_t>((size_arg + word_bits - 1) / word_bits, 1), 0);
+        for (uint64_t page_id = size; page_id < size_arg && page_id % word_bits != 0; page_id++)
+        {
+            words[page_id / word_bits] |= uint64_t(1) << (page_id % word_bits);
+        }
+        uint64_t first_full_word = (size + word_bits - 1) / word_bits;
+        for (uint64_t i = first_full_word; i < size_arg / word_bits; i++)
+        {
+            words[i] = ~uint64_t(0);
+        }
+        // the bits behind the end stay 0, so a search never ends up behind the bitmap
+        if (size_arg % word_bits != 0 && size_arg / word_bits >= first_full_word)
+            words[size_arg / word_bits] = (uint64_t(1) << (size_arg % word_bits)) - 1;
+        size = size_arg;
+        rebuild_summaries();
+    }
+
+    /**
+     * @brief Returns if a page is free, pages behind the bitmap are free
+     * @param page_id The page id
+     * @return true if the page is free, false otherwise
+     */
+    bool is_free(uint64_t page_id) const
+    {
+        if (page_id >= size)
+            return true;
+        return (levels[0][page_id / word_bits] >> (page_id % word_bits)) & 1;
+    }
+
+    /**
+     * @brief Returns if a page is free
+     * @param page_id The page id
+     * @return true if the page is free, false otherwise
+     */
+    bool operator[](uint64_t page_id) const
+    {
+        return is_free(page_id);
+    }
+
+    /**
+     * @brief Marks a page as free
+     * @param page_id The page id
+     */
+    void set_free(uint64_t page_id)
+    {
+        cover(page_id);
+        levels[0][page_id / word_bits] |= uint64_t(1) << (page_id % word_bits);
+        update_summary(page_id / word_bits);
+    }
+
+    /**
+     * @brief Marks a page as used
+     * @param page_id The page id
+     */
+    void set_used(uint64_t page_id)
+    {
+        cover(page_id);
+        levels[0][page_id / word_bits] &= ~(uint64_t(1) << (page_id % word_bits));
+        update_summary(page_id / word_bits);
+    }
+
+    /**
+     * @brief Finds the next free page
+     * @param from The first page that is checked
+     * @return The page id, the size of the bitmap if all pages in it from this one on are used
+     */
+    uint64_t find_next(uint64_t from) const
+    {
+        uint64_t page_id = from < size ? find_next_in_level(0, from) : npos;
+        return page_id == npos ? std::max(from, size) : page_id;
+    }
+
+    /**
+     * @brief Finds the lowest free page
+     * @return The page id, the size of the bitmap if all pages in it are used
+     */
+    uint64_t find_first() const
+    {
+        return find_next(0);
+    }
+
+    /**
+     * @brief Finds the lowest run of consecutive free pages, used to place pages that are written together next to each other
+     * @param count The number of pages
+     * @return The page id of the first page of the run, the run might reach behind the bitmap
+     */
+    uint64_t find_extent(uint64_t count) const
+    {
+        uint64_t start = find_first();
+        while (start < size)
+        {
+            // the run is followed word by word until it is long enough or a used page ends it
+            uint64_t end = start;
+            while (end < size && end - start < count)
+            {
+                uint64_t word = ~levels[0][end / word_bits] & (~uint64_t(0) << (end % word_bits));
+                if (word != 0)
+                {
+                    end = std::min(size, (end / word_bits) * word_bits + __builtin_ctzll(word));
+                    break;
+                }
+                end = (end / word_bits + 1) * word_bits;
+            }
+            if (end >= size || end - start >= count)
+                return start;
+            start = find_next(end + 1);
+        }
+        return start;
+    }
+
+    /**
+     * @brief Finds the highest used page, the pages behind it can be cut off the data file
+     * @return The page id, npos if all pages are free
+     */
+    uint64_t find_last_used() const
+    {
+        const std::vector<uint64_t> &words = levels[0];
+        for (uint64_t word_index = (size + word_bits - 1) / word_bits; word_index-- > 0;)
+        {
+            // the bits behind the end are 0 but belong to no page
+            uint64_t valid = (word_index + 1) * word_bits <= size ? ~uint64_t(0) : (uint64_t(1) << (size % word_bits)) - 1;
+            uint64_t used = ~words[word_index] & valid;
+            if (used != 0)
+                return word_index * word_bits + word_bits - 1 - __builtin_clzll(used);
+        }
+        return npos;
+    }
+
+    /**
+     * @brief Returns the words of the lowest level, bit i of the bitmap is bit i % 64 of word i / 64
+     * @return the words
+     */
+    const std::vector<uint64_t> &get_words() const
+    {
+        return levels[0];
+    }
+
+    /**
+     * @brief Replaces the content of the bitmap
+     * @param words The words of the lowest level, as returned by get_words
+     * @param size_arg The number of pages covered by the words
+     */
+    void assign(const uint64_t *words, uint64_t size_arg)
+    {
+        size = 0;
+        levels.assign(1, std::vector<uint64_t>(1, 0));
+        resize(size_arg);
+        std::copy(words, words + (size_arg + word_bits - 1) / word_bits, levels[0].begin());
+        if (size_arg % word_bits != 0)
+            levels[0][size_arg / word_bits] &= (uint64_t(1) << (size_arg % word_bits)) - 1;
+        rebuild_summaries();
+    }
+};
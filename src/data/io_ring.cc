@@ -0,0 +1,115 @@
+
+#include "io_ring.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+IoRing::IoRing(unsigned entries_arg)
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, entries_arg, &params);
+    if (fd < 0)
+        return;
+
+    // the submission and completion rings are mapped separately, this also works on kernels without a single mapping
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    cq_ring = mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    void *sqes_memory = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes_memory == MAP_FAILED)
+    {
+        if (sq_ring != MAP_FAILED)
+            munmap(sq_ring, sq_ring_size);
+        if (cq_ring != MAP_FAILED)
+            munmap(cq_ring, cq_ring_size);
+        if (sqes_memory != MAP_FAILED)
+            munmap(sqes_memory, sqes_size);
+        sq_ring = cq_ring = nullptr;
+        close(fd);
+        return;
+    }
+
+    char *sq = static_cast<char *>(sq_ring);
+    sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    sqes = static_cast<io_uring_sqe *>(sqes_memory);
+
+    char *cq = static_cast<char *>(cq_ring);
+    cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    entries = params.sq_entries;
+    ring_fd = fd;
+}
+
+IoRing::~IoRing()
+{
+    if (ring_fd == -1)
+        return;
+    munmap(sqes, sqes_size);
+    munmap(cq_ring, cq_ring_size);
+    munmap(sq_ring, sq_ring_size);
+    close(ring_fd);
+}
+
+void IoRing::prepare(int fd, char *buffer, unsigned length, uint64_t offset, bool write, uint64_t user_data)
+{
+    unsigned tail = *sq_tail + pending;
+    unsigned index = tail & *sq_mask;
+    io_uring_sqe *sqe = &sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = length;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    sq_array[index] = index;
+    pending++;
+}
+
+bool IoRing::submit()
+{
+    // the kernel only sees the new entries once the tail is published
+    __atomic_store_n(sq_tail, *sq_tail + pending, __ATOMIC_RELEASE);
+    unsigned to_submit = pending;
+    pending = 0;
+    while (to_submit > 0)
+    {
+        int submitted = syscall(__NR_io_uring_enter, ring_fd, to_submit, 0, 0, nullptr, 0);
+        if (submitted < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            // drop what the kernel did not take, the head tells how far it got
+            __atomic_store_n(sq_tail, __atomic_load_n(sq_head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+            return false;
+        }
+        to_submit -= submitted;
+    }
+    return true;
+}
+
+bool IoRing::wait_completion(uint64_t &user_data, int &result)
+{
+    unsigned head = *cq_head;
+    while (head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+    {
+        if (syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno != EINTR)
+            return false;
+    }
+    io_uring_cqe *cqe = &cqes[head & *cq_mask];
+    user_data = cqe->user_data;
+    result = cqe->res;
+    __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file    io_ring.h
+ *
+ * @author  Matteo Wohlrapp
+ * @date    16.10.2026
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <linux/io_uring.h>
+
+/**
+ * @brief Minimal io_uring submission and completion queue on top of the raw system calls, used by the storage manager to read and write many pages with one system call
+ */
+class IoRing
+{
+private:
+    /// file descriptor of the ring, -1 if the kernel does not support io_uring
+    int ring_fd = -1;
+
+    /// number of entries in the submission queue
+    unsigned entries = 0;
+
+    /// mapping of the submission queue ring
+    void *sq_ring = nullptr;
+    size_t sq_ring_size = 0;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+
+    /// mapping of the submission queue entries
+    io_uring_sqe *sqes = nullptr;
+    size_t sqes_size = 0;
+
+    /// mapping of the completion queue ring
+    void *cq_ring = nullptr;
+    size_t cq_ring_size = 0;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    io_uring_cqe *cqes;
+
+    /// number of entries that were prepared but not submitted yet
+    unsigned pending = 0;
+
+public:
+    /**
+     * @brief Sets up the ring, check is_available to see if the kernel supports it
+     * @param entries_arg Number of requests that can be prepared before they are submitted, rounded up to a power of two by the kernel
+     */
+    IoRing(unsigned entries_arg);
+
+    ~IoRing();
+
+    IoRing(const IoRing &) = delete;
+    IoRing &operator=(const IoRing &) = delete;
+
+    /**
+     * @brief Returns if the ring could be set up
+     * @return true if io_uring is available, false otherwise
+     */
+    bool is_available() const
+    {
+        return ring_fd != -1;
+    }
+
+    /**
+     * @brief Returns how many requests can be prepared before they have to be submitted
+     * @return the number of entries of the submission queue
+     */
+    unsigned get_entries() const
+    {
+        return entries;
+    }
+
+    /**
+     * @brief Adds a read or write to the submission queue, at most get_entries requests can be prepared before submit is called
+     * @param fd The file descriptor
+     * @param buffer The memory that is read into or written from
+     * @param length The number of bytes
+     * @param offset The offset in the file
+     * @param write If the request is a write, otherwise it is a read
+     * @param user_data Returned together with the result of the request
+     */
+    void prepare(int fd, char *buffer, unsigned length, uint64_t offset, bool write, uint64_t user_data);
+
+    /**
+     * @brief Hands all prepared requests to the kernel with one system call
+     * @return false if the requests could not be submitted, they are dropped in that case
+     */
+    bool submit();
+
+    /**
+     * @brief Takes the next completion from the completion queue, waits for it if none is there yet
+     * @param user_data The user data of the finished request
+     * @param result The number of transferred bytes or a negative error number
+     * @return false if waiting failed
+     */
+    bool wait_completion(uint64_t &user_data, int &result);
+};
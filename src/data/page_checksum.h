@@ -0,0 +1,210 @@
+/**
+ * @file    page_checksum.h
+ *
+ * @author  Matteo Wohlrapp
+ * @date    17.10.2026
+ */
+
+#pragma once
+
+#include "../model/b_header.h"
+#include <stdint.h>
+#include <cstddef>
+#include <cstring>
+#include <nmmintrin.h>
+
+/**
+ * @brief Computes the CRC32C checksum of pages, with the crc32 instruction of SSE4.2 if the processor has it and with a table otherwise.
+ * The checksum field of the header is skipped, so the checksum can be stored in the page it covers
+ */
+class PageChecksum
+{
+private:
+    /// reversed Castagnoli polynomial
+    static constexpr uint32_t polynomial = 0x82F63B78;
+
+    /// bytes of each of the three streams that are computed side by side, the crc32 instruction has a latency of three cycles but starts one every cycle
+    static constexpr uint64_t stream_size = 256;
+
+    /**
+     * @brief Returns the table for the byte-wise computation
+     * @return the remainder of every byte
+     */
+    static const uint32_t *get_table()
+    {
+        static const struct Table
+        {
+            uint32_t entries[256];
+            Table()
+            {
+                for (uint32_t byte = 0; byte < 256; byte++)
+                {
+                    uint32_t crc = byte;
+                    for (int bit = 0; bit < 8; bit++)
+                    {
+                        crc = (crc >> 1) ^ (polynomial & (~(crc & 1) + 1));
+                    }
+                    entries[byte] = crc;
+                }
+            }
+        } table;
+        return table.entries;
+    }
+
+    /**
+     * @brief Returns the tables that move a checksum over stream_size zero bytes, one for every byte of the checksum
+     * @return the tables
+     */
+    static const uint32_t (*get_shift_tables())[256]
+    {
+        static const struct Tables
+        {
+            uint32_t entries[4][256];
+            Tables()
+            {
+                const uint32_t *table = get_table();
+                for (int position = 0; position < 4; position++)
+                {
+                    for (uint32_t byte = 0; byte < 256; byte++)
+                    {
+                        uint32_t crc = byte << (8 * position);
+                        for (uint64_t i = 0; i < stream_size; i++)
+                        {
+                            crc = table[crc & 0xFF] ^ (crc >> 8);
+                        }
+                        entries[position][byte] = crc;
+                    }
+                }
+            }
+        } tables;
+        return tables.entries;
+    }
+
+    /**
+     * @brief Moves a checksum over stream_size zero bytes, the checksum of a stream that follows is combined with it by xor
+     * @param crc The checksum
+     * @return the moved checksum
+     */
+    static uint32_t shift(uint32_t crc)
+    {
+        const uint32_t(*tables)[256] = get_shift_tables();
+        return tables[0][crc & 0xFF] ^ tables[1][(crc >> 8) & 0xFF] ^ tables[2][(crc >> 16) & 0xFF] ^ tables[3][crc >> 24];
+    }
+
+    /**
+     * @brief Continues a checksum over bytes with the table
+     * @param crc The checksum so far
+     * @param data The bytes
+     * @param size The number of bytes
+     * @return the continued checksum
+     */
+    static uint32_t update_software(uint32_t crc, const char *data, uint64_t size)
+    {
+        const uint32_t *table = get_table();
+        for (uint64_t i = 0; i < size; i++)
+        {
+            crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return crc;
+    }
+
+    /**
+     * @brief Continues a checksum over bytes with the crc32 instruction, eight bytes at a time in three streams.
+     * The bytes are whole pages in memory that was already checked, the sanitizers would check every word again and make it several times slower
+     * @param crc The checksum so far
+     * @param data The bytes
+     * @param size The number of bytes
+     * @return the continued checksum
+     */
+    __attribute__((target("sse4.2"), no_sanitize("address", "undefined"))) static uint32_t update_hardware(uint32_t crc, const char *data, uint64_t size)
+    {
+        uint64_t wide_crc = crc;
+        uint64_t i = 0;
+        for (; i + 3 * stream_size <= size; i += 3 * stream_size)
+        {
+            uint64_t second_crc = 0;
+            uint64_t third_crc = 0;
+            for (uint64_t j = i; j < i + stream_size; j += 8)
+            {
+                uint64_t words[3];
+                std::memcpy(&words[0], data + j, 8);
+                std::memcpy(&words[1], data + j + stream_size, 8);
+                std::memcpy(&words[2], data + j + 2 * stream_size, 8);
+                wide_crc = _mm_crc32_u64(wide_crc, words[0]);
+                second_crc = _mm_crc32_u64(second_crc, words[1]);
+                third_crc = _mm_crc32_u64(third_crc, words[2]);
+            }
+            wide_crc = shift(shift(static_cast<uint32_t>(wide_crc)) ^ static_cast<uint32_t>(second_crc)) ^ static_cast<uint32_t>(third_crc);
+        }
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i, 8);
+            wide_crc = _mm_crc32_u64(wide_crc, word);
+        }
+        crc = static_cast<uint32_t>(wide_crc);
+        for (; i < size; i++)
+        {
+            crc = _mm_crc32_u8(crc, static_cast<uint8_t>(data[i]));
+        }
+        return crc;
+    }
+
+    /**
+     * @brief Continues a checksum over bytes
+     * @param crc The checksum so far
+     * @param data The bytes
+     * @param size The number of bytes
+     * @return the continued checksum
+     */
+    static uint32_t update(uint32_t crc, const char *data, uint64_t size)
+    {
+        static const bool hardware = __builtin_cpu_supports("sse4.2");
+        return hardware ? update_hardware(crc, data, size) : update_software(crc, data, size);
+    }
+
+public:
+    /**
+     * @brief Returns the checksum of a page, the checksum field of its header is not part of it
+     * @param header The page
+     * @param page_size The size of the page
+     * @return the checksum
+     */
+    static uint32_t compute(const BHeader *header, uint64_t page_size)
+    {
+        const char *page = reinterpret_cast<const char *>(header);
+        constexpr uint64_t field = offsetof(BHeader, checksum);
+        uint32_t crc = update(~uint32_t(0), page, field);
+        crc = update(crc, page + field + sizeof(uint32_t), page_size - field - sizeof(uint32_t));
+        return ~crc;
+    }
+
+    /**
+     * @brief Stores the checksum of a page in its header
+     * @param header The page
+     * @param page_size The size of the page
+     */
+    static void seal(BHeader *header, uint64_t page_size)
+    {
+        header->checksum = compute(header, page_size);
+    }
+
+    /**
+     * @brief Checks a page against the checksum in its header. A page of zeros is a hole that was never written and passes as well
+     * @param header The page
+     * @param page_size The size of the page
+     * @return if the page is intact
+     */
+    static bool verify(const BHeader *header, uint64_t page_size)
+    {
+        if (header->checksum == compute(header, page_size))
+            return true;
+        const char *page = reinterpret_cast<const char *>(header);
+        for (uint64_t i = 0; i < page_size; i++)
+        {
+            if (page[i] != 0)
+                return false;
+        }
+        return true;
+    }
+};
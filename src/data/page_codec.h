@@ -0,0 +1,139 @@
+/**
+ * @file    page_codec.h
+ *
+ * @author  Matteo Wohlrapp
+ * @date    17.10.2026
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <cstring>
+
+/**
+ * @brief Compresses pages for the data file. The page is read as 64 bit words, every word is replaced by its difference to the word before it and the differences are bit-packed in blocks with the width of the largest one.
+ * Sorted keys turn into small differences and the unused end of a node into zeros, words without order keep their width
+ */
+class PageCodec
+{
+private:
+    /// number of words that share one width
+    static constexpr uint64_t block_words = 16;
+
+    /**
+     * @brief Maps a difference to an unsigned number, small negative differences become small numbers as well
+     * @param value The difference
+     * @return the mapped difference
+     */
+    static uint64_t zigzag(uint64_t value)
+    {
+        return (value << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(value) >> 63);
+    }
+
+    /**
+     * @brief Reverses zigzag
+     * @param value The mapped difference
+     * @return the difference
+     */
+    static uint64_t unzigzag(uint64_t value)
+    {
+        return (value >> 1) ^ (~(value & 1) + 1);
+    }
+
+public:
+    /**
+     * @brief Returns the largest size compress can produce
+     * @param page_size The size of the page
+     * @return the size in bytes
+     */
+    static uint64_t max_compressed_size(uint64_t page_size)
+    {
+        uint64_t words = page_size / 8;
+        return (words + block_words - 1) / block_words + words * 8 + page_size % 8;
+    }
+
+    /**
+     * @brief Compresses a page
+     * @param page The page
+     * @param page_size The size of the page
+     * @param compressed Receives the compressed page, must hold max_compressed_size bytes
+     * @return the size of the compressed page
+     */
+    static uint64_t compress(const char *page, uint64_t page_size, char *compressed)
+    {
+        uint64_t words = page_size / 8;
+        uint64_t differences[block_words];
+        uint64_t previous = 0;
+        uint64_t position = 0;
+        for (uint64_t start = 0; start < words; start += block_words)
+        {
+            uint64_t count = words - start < block_words ? words - start : block_words;
+            uint64_t all_bits = 0;
+            for (uint64_t i = 0; i < count; i++)
+            {
+                uint64_t word;
+                std::memcpy(&word, page + (start + i) * 8, 8);
+                differences[i] = zigzag(word - previous);
+                all_bits |= differences[i];
+                previous = word;
+            }
+            int width = all_bits == 0 ? 0 : 64 - __builtin_clzll(all_bits);
+            compressed[position++] = static_cast<char>(width);
+
+            // at most 7 bits are left over before the next difference is added, so 128 bits always suffice
+            unsigned __int128 bits = 0;
+            int bit_count = 0;
+            for (uint64_t i = 0; i < count && width > 0; i++)
+            {
+                bits |= static_cast<unsigned __int128>(differences[i]) << bit_count;
+                bit_count += width;
+                while (bit_count >= 8)
+                {
+                    compressed[position++] = static_cast<char>(static_cast<uint8_t>(bits));
+                    bits >>= 8;
+                    bit_count -= 8;
+                }
+            }
+            if (bit_count > 0)
+                compressed[position++] = static_cast<char>(static_cast<uint8_t>(bits));
+        }
+        std::memcpy(compressed + position, page + words * 8, page_size % 8);
+        return position + page_size % 8;
+    }
+
+    /**
+     * @brief Restores a page from its compressed form
+     * @param compressed The compressed page
+     * @param page Receives the page
+     * @param page_size The size of the page
+     */
+    static void decompress(const char *compressed, char *page, uint64_t page_size)
+    {
+        uint64_t words = page_size / 8;
+        uint64_t previous = 0;
+        uint64_t position = 0;
+        for (uint64_t start = 0; start < words; start += block_words)
+        {
+            uint64_t count = words - start < block_words ? words - start : block_words;
+            int width = static_cast<uint8_t>(compressed[position++]);
+            uint64_t mask = width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+
+            unsigned __int128 bits = 0;
+            int bit_count = 0;
+            for (uint64_t i = 0; i < count; i++)
+            {
+                while (bit_count < width)
+                {
+                    bits |= static_cast<unsigned __int128>(static_cast<uint8_t>(compressed[position++])) << bit_count;
+                    bit_count += 8;
+                }
+                uint64_t difference = static_cast<uint64_t>(bits) & mask;
+                bits >>= width;
+                bit_count -= width;
+                previous += unzigzag(difference);
+                std::memcpy(page + (start + i) * 8, &previous, 8);
+            }
+        }
+        std::memcpy(page + words * 8, compressed + position, page_size % 8);
+    }
+};
@@ -0,0 +1,227 @@
+/**
+ * @file    page_table.h
+ *
+ * @author  Matteo Wohlrapp
+ * @date    16.10.2026
+ */
+
+#pragma once
+
+#include "../model/b_frame.h"
+#include <stdint.h>
+#include <vector>
+#include <cassert>
+
+/**
+ * @brief Flat open addressing hash table that maps page ids to the frames in the buffer, uses linear probing and backward shift deletion so no tombstones are needed
+ */
+class PageTable
+{
+private:
+    /**
+     * @brief A single slot of the table, page id and frame are stored next to each other so a probe only touches one cache line
+     */
+    struct Slot
+    {
+        /// page id of the page in the frame, empty_key if the slot is not used
+        uint64_t page_id;
+        /// frame that contains the page
+        BFrame *frame;
+    };
+
+    /// marks an unused slot, page ids are handed out from 1 upwards so this value is never used
+    static constexpr uint64_t empty_key = UINT64_MAX;
+
+    /// the slots of the table, the size is always a power of two
+    std::vector<Slot> slots;
+
+    /// used to wrap around at the end of the slots
+    uint64_t mask;
+
+    /// fibonacci hashing keeps the upper bits of the product, 64 - log2(number of slots)
+    int shift;
+
+    /// number of entries in the table
+    uint64_t count = 0;
+
+    /**
+     * @brief Computes the home slot of a page id with fibonacci hashing, consecutive page ids are spread over the whole table
+     * @param page_id The page id
+     * @return The index of the home slot
+     */
+    uint64_t home_slot(uint64_t page_id) const
+    {
+        return (page_id * 0x9E3779B97F4A7C15ull) >> shift;
+    }
+
+    /**
+     * @brief Doubles the capacity of the table and inserts all entries again
+     */
+    void grow()
+    {
+        std::vector<Slot> old_slots = std::move(slots);
+        slots.assign(old_slots.size() * 2, Slot{empty_key, nullptr});
+        mask = slots.size() - 1;
+        shift--;
+        count = 0;
+        for (Slot &slot : old_slots)
+        {
+            if (slot.page_id != empty_key)
+                insert(slot.page_id, slot.frame);
+        }
+    }
+
+public:
+    /**
+     * @brief Iterator over all occupied slots, only used for maintenance tasks like writing back all pages
+     */
+    class Iterator
+    {
+    private:
+        const Slot *current;
+        const Slot *end;
+
+        /**
+         * @brief Moves the iterator to the next occupied slot
+         */
+        void skip_empty()
+        {
+            while (current != end && current->page_id == empty_key)
+                current++;
+        }
+
+    public:
+        Iterator(const Slot *current_arg, const Slot *end_arg) : current(current_arg), end(end_arg)
+        {
+            skip_empty();
+        }
+
+        const Slot &operator*() const
+        {
+            return *current;
+        }
+
+        Iterator &operator++()
+        {
+            current++;
+            skip_empty();
+            return *this;
+        }
+
+        bool operator!=(const Iterator &other) const
+        {
+            return current != other.current;
+        }
+    };
+
+    /**
+     * @brief Constructor for the page table
+     * @param expected_entries_arg The number of entries the table has to hold, the table is sized so the load factor stays below 0.5
+     */
+    PageTable(uint64_t expected_entries_arg)
+    {
+        uint64_t capacity = 16;
+        shift = 60;
+        while (capacity < expected_entries_arg * 2)
+        {
+            capacity *= 2;
+            shift--;
+        }
+        slots.assign(capacity, Slot{empty_key, nullptr});
+        mask = capacity - 1;
+    }
+
+    /**
+     * @brief Looks up the frame of a page
+     * @param page_id The page id of the page
+     * @return The frame, nullptr if the page is not in the table
+     */
+    BFrame *find(uint64_t page_id) const
+    {
+        uint64_t index = home_slot(page_id);
+        while (true)
+        {
+            const Slot &slot = slots[index];
+            if (slot.page_id == page_id)
+                return slot.frame;
+            if (slot.page_id == empty_key)
+                return nullptr;
+            index = (index + 1) & mask;
+        }
+    }
+
+    /**
+     * @brief Inserts a page, the page must not be contained yet
+     * @param page_id The page id of the page
+     * @param frame The frame the page is stored in
+     */
+    void insert(uint64_t page_id, BFrame *frame)
+    {
+        assert(page_id != empty_key && "Inserting reserved page id into the page table");
+        // keep the load factor below 0.75 so probe sequences stay short
+        if ((count + 1) * 4 > slots.size() * 3)
+            grow();
+
+        uint64_t index = home_slot(page_id);
+        while (slots[index].page_id != empty_key)
+        {
+            assert(slots[index].page_id != page_id && "Page is already in the page table");
+            index = (index + 1) & mask;
+        }
+        slots[index] = Slot{page_id, frame};
+        count++;
+    }
+
+    /**
+     * @brief Removes a page from the table
+     * @param page_id The page id of the page
+     * @return true if the page was removed, false if it was not in the table
+     */
+    bool erase(uint64_t page_id)
+    {
+        uint64_t index = home_slot(page_id);
+        while (slots[index].page_id != page_id)
+        {
+            if (slots[index].page_id == empty_key)
+                return false;
+            index = (index + 1) & mask;
+        }
+
+        // shift following entries back into the hole as long as this does not move them in front of their home slot
+        uint64_t hole = index;
+        uint64_t next = (hole + 1) & mask;
+        while (slots[next].page_id != empty_key)
+        {
+            uint64_t home = home_slot(slots[next].page_id);
+            // distance of the entry to its home slot compared to the distance of the hole to the home slot
+            if (((next - home) & mask) >= ((next - hole) & mask))
+            {
+                slots[hole] = slots[next];
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+        slots[hole] = Slot{empty_key, nullptr};
+        count--;
+        return true;
+    }
+
+    /**
+     * @brief Returns the number of entries in the table
+     * @return the number of entries
+     */
+    uint64_t size() const
+    {
+        return count;
+    }
+
+    Iterator begin() const
+    {
+        return Iterator(slots.data(), slots.data() + slots.size());
+    }
+
+    Iterator end() const
+    {
+        return Iterator(slots.data() + slots.size(), slots.data() + slots.size());
+    }
+};
@@ -0,0 +1,387 @@
+#include "replacement_policy.h"
+#include <algorithm>
+#include <cassert>
+
+FrameList::FrameList(uint64_t capacity_arg) : prev(capacity_arg, none), next(capacity_arg, none), contained(capacity_arg, false), head(none), tail(none) {}
+
+void FrameList::push_front(uint64_t frame_index)
+{
+    assert(!contained[frame_index] && "Frame is already in the list");
+    prev[frame_index] = none;
+    next[frame_index] = head;
+    if (head != none)
+        prev[head] = frame_index;
+    else
+        tail = frame_index;
+    head = frame_index;
+    contained[frame_index] = true;
+    count++;
+}
+
+void FrameList::remove(uint64_t frame_index)
+{
+    assert(contained[frame_index] && "Frame is not in the list");
+    if (prev[frame_index] != none)
+        next[prev[frame_index]] = next[frame_index];
+    else
+        head = next[frame_index];
+    if (next[frame_index] != none)
+        prev[next[frame_index]] = prev[frame_index];
+    else
+        tail = prev[frame_index];
+    contained[frame_index] = false;
+    count--;
+}
+
+bool FrameList::contains(uint64_t frame_index)
+{
+    return contained[frame_index];
+}
+
+uint64_t FrameList::back()
+{
+    return tail;
+}
+
+uint64_t FrameList::previous(uint64_t frame_index)
+{
+    return prev[frame_index];
+}
+
+uint64_t FrameList::size()
+{
+    return count;
+}
+
+void GhostList::push_front(uint64_t page_id)
+{
+    remove(page_id);
+    page_ids.push_front(page_id);
+    positions[page_id] = page_ids.begin();
+}
+
+bool GhostList::remove(uint64_t page_id)
+{
+    auto it = positions.find(page_id);
+    if (it == positions.end())
+        return false;
+    page_ids.erase(it->second);
+    positions.erase(it);
+    return true;
+}
+
+void GhostList::pop_back()
+{
+    if (page_ids.empty())
+        return;
+    positions.erase(page_ids.back());
+    page_ids.pop_back();
+}
+
+bool GhostList::contains(uint64_t page_id)
+{
+    return positions.find(page_id) != positions.end();
+}
+
+uint64_t GhostList::size()
+{
+    return page_ids.size();
+}
+
+uint64_t ReplacementPolicy::unfixed_back(FrameList &list)
+{
+    uint64_t frame_index = list.back();
+    while (frame_index != FrameList::none && frames[frame_index]->fix_count > 0)
+    {
+        frame_index = list.previous(frame_index);
+    }
+    return frame_index;
+}
+
+std::unique_ptr<ReplacementPolicy> create_replacement_policy(const std::string &name, std::vector<BFrame *> &frames, uint64_t capacity)
+{
+    if (name == "clock")
+        return std::make_unique<ClockPolicy>(frames, capacity);
+    if (name == "lru-k")
+        return std::make_unique<LRUKPolicy>(frames, capacity);
+    if (name == "2q")
+        return std::make_unique<TwoQPolicy>(frames, capacity);
+    if (name == "arc")
+        return std::make_unique<ARCPolicy>(frames, capacity);
+    return nullptr;
+}
+
+void ClockPolicy::on_insert(uint64_t frame_index, uint64_t page_id)
+{
+    frames[frame_index]->marked = true;
+}
+
+void ClockPolicy::on_access(uint64_t frame_index)
+{
+    frames[frame_index]->marked = true;
+}
+
+uint64_t ClockPolicy::choose_victim(uint64_t page_id)
+{
+    // Sweep over the frames and take the first unfixed one that is unmarked - marked frames get a second chance and are unmarked
+    // After two full rotations every unfixed frame has been unmarked once, so the sweep only fails if all frames are fixed
+    for (uint64_t i = 0; i < 2 * frames.size(); i++)
+    {
+        uint64_t frame_index = clock_hand;
+        BFrame *frame = frames[frame_index];
+        clock_hand++;
+        if (clock_hand == frames.size())
+            clock_hand = 0;
+
+        if (frame->fix_count == 0)
+        {
+            if (frame->marked)
+                frame->marked = false;
+            else
+                return frame_index;
+        }
+    }
+    return no_victim;
+}
+
+void ClockPolicy::on_remove(uint64_t frame_index)
+{
+    // the hand only moves once no frame is free, so the frame is not chosen while it waits in the free frames
+    frames[frame_index]->marked = false;
+}
+
+void LRUKPolicy::record_access(uint64_t frame_index)
+{
+    std::array<uint64_t, k> &times = history[frame_index];
+    for (int i = k - 1; i > 0; i--)
+    {
+        times[i] = times[i - 1];
+    }
+    times[0] = ++time;
+    order.emplace(times[k - 1], times[0], frame_index);
+}
+
+void LRUKPolicy::on_insert(uint64_t frame_index, uint64_t page_id)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = retained_history.find(page_id);
+    if (it != retained_history.end())
+    {
+        history[frame_index] = it->second.first;
+        retained_history.erase(it);
+    }
+    else
+    {
+        history[frame_index].fill(0);
+    }
+    record_access(frame_index);
+}
+
+void LRUKPolicy::on_access(uint64_t frame_index)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    std::array<uint64_t, k> &times = history[frame_index];
+    // the frame might have been chosen as victim concurrently, it is handed back with on_insert in that case
+    if (order.erase(std::make_tuple(times[k - 1], times[0], frame_index)) == 0)
+        return;
+    record_access(frame_index);
+}
+
+uint64_t LRUKPolicy::choose_victim(uint64_t page_id)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    for (auto it = order.begin(); it != order.end(); it++)
+    {
+        uint64_t frame_index = std::get<2>(*it);
+        if (frames[frame_index]->fix_count > 0)
+            continue;
+        order.erase(it);
+
+        // keep the history of the evicted page so a page that comes back soon is not treated as new
+        uint64_t victim_page_id = frames[frame_index]->page_id;
+        retained_history[victim_page_id] = std::make_pair(history[frame_index], time);
+        retained_order.emplace_back(victim_page_id, time);
+        while (retained_order.size() > capacity)
+        {
+            auto retained = retained_history.find(retained_order.front().first);
+            // the page might have been retained again later, only drop the entry this record belongs to
+            if (retained != retained_history.end() && retained->second.second == retained_order.front().second)
+                retained_history.erase(retained);
+            retained_order.pop_front();
+        }
+        return frame_index;
+    }
+    return no_victim;
+}
+
+void LRUKPolicy::on_remove(uint64_t frame_index)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    std::array<uint64_t, k> &times = history[frame_index];
+    order.erase(std::make_tuple(times[k - 1], times[0], frame_index));
+}
+
+TwoQPolicy::TwoQPolicy(std::vector<BFrame *> &frames_arg, uint64_t capacity_arg) : ReplacementPolicy(frames_arg, capacity_arg), a1_in(capacity_arg), a_m(capacity_arg)
+{
+    // sizes recommended in the original paper, 25% of the buffer for a1_in and ghosts for half the buffer
+    k_in = std::max<uint64_t>(capacity / 4, 1);
+    k_out = std::max<uint64_t>(capacity / 2, 1);
+}
+
+void TwoQPolicy::on_insert(uint64_t frame_index, uint64_t page_id)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    if (a1_out.remove(page_id))
+        a_m.push_front(frame_index);
+    else
+        a1_in.push_front(frame_index);
+}
+
+void TwoQPolicy::on_access(uint64_t frame_index)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    // accesses to pages in a1_in are treated as correlated and do not change the position
+    if (a_m.contains(frame_index))
+    {
+        a_m.remove(frame_index);
+        a_m.push_front(frame_index);
+    }
+}
+
+uint64_t TwoQPolicy::choose_victim(uint64_t page_id)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    uint64_t frame_index = FrameList::none;
+    if (a1_in.size() > k_in)
+        frame_index = unfixed_back(a1_in);
+    if (frame_index == FrameList::none)
+    {
+        frame_index = unfixed_back(a_m);
+        if (frame_index != FrameList::none)
+        {
+            a_m.remove(frame_index);
+            return frame_index;
+        }
+        // every page in a_m is fixed, fall back to a1_in even if it is small
+        frame_index = unfixed_back(a1_in);
+        if (frame_index == FrameList::none)
+            return no_victim;
+    }
+
+    a1_in.remove(frame_index);
+    a1_out.push_front(frames[frame_index]->page_id);
+    while (a1_out.size() > k_out)
+    {
+        a1_out.pop_back();
+    }
+    return frame_index;
+}
+
+void TwoQPolicy::on_remove(uint64_t frame_index)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    // a deleted page never comes back, so it leaves no ghost behind
+    if (a1_in.contains(frame_index))
+        a1_in.remove(frame_index);
+    else if (a_m.contains(frame_index))
+        a_m.remove(frame_index);
+}
+
+void ARCPolicy::adapt(uint64_t page_id)
+{
+    if (b1.contains(page_id))
+    {
+        uint64_t delta = std::max<uint64_t>(b2.size() / b1.size(), 1);
+        p = std::min(p + delta, capacity);
+    }
+    else if (b2.contains(page_id))
+    {
+        uint64_t delta = std::max<uint64_t>(b1.size() / b2.size(), 1);
+        p = p > delta ? p - delta : 0;
+    }
+}
+
+void ARCPolicy::on_insert(uint64_t frame_index, uint64_t page_id)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    if (b1.contains(page_id) || b2.contains(page_id))
+    {
+        // ghost hit, the page was seen recently enough to count as frequently used
+        if (adapted_page_id != page_id)
+            adapt(page_id);
+        b1.remove(page_id);
+        b2.remove(page_id);
+        t2.push_front(frame_index);
+    }
+    else
+    {
+        // new page, keep the recency side at most c and the whole directory at most 2c
+        if (t1.size() + b1.size() >= capacity && b1.size() > 0)
+            b1.pop_back();
+        else if (t1.size() + t2.size() + b1.size() + b2.size() >= 2 * capacity && b2.size() > 0)
+            b2.pop_back();
+        t1.push_front(frame_index);
+    }
+    adapted_page_id = UINT64_MAX;
+}
+
+void ARCPolicy::on_access(uint64_t frame_index)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    if (t1.contains(frame_index))
+    {
+        t1.remove(frame_index);
+        t2.push_front(frame_index);
+    }
+    else if (t2.contains(frame_index))
+    {
+        t2.remove(frame_index);
+        t2.push_front(frame_index);
+    }
+}
+
+uint64_t ARCPolicy::choose_victim(uint64_t page_id)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    bool ghost_hit = b1.contains(page_id) || b2.contains(page_id);
+    if (ghost_hit)
+    {
+        adapt(page_id);
+        adapted_page_id = page_id;
+    }
+
+    // if t1 fills the whole buffer there is no room on the recency side for another ghost, the page is dropped completely
+    bool keep_ghost = ghost_hit || t1.size() < capacity;
+    bool from_t1 = t1.size() > 0 && (t1.size() > p || (b2.contains(page_id) && t1.size() == p));
+
+    FrameList &preferred = from_t1 ? t1 : t2;
+    FrameList &other = from_t1 ? t2 : t1;
+    GhostList *ghosts = from_t1 ? &b1 : &b2;
+    uint64_t frame_index = unfixed_back(preferred);
+    if (frame_index != FrameList::none)
+    {
+        preferred.remove(frame_index);
+    }
+    else
+    {
+        frame_index = unfixed_back(other);
+        if (frame_index == FrameList::none)
+            return no_victim;
+        other.remove(frame_index);
+        ghosts = from_t1 ? &b2 : &b1;
+    }
+
+    if (keep_ghost)
+        ghosts->push_front(frames[frame_index]->page_id);
+    return frame_index;
+}
+
+void ARCPolicy::on_remove(uint64_t frame_index)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    // a deleted page never comes back, so it leaves no ghost behind
+    if (t1.contains(frame_index))
+        t1.remove(frame_index);
+    else if (t2.contains(frame_index))
+        t2.remove(frame_index);
+}
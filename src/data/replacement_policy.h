@@ -0,0 +1,317 @@
+/**
+ * @file    replacement_policy.h
+ *
+ * @author  Matteo Wohlrapp
+ * @date    16.10.2026
+ */
+
+#pragma once
+
+#include "../model/b_frame.h"
+#include <stdint.h>
+#include <vector>
+#include <list>
+#include <set>
+#include <array>
+#include <deque>
+#include <tuple>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+
+/**
+ * @brief Intrusive doubly linked list over frame positions, the front holds the most recently inserted frame
+ */
+class FrameList
+{
+private:
+    std::vector<uint64_t> prev;
+    std::vector<uint64_t> next;
+    std::vector<bool> contained;
+    uint64_t head;
+    uint64_t tail;
+    uint64_t count = 0;
+
+public:
+    /// marks the end of the list
+    static constexpr uint64_t none = UINT64_MAX;
+
+    /**
+     * @brief Constructor for the frame list
+     * @param capacity_arg The maximum number of frames in the buffer
+     */
+    FrameList(uint64_t capacity_arg);
+
+    /**
+     * @brief Inserts a frame at the front of the list
+     * @param frame_index The position of the frame
+     */
+    void push_front(uint64_t frame_index);
+
+    /**
+     * @brief Removes a frame from the list
+     * @param frame_index The position of the frame
+     */
+    void remove(uint64_t frame_index);
+
+    /**
+     * @brief Checks if the frame is in the list
+     * @param frame_index The position of the frame
+     * @return true if it is contained, false otherwise
+     */
+    bool contains(uint64_t frame_index);
+
+    /**
+     * @brief Returns the frame at the back of the list
+     * @return The position of the frame, none if the list is empty
+     */
+    uint64_t back();
+
+    /**
+     * @brief Returns the frame that is one closer to the front of the list
+     * @param frame_index The position of the current frame
+     * @return The position of the previous frame, none if the current frame is at the front
+     */
+    uint64_t previous(uint64_t frame_index);
+
+    /**
+     * @brief Returns the number of frames in the list
+     * @return the number of frames
+     */
+    uint64_t size();
+};
+
+/**
+ * @brief List of page ids of evicted pages, used by the policies that keep a history beyond the buffer
+ */
+class GhostList
+{
+private:
+    std::list<uint64_t> page_ids;
+    std::unordered_map<uint64_t, std::list<uint64_t>::iterator> positions;
+
+public:
+    /**
+     * @brief Inserts a page id at the front of the list
+     * @param page_id The page id
+     */
+    void push_front(uint64_t page_id);
+
+    /**
+     * @brief Removes a page id from the list
+     * @param page_id The page id
+     * @return true if the page id was contained, false otherwise
+     */
+    bool remove(uint64_t page_id);
+
+    /**
+     * @brief Removes the page id at the back of the list
+     */
+    void pop_back();
+
+    /**
+     * @brief Checks if the page id is in the list
+     * @param page_id The page id
+     * @return true if it is contained, false otherwise
+     */
+    bool contains(uint64_t page_id);
+
+    /**
+     * @brief Returns the number of page ids in the list
+     * @return the number of page ids
+     */
+    uint64_t size();
+};
+
+/**
+ * @brief Interface for the page replacement policies of the buffer manager. The policies identify frames by their position in the frame array of the buffer manager.
+ * on_insert and choose_victim are only called while the buffer manager serializes misses, on_access is called concurrently by all threads that hit a page
+ */
+class ReplacementPolicy
+{
+protected:
+    /// the frames of the buffer manager, used to skip fixed frames and to read the page ids
+    std::vector<BFrame *> &frames;
+
+    /// the maximum number of frames in the buffer
+    uint64_t capacity;
+
+    /// protects the bookkeeping of policies that update shared lists on every access
+    std::mutex mutex;
+
+    /**
+     * @brief Finds the unfixed frame closest to the back of a list
+     * @param list The list
+     * @return The position of the frame, FrameList::none if all frames in the list are fixed
+     */
+    uint64_t unfixed_back(FrameList &list);
+
+public:
+    /// returned by choose_victim if every frame is fixed
+    static constexpr uint64_t no_victim = UINT64_MAX;
+
+    /**
+     * @brief Constructor for the replacement policy
+     * @param frames_arg The frames of the buffer manager
+     * @param capacity_arg The maximum number of frames in the buffer
+     */
+    ReplacementPolicy(std::vector<BFrame *> &frames_arg, uint64_t capacity_arg) : frames(frames_arg), capacity(capacity_arg) {}
+
+    virtual ~ReplacementPolicy() = default;
+
+    /**
+     * @brief Called when a page was placed into a frame, either loaded from disc or newly created
+     * @param frame_index The position of the frame
+     * @param page_id The page id of the page
+     */
+    virtual void on_insert(uint64_t frame_index, uint64_t page_id) = 0;
+
+    /**
+     * @brief Called when a page that is already in the buffer is accessed
+     * @param frame_index The position of the frame
+     */
+    virtual void on_access(uint64_t frame_index) = 0;
+
+    /**
+     * @brief Chooses an unfixed frame whose page will be evicted and removes it from the bookkeeping of the policy
+     * @param page_id The page id of the page that will be placed into the frame
+     * @return The position of the frame, no_victim if every frame is fixed
+     */
+    virtual uint64_t choose_victim(uint64_t page_id) = 0;
+
+    /**
+     * @brief Called when the page in a frame was deleted, the frame leaves the bookkeeping of the policy until a page is inserted into it again
+     * @param frame_index The position of the frame
+     */
+    virtual void on_remove(uint64_t frame_index) = 0;
+};
+
+/**
+ * @brief Creates the replacement policy with the given name
+ * @param name One of 'clock', 'lru-k', '2q' or 'arc'
+ * @param frames The frames of the buffer manager
+ * @param capacity The maximum number of frames in the buffer
+ * @return The policy, nullptr if the name is unknown
+ */
+std::unique_ptr<ReplacementPolicy> create_replacement_policy(const std::string &name, std::vector<BFrame *> &frames, uint64_t capacity);
+
+/**
+ * @brief Second chance policy, the hand sweeps over the frames and uses the marked bit of the frames as reference bit. Accesses only set the bit and need no lock
+ */
+class ClockPolicy : public ReplacementPolicy
+{
+private:
+    /// position of the clock hand in the frames
+    uint64_t clock_hand = 0;
+
+public:
+    ClockPolicy(std::vector<BFrame *> &frames_arg, uint64_t capacity_arg) : ReplacementPolicy(frames_arg, capacity_arg) {}
+
+    void on_insert(uint64_t frame_index, uint64_t page_id) override;
+    void on_access(uint64_t frame_index) override;
+    uint64_t choose_victim(uint64_t page_id) override;
+    void on_remove(uint64_t frame_index) override;
+};
+
+/**
+ * @brief LRU-2, evicts the page whose second most recent access is the oldest. Pages with only one access are evicted first, in LRU order. The access history of evicted pages is retained for as many pages as fit into the buffer
+ */
+class LRUKPolicy : public ReplacementPolicy
+{
+private:
+    /// the number of accesses that are tracked
+    static constexpr int k = 2;
+
+    /// logical clock that is increased with every access
+    uint64_t time = 0;
+
+    /// access times of the page in the frame, most recent first, 0 means no access
+    std::vector<std::array<uint64_t, k>> history;
+
+    /// frames ordered by the k-th most recent access and then by the most recent access
+    std::set<std::tuple<uint64_t, uint64_t, uint64_t>> order;
+
+    /// access history of evicted pages together with the time it was retained
+    std::unordered_map<uint64_t, std::pair<std::array<uint64_t, k>, uint64_t>> retained_history;
+
+    /// page ids and times in the order the history was retained, the oldest entries are dropped first
+    std::deque<std::pair<uint64_t, uint64_t>> retained_order;
+
+    /**
+     * @brief Adds an access to the history of a frame and inserts the frame into the order
+     * @param frame_index The position of the frame
+     */
+    void record_access(uint64_t frame_index);
+
+public:
+    LRUKPolicy(std::vector<BFrame *> &frames_arg, uint64_t capacity_arg) : ReplacementPolicy(frames_arg, capacity_arg), history(capacity_arg) {}
+
+    void on_insert(uint64_t frame_index, uint64_t page_id) override;
+    void on_access(uint64_t frame_index) override;
+    uint64_t choose_victim(uint64_t page_id) override;
+    void on_remove(uint64_t frame_index) override;
+};
+
+/**
+ * @brief Full version of 2Q. New pages enter a FIFO queue, pages that are accessed again after they were evicted from the FIFO queue are placed into an LRU queue
+ */
+class TwoQPolicy : public ReplacementPolicy
+{
+private:
+    /// FIFO queue for pages accessed once
+    FrameList a1_in;
+    /// LRU queue for hot pages
+    FrameList a_m;
+    /// page ids of pages evicted from a1_in
+    GhostList a1_out;
+
+    /// maximum size of a1_in before pages are taken from it
+    uint64_t k_in;
+    /// maximum size of a1_out
+    uint64_t k_out;
+
+public:
+    TwoQPolicy(std::vector<BFrame *> &frames_arg, uint64_t capacity_arg);
+
+    void on_insert(uint64_t frame_index, uint64_t page_id) override;
+    void on_access(uint64_t frame_index) override;
+    uint64_t choose_victim(uint64_t page_id) override;
+    void on_remove(uint64_t frame_index) override;
+};
+
+/**
+ * @brief Adaptive replacement cache, balances between a recency list and a frequency list depending on hits in the ghost lists of both
+ */
+class ARCPolicy : public ReplacementPolicy
+{
+private:
+    /// pages accessed once recently
+    FrameList t1;
+    /// pages accessed at least twice recently
+    FrameList t2;
+    /// page ids of pages evicted from t1
+    GhostList b1;
+    /// page ids of pages evicted from t2
+    GhostList b2;
+
+    /// target size of t1
+    uint64_t p = 0;
+
+    /// page id for which p was already adapted when choosing the victim
+    uint64_t adapted_page_id = UINT64_MAX;
+
+    /**
+     * @brief Adapts the target size of t1 if the page is in one of the ghost lists
+     * @param page_id The page id of the page that is inserted
+     */
+    void adapt(uint64_t page_id);
+
+public:
+    ARCPolicy(std::vector<BFrame *> &frames_arg, uint64_t capacity_arg) : ReplacementPolicy(frames_arg, capacity_arg), t1(capacity_arg), t2(capacity_arg) {}
+
+    void on_insert(uint64_t frame_index, uint64_t page_id) override;
+    void on_access(uint64_t frame_index) override;
+    uint64_t choose_victim(uint64_t page_id) override;
+    void on_remove(uint64_t frame_index) override;
+};
@@ -1,153 +1,940 @@
 
 #include "storage_manager.h"
-#include "../utils/file.h"
 #include <cstring>
 #include <cerrno>
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
-StorageManager::StorageManager(std::filesystem::path base_path_arg, int page_size_arg)
-    : base_path(base_path_arg), page_size(page_size_arg)
+StorageManager::StorageManager(std::filesystem::path base_path_arg, int page_size_arg, bool direct_io_arg, bool io_uring_arg, bool mmap_arg, bool persistent_arg, bool recoverable_arg, bool compression_arg, uint64_t stripe_count_arg, const std::vector<std::filesystem::path> &stripe_paths_arg)
+    : base_path(base_path_arg), stripe_count(std::max<uint64_t>({1, stripe_count_arg, stripe_paths_arg.size()})), page_size(page_size_arg), direct_io(direct_io_arg), memory_mapped(mmap_arg), compressed(compression_arg), persistent(persistent_arg), recoverable(recoverable_arg)
 {
     logger = spdlog::get("logger");
-    bitmap_increment = std::ceil(page_size_arg / 8.0) * 8;
+    for (uint64_t stripe = 0; stripe < stripe_count; stripe++)
+    {
+        std::filesystem::path folder = stripe < stripe_paths_arg.size() ? stripe_paths_arg[stripe] : base_path;
+        data_paths.push_back(folder / (stripe == 0 ? data : std::filesystem::path("data." + std::to_string(stripe) + ".bin")));
+    }
+
     // check if folder and files exist
     if (!std::filesystem::exists(base_path))
     {
         std::filesystem::create_directories(base_path);
     }
-    else
+    for (const std::filesystem::path &path : data_paths)
     {
-        std::filesystem::remove(base_path / data);
+        if (!std::filesystem::exists(path.parent_path()))
+            std::filesystem::create_directories(path.parent_path());
+        else if (!persistent)
+            std::filesystem::remove(path);
     }
 
-    data_fs.open(base_path / data, std::ios::binary | std::ios::in | std::ios::out);
+    if (compressed && (direct_io || io_uring_arg || memory_mapped))
+    {
+        // compressed pages have no fixed size and place, they are neither aligned nor found at their page id in the file
+        logger->warn("Compressed pages are transferred with pread and pwrite through the page cache, direct I/O, io_uring and the memory mapping are turned off");
+        direct_io = false;
+        io_uring_arg = false;
+        memory_mapped = false;
+    }
 
-    if (!data_fs.is_open())
+    if (stripe_count > 1 && memory_mapped)
     {
-        // if the file does not exist, create it
-        data_fs.clear();
-        data_fs.open(base_path / data, std::ios::binary | std::ios::out);
-        data_fs.close();
-        // reopen with in/out
-        data_fs.open(base_path / data, std::ios::binary | std::ios::in | std::ios::out);
-        if (!data_fs.is_open())
+        // a mapping covers one file, the pages of the others would be missing from it
+        logger->warn("The memory mapping can not be used with {} data files, pages are read with system calls instead", stripe_count);
+        memory_mapped = false;
+    }
+
+    if (direct_io && memory_mapped)
+    {
+        // the mapping reads through the page cache, writes that bypass it would not be visible
+        logger->warn("Direct I/O can not be combined with a memory mapped data file, using the page cache instead");
+        direct_io = false;
+    }
+
+    if (direct_io && page_size % direct_io_alignment != 0)
+    {
+        logger->warn("Direct I/O needs a page size that is a multiple of {}, using the page cache instead", direct_io_alignment);
+        direct_io = false;
+    }
+
+    for (const std::filesystem::path &path : data_paths)
+    {
+        int data_fd = open(path.c_str(), O_RDWR | O_CREAT | (direct_io ? O_DIRECT : 0), 0644);
+        if (data_fd == -1 && direct_io && errno == EINVAL)
+        {
+            // the file system does not support O_DIRECT, e.g. tmpfs. The data files that are already open use the page cache as well
+            logger->warn("Direct I/O is not supported for {}, using the page cache instead", path.string());
+            direct_io = false;
+            for (int opened_fd : data_fds)
+            {
+                fcntl(opened_fd, F_SETFL, fcntl(opened_fd, F_GETFL) & ~O_DIRECT);
+            }
+            data_fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        }
+        if (data_fd == -1)
         {
-            logger->error("File opening failed: ", std::strerror(errno));
+            logger->error("File opening failed: {}", std::strerror(errno));
             exit(1);
         }
+        data_fds.push_back(data_fd);
+    }
+
+    if (direct_io)
+    {
+        bounce_buffer.reset(static_cast<char *>(std::aligned_alloc(direct_io_alignment, page_size)));
+    }
+
+    if (io_uring_arg)
+    {
+        ring = std::make_unique<IoRing>(ring_entries);
+        if (!ring->is_available())
+        {
+            logger->warn("io_uring is not available, using pread and pwrite instead");
+            ring.reset();
+        }
     }
 
-    // page_size needs to be dividable by 8
-    free_space_map.resize(bitmap_increment, true);
-    free_space_map.reset(0);
+    // page 0 holds the superblock
+    free_space_map.set_used(0);
 
-    // find correct first free space in file
-    find_next_free_space();
+    if (compressed)
+    {
+        slot_size = std::min<uint64_t>(512, page_size);
+        for (uint64_t slot = 0; slot < (page_size + slot_size - 1) / slot_size; slot++)
+        {
+            slot_map.set_used(slot);
+        }
+        compression_buffer.resize(PageCodec::max_compressed_size(page_size));
+    }
+
+    if (persistent && std::filesystem::file_size(data_paths[0]) >= static_cast<uint64_t>(page_size))
+    {
+        read_superblock();
+    }
+}
+
+void StorageManager::read_superblock()
+{
+    std::unique_ptr<char, decltype(&free)> page(static_cast<char *>(std::aligned_alloc(direct_io_alignment, page_size)), &free);
+    transfer_page(page.get(), 0, false);
+    Superblock superblock;
+    std::memcpy(&superblock, page.get(), sizeof(Superblock));
+    if (superblock.magic != superblock_magic && recoverable)
+    {
+        // the pages that are in the file stay, the rest of the state comes from the log
+        logger->warn("{} was not closed correctly, it is recovered from the log", data_paths[0].string());
+        current_page_count = get_file_page_count();
+        needs_recovery = true;
+        return;
+    }
+    if (superblock.magic != superblock_magic)
+    {
+        logger->error("{} is not a data file or was not closed correctly", data_paths[0].string());
+        exit(1);
+    }
+    if (superblock.page_size != static_cast<uint32_t>(page_size))
+    {
+        logger->error("{} was written with a page size of {}", data_paths[0].string(), superblock.page_size);
+        exit(1);
+    }
+    if (superblock.stripe_count != stripe_count)
+    {
+        logger->error("{} was written striped across {} data files", data_paths[0].string(), superblock.stripe_count);
+        exit(1);
+    }
+
+    // the tail is stored in whole pages behind the last page, its size is known once its fixed part was read
+    std::vector<char> tail;
+    uint64_t tail_size = sizeof(SuperblockTail);
+    bool sized = false;
+    for (uint64_t offset = 0; offset < tail_size; offset += page_size)
+    {
+        transfer_page(page.get(), superblock.page_count * page_size + offset, false);
+        tail.insert(tail.end(), page.get(), page.get() + page_size);
+        if (!sized && tail.size() >= sizeof(SuperblockTail))
+        {
+            SuperblockTail superblock_tail;
+            std::memcpy(&superblock_tail, tail.data(), sizeof(SuperblockTail));
+            if (superblock_tail.slot_size != slot_size)
+            {
+                logger->error("{} was written {} compressed pages", data_paths[0].string(), superblock_tail.slot_size == 0 ? "without" : "with");
+                exit(1);
+            }
+            tail_size += (superblock_tail.free_space_map_size + 63) / 64 * sizeof(uint64_t);
+            tail_size += (superblock_tail.slot_map_size + 63) / 64 * sizeof(uint64_t) + superblock_tail.directory_size * sizeof(uint64_t);
+            sized = true;
+        }
+    }
+    restore_tail(tail.data());
+
+    // drop the tail from the file, the file ends with the last page again
+    if (!truncate_files(superblock.page_count))
+    {
+        logger->error("File truncation failed: {}", std::strerror(errno));
+        exit(1);
+    }
+    // the superblock is only valid until the file is changed, it is written again when the file is closed
+    std::memset(page.get(), 0, page_size);
+    transfer_page(page.get(), 0, true);
+
+    current_page_count = superblock.page_count;
+    root_id = superblock.root_id;
+    reopened = true;
+    logger->info("Opened {} with {} pages", data_paths[0].string(), current_page_count);
+}
+
+void StorageManager::write_superblock()
+{
+    std::unique_ptr<char, decltype(&free)> page(static_cast<char *>(std::aligned_alloc(direct_io_alignment, page_size)), &free);
+    // free pages at the end are dropped, the tail takes their place. Released slots stay in the file, the log recovers from them until it is removed after the superblock was written
+    truncate();
+
+    std::vector<char> tail = get_tail();
+    for (uint64_t offset = 0; offset < tail.size(); offset += page_size)
+    {
+        std::memset(page.get(), 0, page_size);
+        std::memcpy(page.get(), tail.data() + offset, std::min<uint64_t>(page_size, tail.size() - offset));
+        transfer_page(page.get(), current_page_count * page_size + offset, true);
+    }
+    // the superblock is written last, so a file with a valid superblock also has a complete tail
+    if (!sync_files())
+    {
+        logger->error("File synchronization failed: {}", std::strerror(errno));
+    }
+
+    Superblock superblock{superblock_magic, static_cast<uint32_t>(page_size), static_cast<uint32_t>(stripe_count), current_page_count, root_id};
+    std::memset(page.get(), 0, page_size);
+    std::memcpy(page.get(), &superblock, sizeof(Superblock));
+    transfer_page(page.get(), 0, true);
+    if (fdatasync(data_fds[0]) == -1)
+    {
+        logger->error("File synchronization failed: {}", std::strerror(errno));
+    }
+}
+
+std::vector<char> StorageManager::get_tail()
+{
+    // slots that are only released are still in use by an older state, but not by this one
+    FreeSpaceMap tail_slot_map = slot_map;
+    for (uint64_t entry : released_slots)
+    {
+        free_slots(entry, tail_slot_map);
+    }
+    for (uint64_t entry : retired_slots)
+    {
+        free_slots(entry, tail_slot_map);
+    }
+
+    SuperblockTail superblock_tail{record_count, free_space_map.get_size(), slot_size, compressed ? tail_slot_map.get_size() : 0, page_directory.size()};
+    // only the words that cover the bitmaps are stored, the summaries are built again when they are read
+    uint64_t word_count = (free_space_map.get_size() + 63) / 64;
+    uint64_t slot_word_count = (superblock_tail.slot_map_size + 63) / 64;
+    std::vector<char> tail(sizeof(SuperblockTail) + (word_count + slot_word_count + page_directory.size()) * sizeof(uint64_t));
+    char *position = tail.data();
+    std::memcpy(position, &superblock_tail, sizeof(SuperblockTail));
+    position += sizeof(SuperblockTail);
+    std::memcpy(position, free_space_map.get_words().data(), word_count * sizeof(uint64_t));
+    position += word_count * sizeof(uint64_t);
+    std::memcpy(position, tail_slot_map.get_words().data(), slot_word_count * sizeof(uint64_t));
+    position += slot_word_count * sizeof(uint64_t);
+    if (!page_directory.empty())
+        std::memcpy(position, page_directory.data(), page_directory.size() * sizeof(uint64_t));
+    return tail;
+}
+
+void StorageManager::restore_tail(const char *tail)
+{
+    SuperblockTail superblock_tail;
+    std::memcpy(&superblock_tail, tail, sizeof(SuperblockTail));
+    std::vector<uint64_t> words((superblock_tail.free_space_map_size + 63) / 64);
+    std::memcpy(words.data(), tail + sizeof(SuperblockTail), words.size() * sizeof(uint64_t));
+    free_space_map.assign(words.data(), superblock_tail.free_space_map_size);
+    record_count = superblock_tail.record_count;
+
+    const char *position = tail + sizeof(SuperblockTail) + words.size() * sizeof(uint64_t);
+    words.resize((superblock_tail.slot_map_size + 63) / 64);
+    std::memcpy(words.data(), position, words.size() * sizeof(uint64_t));
+    position += words.size() * sizeof(uint64_t);
+    if (compressed)
+        slot_map.assign(words.data(), superblock_tail.slot_map_size);
+    page_directory.resize(superblock_tail.directory_size);
+    if (!page_directory.empty())
+        std::memcpy(page_directory.data(), position, page_directory.size() * sizeof(uint64_t));
+    // the slots the older states pointed to are free in this one
+    released_slots.clear();
+    retired_slots.clear();
+}
+
+std::vector<char> StorageManager::get_state()
+{
+    // the state before the previous one is replaced, nothing recovers from it anymore
+    for (uint64_t entry : retired_slots)
+    {
+        free_slots(entry, slot_map);
+    }
+    retired_slots = std::move(released_slots);
+    released_slots.clear();
+
+    Superblock superblock{superblock_magic, static_cast<uint32_t>(page_size), static_cast<uint32_t>(stripe_count), current_page_count, root_id};
+    std::vector<char> state(sizeof(Superblock));
+    std::memcpy(state.data(), &superblock, sizeof(Superblock));
+    std::vector<char> tail = get_tail();
+    state.insert(state.end(), tail.begin(), tail.end());
+    return state;
+}
+
+void StorageManager::restore_state(const char *state)
+{
+    Superblock superblock;
+    std::memcpy(&superblock, state, sizeof(Superblock));
+    SuperblockTail superblock_tail;
+    std::memcpy(&superblock_tail, state + sizeof(Superblock), sizeof(SuperblockTail));
+    if (superblock.magic != superblock_magic || superblock.page_size != static_cast<uint32_t>(page_size) || superblock.stripe_count != stripe_count || superblock_tail.slot_size != slot_size)
+    {
+        logger->error("The state of {} in the log does not belong to a data file with a page size of {} in {} stripes", data_paths[0].string(), page_size, stripe_count);
+        exit(1);
+    }
+    // pages written after the state was taken are still in the file
+    current_page_count = std::max(current_page_count, superblock.page_count);
+    root_id = superblock.root_id;
+    restore_tail(state + sizeof(Superblock));
+    needs_recovery = false;
+    reopened = true;
+}
+
+bool StorageManager::is_recovery_needed()
+{
+    return needs_recovery;
+}
+
+bool StorageManager::has_page(uint64_t page_id)
+{
+    if (compressed)
+        return page_id < page_directory.size() && page_directory[page_id] != 0;
+    // allocated pages that were never written are holes behind the end of the file
+    uint64_t file_offset;
+    uint64_t stripe = locate(page_id * page_size, file_offset);
+    return page_id != 0 && file_offset + page_size <= std::filesystem::file_size(data_paths[stripe]);
+}
+
+void StorageManager::allocate_page(uint64_t page_id)
+{
+    register_page(page_id);
+}
+
+void StorageManager::sync()
+{
+    if (!sync_files())
+    {
+        logger->error("File synchronization failed: {}", std::strerror(errno));
+        exit(1);
+    }
 }
 
 void StorageManager::destroy()
 {
+    if (mapping)
+    {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+    }
+    if (persistent)
+    {
+        write_superblock();
+    }
     // delete file content and prevent them being written to the trash can
-    data_fs.close();
-    data_fs.open(base_path / data, std::ofstream::out | std::ofstream::trunc);
-    data_fs.close();
+    else if (!truncate_files(0))
+    {
+        logger->error("File truncation failed: {}", std::strerror(errno));
+    }
+    for (int data_fd : data_fds)
+    {
+        close(data_fd);
+    }
+    data_fds.clear();
+}
+
+uint64_t StorageManager::locate(uint64_t offset, uint64_t &file_offset)
+{
+    uint64_t page = offset / page_size;
+    file_offset = page / stripe_count * page_size + offset % page_size;
+    return page % stripe_count;
+}
+
+uint64_t StorageManager::get_file_page_count()
+{
+    uint64_t page_count = 0;
+    for (uint64_t stripe = 0; stripe < stripe_count; stripe++)
+    {
+        // the last page of a data file determines the page count, the other files end before it
+        uint64_t stripe_pages = std::filesystem::file_size(data_paths[stripe]) / page_size;
+        if (stripe_pages > 0)
+            page_count = std::max(page_count, (stripe_pages - 1) * stripe_count + stripe + 1);
+    }
+    return page_count;
+}
+
+bool StorageManager::truncate_files(uint64_t page_count)
+{
+    for (uint64_t stripe = 0; stripe < stripe_count; stripe++)
+    {
+        uint64_t stripe_pages = page_count / stripe_count + (stripe < page_count % stripe_count ? 1 : 0);
+        if (ftruncate(data_fds[stripe], stripe_pages * page_size) == -1)
+            return false;
+    }
+    return true;
+}
+
+bool StorageManager::sync_files()
+{
+    for (int data_fd : data_fds)
+    {
+        if (fdatasync(data_fd) == -1)
+            return false;
+    }
+    return true;
+}
+
+void StorageManager::transfer_page(char *buffer, uint64_t offset, bool write, uint64_t transferred)
+{
+    transfer_bytes(buffer, offset, page_size, write, transferred);
+}
+
+void StorageManager::transfer_bytes(char *buffer, uint64_t offset, uint64_t size, bool write, uint64_t transferred)
+{
+    while (transferred < size)
+    {
+        uint64_t file_offset;
+        uint64_t stripe = locate(offset + transferred, file_offset);
+        // the next page lies in the next data file
+        uint64_t length = size - transferred;
+        if (stripe_count > 1)
+            length = std::min<uint64_t>(length, page_size - (offset + transferred) % page_size);
+        ssize_t result = write ? pwrite(data_fds[stripe], buffer + transferred, length, file_offset)
+                               : pread(data_fds[stripe], buffer + transferred, length, file_offset);
+        if (result == -1 && errno == EINTR)
+            continue;
+        if (result <= 0)
+        {
+            logger->error("File {} failed: {}", write ? "write" : "read", result == 0 ? "unexpected end of file" : std::strerror(errno));
+            exit(1);
+        }
+        transferred += result;
+    }
+}
+
+void StorageManager::transfer_pages(char *const *pages, const uint64_t *page_ids, size_t count, bool write)
+{
+    if (!ring)
+    {
+        if (stripe_count == 1 || count <= 1)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                transfer_page(pages[i], page_ids[i] * page_size, write);
+            }
+            return;
+        }
+
+        auto transfer_stripe = [=](uint64_t stripe)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                if (page_ids[i] % stripe_count == stripe)
+                    transfer_page(pages[i], page_ids[i] * page_size, write);
+            }
+        };
+        // every data file gets its own thread, so the devices they are on work at the same time
+        std::vector<bool> used(stripe_count, false);
+        for (size_t i = 0; i < count; i++)
+        {
+            used[page_ids[i] % stripe_count] = true;
+        }
+        std::vector<std::thread> threads;
+        for (uint64_t stripe = 1; stripe < stripe_count; stripe++)
+        {
+            if (used[stripe])
+                threads.emplace_back(transfer_stripe, stripe);
+        }
+        transfer_stripe(0);
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(ring_mutex);
+    for (size_t start = 0; start < count; start += ring->get_entries())
+    {
+        size_t batch = std::min<size_t>(count - start, ring->get_entries());
+        for (size_t i = start; i < start + batch; i++)
+        {
+            uint64_t file_offset;
+            uint64_t stripe = locate(page_ids[i] * page_size, file_offset);
+            ring->prepare(data_fds[stripe], pages[i], page_size, file_offset, write, i);
+        }
+        if (!ring->submit())
+        {
+            logger->error("Submitting to io_uring failed: {}", std::strerror(errno));
+            exit(1);
+        }
+        for (size_t completed = 0; completed < batch; completed++)
+        {
+            uint64_t i;
+            int result;
+            if (!ring->wait_completion(i, result))
+            {
+                logger->error("Waiting for io_uring failed: {}", std::strerror(errno));
+                exit(1);
+            }
+            // short or failed requests are finished with the synchronous calls, which report persistent errors
+            if (result != page_size)
+                transfer_page(pages[i], page_ids[i] * page_size, write, std::max(result, 0));
+        }
+    }
 }
 
 void StorageManager::load_page(BHeader *header, uint64_t page_id)
 {
+    if (compressed)
+    {
+        load_compressed_page(header, page_id);
+        verify_page(header, page_id);
+        return;
+    }
+
     if (page_id > current_page_count)
     {
         logger->error("Page {} does not exist.", page_id);
         exit(1);
     }
 
-    data_fs.seekg(page_id * page_size, std::ios::beg);
-    if (!data_fs)
+    if (memory_mapped)
     {
-        logger->error("Seekg failed: ", std::strerror(errno));
-        exit(1);
+        std::shared_lock<std::shared_mutex> lock(mapping_mutex);
+        std::memcpy(header, get_mapped_page(page_id, lock), page_size);
     }
-    data_fs.read(reinterpret_cast<char *>(header), page_size);
+    else
+    {
+        char *page = reinterpret_cast<char *>(header);
+        if (!direct_io || reinterpret_cast<uintptr_t>(page) % direct_io_alignment == 0)
+        {
+            transfer_pages(&page, &page_id, 1, false);
+        }
+        else
+        {
+            // frames in the buffer are not aligned to the block size, so direct reads go through an aligned copy
+            std::lock_guard<std::mutex> guard(bounce_mutex);
+            char *bounce = bounce_buffer.get();
+            transfer_pages(&bounce, &page_id, 1, false);
+            std::memcpy(page, bounce, page_size);
+        }
+    }
+    verify_page(header, page_id);
+}
 
-    if (!data_fs)
+void StorageManager::load_pages(const std::vector<BHeader *> &headers, const std::vector<uint64_t> &page_ids)
+{
+    assert(headers.size() == page_ids.size() && "Every page needs a page id");
+    if (memory_mapped || compressed)
     {
-        logger->error("File read failed: ", std::strerror(errno));
-        exit(1);
+        for (size_t i = 0; i < headers.size(); i++)
+        {
+            load_page(headers[i], page_ids[i]);
+        }
+        return;
+    }
+
+    std::vector<char *> pages(headers.size());
+    size_t unaligned_count = 0;
+    for (size_t i = 0; i < headers.size(); i++)
+    {
+        if (page_ids[i] > current_page_count)
+        {
+            logger->error("Page {} does not exist.", page_ids[i]);
+            exit(1);
+        }
+        pages[i] = reinterpret_cast<char *>(headers[i]);
+        if (direct_io && reinterpret_cast<uintptr_t>(pages[i]) % direct_io_alignment != 0)
+            unaligned_count++;
+    }
+
+    // unaligned pages are read into one aligned block and copied afterwards
+    std::unique_ptr<char, decltype(&free)> bounce_pages(nullptr, &free);
+    if (unaligned_count > 0)
+    {
+        bounce_pages.reset(static_cast<char *>(std::aligned_alloc(direct_io_alignment, unaligned_count * page_size)));
+        for (size_t i = 0, next = 0; i < pages.size(); i++)
+        {
+            if (reinterpret_cast<uintptr_t>(pages[i]) % direct_io_alignment != 0)
+                pages[i] = bounce_pages.get() + page_size * next++;
+        }
+    }
+
+    transfer_pages(pages.data(), page_ids.data(), pages.size(), false);
+
+    if (unaligned_count > 0)
+    {
+        for (size_t i = 0; i < pages.size(); i++)
+        {
+            if (pages[i] != reinterpret_cast<char *>(headers[i]))
+                std::memcpy(headers[i], pages[i], page_size);
+        }
+    }
+
+    for (size_t i = 0; i < headers.size(); i++)
+    {
+        verify_page(headers[i], page_ids[i]);
     }
 }
 
 void StorageManager::save_page(BHeader *header)
 {
-    while (free_space_map.size() <= header->page_id)
+    if (compressed)
     {
-        free_space_map.resize(free_space_map.size() + bitmap_increment, true);
+        save_compressed_page(header);
+        return;
     }
 
-    if (current_page_count <= header->page_id)
+    PageChecksum::seal(header, page_size);
+    char *page = reinterpret_cast<char *>(header);
+    uint64_t page_id = header->page_id;
+    if (!direct_io || reinterpret_cast<uintptr_t>(page) % direct_io_alignment == 0)
+    {
+        transfer_pages(&page, &page_id, 1, true);
+    }
+    else
     {
+        std::lock_guard<std::mutex> guard(bounce_mutex);
+        char *bounce = bounce_buffer.get();
+        std::memcpy(bounce, page, page_size);
+        transfer_pages(&bounce, &page_id, 1, true);
+    }
+    register_page(page_id);
+}
 
-        data_fs.seekp(0, std::ios::end);
-        if (!data_fs)
+void StorageManager::save_pages(const std::vector<BHeader *> &headers)
+{
+    if (compressed)
+    {
+        for (BHeader *header : headers)
         {
-            logger->error("Seekp failed: ", std::strerror(errno));
-            exit(1);
+            save_compressed_page(header);
         }
-        // we can insert other data
-        while (current_page_count <= header->page_id)
+        return;
+    }
+
+    std::vector<char *> pages(headers.size());
+    std::vector<uint64_t> page_ids(headers.size());
+    size_t unaligned_count = 0;
+    for (size_t i = 0; i < headers.size(); i++)
+    {
+        PageChecksum::seal(headers[i], page_size);
+        pages[i] = reinterpret_cast<char *>(headers[i]);
+        page_ids[i] = headers[i]->page_id;
+        if (direct_io && reinterpret_cast<uintptr_t>(pages[i]) % direct_io_alignment != 0)
+            unaligned_count++;
+    }
+
+    // unaligned pages are copied into one aligned block before they are written
+    std::unique_ptr<char, decltype(&free)> bounce_pages(nullptr, &free);
+    if (unaligned_count > 0)
+    {
+        bounce_pages.reset(static_cast<char *>(std::aligned_alloc(direct_io_alignment, unaligned_count * page_size)));
+        for (size_t i = 0, next = 0; i < pages.size(); i++)
         {
-            data_fs.write(reinterpret_cast<char *>(header), page_size);
-            current_page_count++;
+            if (reinterpret_cast<uintptr_t>(pages[i]) % direct_io_alignment != 0)
+            {
+                pages[i] = bounce_pages.get() + page_size * next++;
+                std::memcpy(pages[i], headers[i], page_size);
+            }
         }
     }
-    else
+
+    transfer_pages(pages.data(), page_ids.data(), pages.size(), true);
+
+    for (uint64_t page_id : page_ids)
+    {
+        register_page(page_id);
+    }
+}
+
+char *StorageManager::get_mapped_page(uint64_t page_id, std::shared_lock<std::shared_mutex> &lock)
+{
+    if (page_id >= current_page_count)
     {
-        data_fs.seekp(header->page_id * page_size, std::ios::beg);
-        if (!data_fs)
+        logger->error("File read failed: unexpected end of file");
+        exit(1);
+    }
+    if ((page_id + 1) * page_size > mapping_size)
+    {
+        lock.unlock();
         {
-            logger->error("Seekp failed: ", std::strerror(errno));
-            exit(1);
+            std::unique_lock<std::shared_mutex> exclusive_lock(mapping_mutex);
+            // another thread might have grown the mapping in the meantime
+            if ((page_id + 1) * page_size > mapping_size)
+                grow_mapping();
         }
-        data_fs.write(reinterpret_cast<char *>(header), page_size);
+        lock.lock();
     }
-    if (!data_fs)
+    return mapping + page_id * page_size;
+}
+
+void StorageManager::grow_mapping()
+{
+    // the mapping is at least doubled, so the file can grow for a while without a new mapping
+    uint64_t size = std::max(current_page_count * page_size, 2 * mapping_size);
+    size = (size + direct_io_alignment - 1) / direct_io_alignment * direct_io_alignment;
+    void *memory = mapping ? mremap(mapping, mapping_size, size, MREMAP_MAYMOVE)
+                           : ::mmap(nullptr, size, PROT_READ, MAP_SHARED, data_fds[0], 0);
+    if (memory == MAP_FAILED)
     {
-        logger->error("File write failed: ", std::strerror(errno));
+        logger->error("Mapping the data file failed: {}", std::strerror(errno));
         exit(1);
     }
-    free_space_map.reset(header->page_id);
-    find_next_free_space();
-    data_fs.flush();
+    mapping = static_cast<char *>(memory);
+    mapping_size = size;
+    madvise(mapping, mapping_size, sequential_access ? MADV_SEQUENTIAL : MADV_RANDOM);
+}
+
+void StorageManager::register_page(uint64_t page_id)
+{
+    // pages between the old end of the file and the new page are holes until they are written, compressed pages do not lie at their page id
+    if (!compressed && current_page_count <= page_id)
+    {
+        current_page_count = page_id + 1;
+    }
+    free_space_map.set_used(page_id);
 }
 
 void StorageManager::delete_page(uint64_t page_id)
 {
     assert(page_id != 0 && "Deleting page 0");
 
-    if (free_space_map.size() > page_id)
+    if (free_space_map.get_size() > page_id)
     {
-        free_space_map.set(page_id);
+        free_space_map.set_free(page_id);
     }
+    if (compressed && page_id < page_directory.size())
+    {
+        release_slots(page_directory[page_id]);
+        page_directory[page_id] = 0;
+    }
+}
+
+void StorageManager::save_compressed_page(BHeader *header)
+{
+    uint64_t page_id = header->page_id;
+    // the checksum covers the page itself, so a damaged slot is found after decompression
+    PageChecksum::seal(header, page_size);
+    char *page = reinterpret_cast<char *>(header);
+    uint64_t size = PageCodec::compress(page, page_size, compression_buffer.data());
+    char *stored = compression_buffer.data();
+    if (size >= static_cast<uint64_t>(page_size))
+    {
+        size = page_size;
+        stored = page;
+    }
+    uint64_t slot_count = (size + slot_size - 1) / slot_size;
 
-    if (page_id < next_free_space)
-        next_free_space = page_id;
+    if (page_directory.size() <= page_id)
+        page_directory.resize(std::max<uint64_t>(page_id + 1, 2 * page_directory.size()), 0);
+    uint64_t entry = page_directory[page_id];
+    uint64_t first_slot = entry >> 24;
+    // without a log the old content is never needed again, so a page that still fits its slots is overwritten
+    if (entry == 0 || recoverable || ((entry & max_stored_size) + slot_size - 1) / slot_size != slot_count)
+    {
+        release_slots(entry);
+        first_slot = slot_map.find_extent(slot_count);
+        for (uint64_t slot = first_slot; slot < first_slot + slot_count; slot++)
+        {
+            slot_map.set_used(slot);
+        }
+    }
+    transfer_bytes(stored, first_slot * slot_size, size, true);
+    page_directory[page_id] = first_slot << 24 | size;
+
+    // the page count covers the slots, so the tail is still written behind the last page
+    current_page_count = std::max(current_page_count, ((first_slot + slot_count) * slot_size + page_size - 1) / page_size);
+    free_space_map.set_used(page_id);
+}
+
+void StorageManager::load_compressed_page(BHeader *header, uint64_t page_id)
+{
+    uint64_t entry = page_id < page_directory.size() ? page_directory[page_id] : 0;
+    if (entry == 0)
+    {
+        logger->error("Page {} does not exist.", page_id);
+        exit(1);
+    }
+    uint64_t size = entry & max_stored_size;
+    if (size == static_cast<uint64_t>(page_size))
+    {
+        transfer_bytes(reinterpret_cast<char *>(header), (entry >> 24) * slot_size, size, false);
+        return;
+    }
+    transfer_bytes(compression_buffer.data(), (entry >> 24) * slot_size, size, false);
+    PageCodec::decompress(compression_buffer.data(), reinterpret_cast<char *>(header), page_size);
+}
+
+void StorageManager::check_page_id(uint64_t page_id)
+{
+    if (page_id > std::numeric_limits<uint32_t>::max())
+    {
+        logger->error("Page {} can not be addressed, page ids are limited to 32 bits", page_id);
+        exit(1);
+    }
+}
+
+void StorageManager::verify_page(BHeader *header, uint64_t page_id)
+{
+    if (!PageChecksum::verify(header, page_size))
+    {
+        logger->error("Page {} is corrupted, the checksum does not match. It might have been torn by a crash during the write", page_id);
+        exit(1);
+    }
+}
+
+void StorageManager::release_slots(uint64_t entry)
+{
+    if (entry == 0)
+        return;
+    // the state in the log points to the old slots until a newer state replaces it
+    if (recoverable)
+        released_slots.push_back(entry);
+    else
+        free_slots(entry, slot_map);
+}
+
+void StorageManager::free_slots(uint64_t entry, FreeSpaceMap &map)
+{
+    uint64_t first_slot = entry >> 24;
+    uint64_t slot_count = ((entry & max_stored_size) + slot_size - 1) / slot_size;
+    for (uint64_t slot = first_slot; slot < first_slot + slot_count; slot++)
+    {
+        map.set_free(slot);
+    }
+}
+
+uint64_t StorageManager::truncate()
+{
+    // page 0 is part of the file even if no page was written
+    uint64_t page_count = std::max<uint64_t>(free_space_map.find_last_used() + 1, 1);
+    if (compressed)
+        page_count = ((slot_map.find_last_used() + 1) * slot_size + page_size - 1) / page_size;
+    if (page_count >= current_page_count)
+    {
+        current_page_count = std::max<uint64_t>(current_page_count, 1);
+        return 0;
+    }
+    uint64_t released = current_page_count - page_count;
+    // only free pages lie behind the new end, they are never read again before they are written
+    if (!truncate_files(page_count))
+    {
+        logger->error("File truncation failed: {}", std::strerror(errno));
+        exit(1);
+    }
+    current_page_count = page_count;
+    return released;
+}
+
+uint64_t StorageManager::get_page_count()
+{
+    return current_page_count;
+}
+
+bool StorageManager::is_persistent()
+{
+    return persistent;
+}
+
+bool StorageManager::is_compressed()
+{
+    return compressed;
+}
+
+uint64_t StorageManager::get_stripe_count()
+{
+    return stripe_count;
+}
+
+bool StorageManager::is_direct_io()
+{
+    return direct_io;
+}
+
+bool StorageManager::is_io_uring()
+{
+    return ring != nullptr;
+}
+
+bool StorageManager::is_reopened()
+{
+    return reopened;
+}
+
+uint64_t StorageManager::get_root_id()
+{
+    return root_id;
+}
+
+void StorageManager::set_root_id(uint64_t root_id_arg)
+{
+    root_id = root_id_arg;
+}
+
+uint64_t StorageManager::get_record_count()
+{
+    return record_count;
+}
+
+void StorageManager::set_record_count(uint64_t record_count_arg)
+{
+    record_count = record_count_arg;
+}
+
+bool StorageManager::is_mmap()
+{
+    return memory_mapped;
+}
+
+void StorageManager::advise_access(bool sequential_arg)
+{
+    std::unique_lock<std::shared_mutex> lock(mapping_mutex);
+    sequential_access = sequential_arg;
+    if (mapping)
+        madvise(mapping, mapping_size, sequential_access ? MADV_SEQUENTIAL : MADV_RANDOM);
 }
 
 uint64_t StorageManager::get_unused_page_id()
 {
-    int next = next_free_space;
-    free_space_map.reset(next);
-    find_next_free_space();
-    return next;
+    uint64_t page_id = free_space_map.find_first();
+    check_page_id(page_id);
+    free_space_map.set_used(page_id);
+    return page_id;
+}
+
+uint64_t StorageManager::peek_unused_page_id()
+{
+    return free_space_map.find_first();
 }
 
-void StorageManager::find_next_free_space()
+uint64_t StorageManager::get_unused_extent(uint64_t count)
 {
-    next_free_space = free_space_map.find_next(next_free_space - 1);
-    if (next_free_space == free_space_map.npos)
+    uint64_t first_page_id = free_space_map.find_extent(count);
+    check_page_id(first_page_id + count - 1);
+    for (uint64_t page_id = first_page_id; page_id < first_page_id + count; page_id++)
     {
-        int previous_size = free_space_map.size();
-        free_space_map.resize(free_space_map.size() + bitmap_increment, true);
-        next_free_space = free_space_map.find_next(previous_size - 1);
+        free_space_map.set_used(page_id);
     }
+    return first_page_id;
 }
@@ -8,12 +8,18 @@
 #pragma once
 
 #include "../model/b_header.h"
+#include "io_ring.h"
+#include "free_space_map.h"
+#include "page_codec.h"
+#include "page_checksum.h"
 #include <map>
 #include <iostream>
 #include <filesystem>
-#include <fstream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
 #include "spdlog/spdlog.h"
-#include <boost/dynamic_bitset.hpp>
 #include "../configuration.h"
 
 /// forward declaration
@@ -25,35 +31,280 @@ class StorageManagerTest;
 class StorageManager
 {
 private:
+    /**
+     * @brief Content of page 0, describes the data file so it can be opened again. It fits into the smallest page size of 32 bytes
+     */
+    struct Superblock
+    {
+        /// identifies a data file with a superblock
+        uint64_t magic;
+        /// page size the data file was written with
+        uint32_t page_size;
+        /// number of data files the pages were striped across
+        uint32_t stripe_count;
+        /// number of pages in the data file, including the superblock
+        uint64_t page_count;
+        /// page id of the root of the b+ tree
+        uint64_t root_id;
+    };
+
+    /**
+     * @brief Stored in the pages behind the last page, followed by the blocks of the free space map
+     */
+    struct SuperblockTail
+    {
+        /// number of records the tree was loaded with, 0 if it was changed afterwards
+        uint64_t record_count;
+        /// number of bits in the free space map
+        uint64_t free_space_map_size;
+        /// size of the slots compressed pages are stored in, 0 if the pages are not compressed
+        uint64_t slot_size;
+        /// number of bits in the slot map, its words follow the ones of the free space map
+        uint64_t slot_map_size;
+        /// number of entries in the page directory, they follow the words of the slot map
+        uint64_t directory_size;
+    };
+
+    /// marks the superblock, "RADIXDB" followed by a format version
+    static constexpr uint64_t superblock_magic = 0x5241444958444204;
+
     std::shared_ptr<spdlog::logger> logger;
 
     std::filesystem::path base_path;
 
-    /// path to the data file
+    /// name of the data file, further stripes are called data.<stripe>.bin
     std::filesystem::path data = "data.bin";
 
-    /// file handle for the data file
-    std::fstream data_fs;
+    /// number of data files the pages are striped across, page i lies in data file i % stripe_count
+    uint64_t stripe_count;
+
+    /// paths of the data files, the first one holds the superblock
+    std::vector<std::filesystem::path> data_paths;
+
+    /// file descriptors of the data files, one for every stripe
+    std::vector<int> data_fds;
 
     /// the page size for a bplus node
     int page_size;
 
-    /// how much the bitmap increments each time
-    int bitmap_increment;
+    /// if the data file is opened with O_DIRECT and bypasses the page cache of the kernel
+    bool direct_io;
+
+    /// alignment of buffers, file offsets and sizes for direct I/O
+    static constexpr uint64_t direct_io_alignment = 4096;
+
+    /// aligned copy of a page for direct I/O on pages that are not aligned in memory
+    std::unique_ptr<char, decltype(&free)> bounce_buffer{nullptr, &free};
 
-    /// data structure that shows if page_id is currently in use, 1 is free, 0 is occupied
-    boost::dynamic_bitset<> free_space_map;
+    /// protects the bounce buffer
+    std::mutex bounce_mutex;
+
+    /// submits the page transfers to the kernel in batches, nullptr if the synchronous system calls are used
+    std::unique_ptr<IoRing> ring;
+
+    /// protects the ring
+    std::mutex ring_mutex;
+
+    /// number of requests in the ring, the size of the largest batch handed to the kernel at once
+    static constexpr unsigned ring_entries = 64;
+
+    /// if pages are read from a shared memory mapping of the data file, writes still go through the file descriptor
+    bool memory_mapped;
+
+    /// start of the mapping of the data file, nullptr as long as nothing is mapped
+    char *mapping = nullptr;
+
+    /// size of the mapping, can be larger than the file, only pages inside the file are read
+    uint64_t mapping_size = 0;
+
+    /// taken shared while pages are copied out of the mapping and exclusive while it is grown
+    std::shared_mutex mapping_mutex;
+
+    /// if the mapping is advised for sequential access, otherwise for random access
+    bool sequential_access = false;
+
+    /// shows if a page id is currently in use, with a summary to find free pages without scanning the whole bitmap
+    FreeSpaceMap free_space_map;
 
     /// how many pages there are saved
     uint64_t current_page_count = 0;
 
-    /// where to find the next free space
-    uint64_t next_free_space = 1;
+    /// if pages are stored compressed in runs of slots, otherwise every page has a fixed place at its page id
+    bool compressed;
+
+    /// size of the units compressed pages are stored in, a page takes as many as its compressed size needs
+    uint64_t slot_size = 0;
+
+    /// largest size of a compressed page that is stored in the page directory
+    static constexpr uint64_t max_stored_size = (uint64_t(1) << 24) - 1;
+
+    /// shows if a slot is currently in use, the slots of the superblock are always used
+    FreeSpaceMap slot_map;
+
+    /// place of every compressed page, the first slot shifted by 24 bits followed by the stored size, 0 if the page was never written. A stored size of a whole page marks a page that did not shrink and is stored as it is
+    std::vector<uint64_t> page_directory;
+
+    /// slots of replaced and deleted pages since the last state was taken, the state might still point to them
+    std::vector<uint64_t> released_slots;
+
+    /// slots that were released before the last state was taken, they are free once the next state replaces it
+    std::vector<uint64_t> retired_slots;
+
+    /// receives a page while it is compressed or decompressed
+    std::vector<char> compression_buffer;
+
+    /// if the data file is kept when the storage manager is destroyed and opened again when it is created
+    bool persistent;
+
+    /// if an existing data file was opened
+    bool reopened = false;
+
+    /// if a data file that was not closed correctly is opened, its state is restored from the log afterwards
+    bool recoverable;
+
+    /// if the opened data file was not closed correctly and its state was not restored yet
+    bool needs_recovery = false;
+
+    /// page id of the root of the b+ tree, saved in the superblock
+    uint64_t root_id = 0;
+
+    /// number of records the tree was loaded with, saved in the superblock
+    uint64_t record_count = 0;
+
+    /**
+     * @brief Reads the superblock and the free space map of an existing data file
+     */
+    void read_superblock();
+
+    /**
+     * @brief Writes the tail with the free space map behind the last page and the superblock into page 0
+     */
+    void write_superblock();
+
+    /**
+     * @brief Returns the tail that is stored behind the last page, the record count and the free space map
+     * @return the tail
+     */
+    std::vector<char> get_tail();
+
+    /**
+     * @brief Restores the record count and the free space map from a tail
+     * @param tail The tail
+     */
+    void restore_tail(const char *tail);
+
+    /**
+     * @brief Finds the data file and the offset in it for an offset in the striped data file, the pages are distributed round robin
+     * @param offset The offset in the striped data file
+     * @param file_offset Receives the offset in the data file
+     * @return the stripe, the index of the data file
+     */
+    uint64_t locate(uint64_t offset, uint64_t &file_offset);
+
+    /**
+     * @brief Returns the number of pages in the data files, derived from their sizes
+     * @return the number of pages, including holes
+     */
+    uint64_t get_file_page_count();
+
+    /**
+     * @brief Cuts the data files so they hold exactly the given number of pages
+     * @param page_count The number of pages of the striped data file
+     * @return false if a data file could not be truncated, errno is set then
+     */
+    bool truncate_files(uint64_t page_count);
+
+    /**
+     * @brief Flushes all data files to the disc
+     * @return false if a data file could not be synchronized, errno is set then
+     */
+    bool sync_files();
+
+    /**
+     * @brief Reads or writes exactly one page at the given offset, retrying on short transfers
+     * @param buffer The page in memory
+     * @param offset The offset of the page in the data file
+     * @param write If the page is written, otherwise it is read
+     * @param transferred The number of bytes of the page that were already transferred
+     */
+    void transfer_page(char *buffer, uint64_t offset, bool write, uint64_t transferred = 0);
+
+    /**
+     * @brief Reads or writes a range of bytes, retrying on short transfers. A range that crosses pages is split between the data files
+     * @param buffer The bytes in memory
+     * @param offset The offset in the data file
+     * @param size The number of bytes
+     * @param write If the bytes are written, otherwise they are read
+     * @param transferred The number of bytes that were already transferred
+     */
+    void transfer_bytes(char *buffer, uint64_t offset, uint64_t size, bool write, uint64_t transferred = 0);
+
+    /**
+     * @brief Reads or writes several pages, through the ring if it is used, otherwise one after another with one thread for every data file
+     * @param pages The pages in memory, aligned if direct I/O is used
+     * @param page_ids The page ids that determine the offsets in the data file
+     * @param count The number of pages
+     * @param write If the pages are written, otherwise they are read
+     */
+    void transfer_pages(char *const *pages, const uint64_t *page_ids, size_t count, bool write);
+
+    /**
+     * @brief Grows the mapping so it covers all pages of the data file, the mapping mutex must be held exclusively
+     */
+    void grow_mapping();
+
+    /**
+     * @brief Returns the page in the mapping, grows the mapping if the page is not covered yet
+     * @param page_id The page id of a page inside the data file
+     * @param lock Shared lock on the mapping mutex, the page stays valid while it is held
+     * @return The page in the mapping
+     */
+    char *get_mapped_page(uint64_t page_id, std::shared_lock<std::shared_mutex> &lock);
+
+    /**
+     * @brief Marks a page as written in the bitmap and extends the page count
+     * @param page_id The page id of the written page
+     */
+    void register_page(uint64_t page_id);
+
+    /**
+     * @brief Compresses a page and writes it into slots, a page keeps its slots only if they are overwritten without a log that could still need the old content
+     * @param header The page
+     */
+    void save_compressed_page(BHeader *header);
+
+    /**
+     * @brief Reads the slots of a page and decompresses it
+     * @param header The page in memory
+     * @param page_id The page id
+     */
+    void load_compressed_page(BHeader *header, uint64_t page_id);
+
+    /**
+     * @brief Stops if a page that was read does not match its checksum
+     * @param header The page in memory
+     * @param page_id The page id
+     */
+    void verify_page(BHeader *header, uint64_t page_id);
+
+    /**
+     * @brief Stops if a page id does not fit into the header
+     * @param page_id The page id
+     */
+    void check_page_id(uint64_t page_id);
 
     /**
-     * @brief Find the next free space in the bitmap and set the attribute
+     * @brief Gives the slots of a page entry up, they are only reused after the next state if a log might recover from the current one
+     * @param entry The entry of the page directory
      */
-    void find_next_free_space();
+    void release_slots(uint64_t entry);
+
+    /**
+     * @brief Marks the slots of a page entry as free
+     * @param entry The entry of the page directory
+     * @param map The slot map
+     */
+    void free_slots(uint64_t entry, FreeSpaceMap &map);
 
 public:
     friend class StorageManagerTest;
@@ -62,8 +313,16 @@ public:
      * @brief Constructor for the storage manager
      * @param base_path_arg The base path of the folder where the data and offset file will be placed in
      * @param page_size_arg The page size saved into memory
+     * @param direct_io_arg If the data file should bypass the page cache of the kernel, only possible if the page size is a multiple of 4096
+     * @param io_uring_arg If pages should be transferred through io_uring, falls back to pread and pwrite if the kernel does not support it
+     * @param mmap_arg If pages should be read from a memory mapping of the data file, turns off direct I/O
+     * @param persistent_arg If an existing data file should be opened again and kept when the storage manager is destroyed
+     * @param recoverable_arg If an existing data file that was not closed correctly should be opened, its state has to be restored from the log
+     * @param compression_arg If pages should be compressed in the data file, turns off direct I/O, io_uring and the memory mapping
+     * @param stripe_count_arg Number of data files the pages are striped across, at least the number of stripe paths. Turns off the memory mapping if it is larger than 1
+     * @param stripe_paths_arg Folders of the data files, one for every stripe. Stripes without a folder are placed in the base path
      */
-    StorageManager(std::filesystem::path base_path_arg, int page_size_arg);
+    StorageManager(std::filesystem::path base_path_arg, int page_size_arg, bool direct_io_arg = false, bool io_uring_arg = false, bool mmap_arg = false, bool persistent_arg = false, bool recoverable_arg = false, bool compression_arg = false, uint64_t stripe_count_arg = 1, const std::vector<std::filesystem::path> &stripe_paths_arg = {});
 
     /**
      * @brief Saves a page to disc
@@ -71,6 +330,12 @@ public:
      */
     void save_page(BHeader *header);
 
+    /**
+     * @brief Saves several pages to disc, the writes are handed to the kernel together
+     * @param headers Pointers to the headers (pages) that should be written to file
+     */
+    void save_pages(const std::vector<BHeader *> &headers);
+
     /**
      * @brief Deletes a page from disc
      * @param page_id The unique identifier of the page that should be deleted
@@ -84,6 +349,13 @@ public:
      */
     void load_page(BHeader *header, uint64_t page_id);
 
+    /**
+     * @brief Loads several pages from disc, the reads are handed to the kernel together
+     * @param headers Pointers to the headers (pages) that should be written to
+     * @param page_ids The unique identifiers of the pages that should be loaded, one for each header
+     */
+    void load_pages(const std::vector<BHeader *> &headers, const std::vector<uint64_t> &page_ids);
+
     /**
      * @brief Gives an unsued page_id, when requesting a new unused page_id, the bitmap is already set, so its important to write the page at the end
      * @return page_id that is currently not in use
@@ -91,7 +363,140 @@ public:
     uint64_t get_unused_page_id();
 
     /**
-     * @brief Used to save the offset to disc, needs to be called before exiting the program
+     * @brief Gives the first of several consecutive unused page ids, so pages that are written together end up next to each other in the file
+     * @param count The number of page ids
+     * @return the first page_id, the following count - 1 page ids are marked as used as well
+     */
+    uint64_t get_unused_extent(uint64_t count);
+
+    /**
+     * @brief Returns the page id get_unused_page_id would give without marking it as used
+     * @return the lowest page_id that is currently not in use
+     */
+    uint64_t peek_unused_page_id();
+
+    /**
+     * @brief Cuts the free pages behind the last used page off the data file and gives their space back to the file system
+     * @return the number of pages that were cut off
+     */
+    uint64_t truncate();
+
+    /**
+     * @brief Returns the number of pages in the data file, including the superblock and the free pages between the used ones
+     * @return the number of pages
+     */
+    uint64_t get_page_count();
+
+    /**
+     * @brief Returns if the data file is kept when the storage manager is destroyed
+     * @return true if it is kept, false otherwise
+     */
+    bool is_persistent();
+
+    /**
+     * @brief Returns if the pages are compressed in the data file
+     * @return true if the pages are compressed, false otherwise
+     */
+    bool is_compressed();
+
+    /**
+     * @brief Returns the number of data files the pages are striped across
+     * @return the number of stripes
+     */
+    uint64_t get_stripe_count();
+
+    /**
+     * @brief Returns if direct I/O is used, it can be turned off if the page size or the file system do not support it
+     * @return true if the data file bypasses the page cache, false otherwise
+     */
+    bool is_direct_io();
+
+    /**
+     * @brief Returns if the pages are transferred through io_uring, it is turned off if the kernel does not support it
+     * @return true if io_uring is used, false otherwise
+     */
+    bool is_io_uring();
+
+    /**
+     * @brief Returns if the pages are read from a memory mapping of the data file
+     * @return true if the data file is mapped, false otherwise
+     */
+    bool is_mmap();
+
+    /**
+     * @brief Tells the kernel how the mapped data file is accessed, only has an effect if the data file is mapped
+     * @param sequential_arg true if pages are mostly read in scans, false if they are mostly read by point lookups
+     */
+    void advise_access(bool sequential_arg);
+
+    /**
+     * @brief Returns if an existing data file was opened
+     * @return true if the pages of a previous run are available, false otherwise
+     */
+    bool is_reopened();
+
+    /**
+     * @brief Returns the page id of the root saved in the superblock
+     * @return the page id of the root, 0 if no data file was opened
+     */
+    uint64_t get_root_id();
+
+    /**
+     * @brief Sets the page id of the root that is saved in the superblock
+     * @param root_id_arg The page id of the root
+     */
+    void set_root_id(uint64_t root_id_arg);
+
+    /**
+     * @brief Returns the number of records the tree was loaded with
+     * @return the number of records, 0 if unknown
+     */
+    uint64_t get_record_count();
+
+    /**
+     * @brief Sets the number of records the tree was loaded with, 0 marks the tree as changed
+     * @param record_count_arg The number of records
+     */
+    void set_record_count(uint64_t record_count_arg);
+
+    /**
+     * @brief Returns the state that is needed to open the data file again, the same content as the superblock and the tail. Compressed pages that were replaced before the previous state are given free, as that state is not needed anymore
+     * @return the state
+     */
+    std::vector<char> get_state();
+
+    /**
+     * @brief Restores the state of the data file, used when it was not closed correctly
+     * @param state The state returned by get_state
+     */
+    void restore_state(const char *state);
+
+    /**
+     * @brief Returns if the data file was not closed correctly and its state has to be restored from the log
+     * @return true if the state is missing, false otherwise
+     */
+    bool is_recovery_needed();
+
+    /**
+     * @brief Returns if a page was written to the data file, pages behind the end of the file were never written
+     * @param page_id The page id
+     * @return true if the page can be loaded, false otherwise
+     */
+    bool has_page(uint64_t page_id);
+
+    /**
+     * @brief Marks a page as used in the free space map without writing it
+     * @param page_id The page id
+     */
+    void allocate_page(uint64_t page_id);
+
+    /**
+     * @brief Waits until all written pages are on disc
+     */
+    void sync();
+
+    /**
+     * @brief Used to save the offset to disc, needs to be called before exiting the program. Persistent data files are completed with the superblock, others are emptied
      */
     void destroy();
 };
\ No newline at end of file
@@ -0,0 +1,479 @@
+
+#include "write_ahead_log.h"
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <chrono>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+WriteAheadLog::WriteAheadLog(std::filesystem::path path_arg, int page_size_arg, uint64_t commit_interval_arg, bool persistent_arg) : path(path_arg), page_size(page_size_arg), commit_interval(commit_interval_arg)
+{
+    logger = spdlog::get("logger");
+    log_fd = open(path.c_str(), O_RDWR | O_CREAT | (persistent_arg ? 0 : O_TRUNC), 0644);
+    if (log_fd == -1)
+    {
+        logger->error("Opening the log failed: {}", std::strerror(errno));
+        exit(1);
+    }
+
+    struct stat file_stat;
+    fstat(log_fd, &file_stat);
+    LogHeader header{0, 0};
+    if (static_cast<uint64_t>(file_stat.st_size) >= header_size && pread(log_fd, &header, sizeof(LogHeader), 0) != sizeof(LogHeader))
+        header.magic = 0;
+    // without a checkpoint there is nothing the log could recover, so it starts over
+    if (header.magic == log_magic && header.checkpoint_lsn != 0)
+    {
+        checkpoint_lsn = header.checkpoint_lsn;
+        pending_lsn = file_stat.st_size;
+    }
+    else
+    {
+        if (ftruncate(log_fd, header_size) == -1)
+        {
+            logger->error("Log truncation failed: {}", std::strerror(errno));
+            exit(1);
+        }
+        write_header();
+    }
+    durable_lsn = pending_lsn;
+    pending_records.reserve(max_group_size);
+
+    if (commit_interval > 0)
+    {
+        writer = std::thread(&WriteAheadLog::run_writer, this);
+    }
+}
+
+void WriteAheadLog::destroy()
+{
+    if (writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> guard(log_mutex);
+            stop_writer = true;
+        }
+        writer_condition.notify_one();
+        writer.join();
+    }
+    {
+        std::unique_lock<std::mutex> lock(log_mutex);
+        while (!pending_records.empty() || committing)
+        {
+            if (committing)
+                durable_condition.wait(lock);
+            else
+                commit_pending(lock);
+        }
+    }
+    // the data file was closed correctly, there is nothing left to recover
+    if (ftruncate(log_fd, header_size) == -1)
+    {
+        logger->error("Log truncation failed: {}", std::strerror(errno));
+    }
+    checkpoint_lsn = 0;
+    write_header();
+    close(log_fd);
+    log_fd = -1;
+}
+
+void WriteAheadLog::write_header()
+{
+    LogHeader header{log_magic, checkpoint_lsn};
+    if (pwrite(log_fd, &header, sizeof(LogHeader), 0) != sizeof(LogHeader) || fdatasync(log_fd) == -1)
+    {
+        logger->error("Writing the log header failed: {}", std::strerror(errno));
+        exit(1);
+    }
+}
+
+uint64_t WriteAheadLog::append(RecordType type, uint64_t page_id, const char *payload, uint32_t size)
+{
+    std::lock_guard<std::mutex> guard(log_mutex);
+    uint64_t lsn = pending_lsn + pending_records.size();
+    LogRecord record{lsn, type, size, page_id};
+    const char *record_bytes = reinterpret_cast<const char *>(&record);
+    pending_records.insert(pending_records.end(), record_bytes, record_bytes + sizeof(LogRecord));
+    pending_records.insert(pending_records.end(), payload, payload + size);
+    // records start at multiples of 8, so the headers can be read in place
+    pending_records.resize((pending_records.size() + 7) & ~uint64_t(7), 0);
+    pending_record_count++;
+    if (commit_interval > 0 && pending_records.size() >= max_group_size)
+        writer_condition.notify_one();
+    return lsn;
+}
+
+uint64_t WriteAheadLog::append_update(BHeader *header, char *before_image)
+{
+    char *page = reinterpret_cast<char *>(header);
+    // the sequence number is no part of the change, it is set once the record exists
+    reinterpret_cast<BHeader *>(before_image)->set_lsn(header->get_lsn());
+
+    // the page is compared in words, neighbouring ranges are logged as one if only a few bytes lie between them
+    std::vector<char> payload;
+    uint64_t offset = 0;
+    while (offset < static_cast<uint64_t>(page_size))
+    {
+        if (std::memcmp(page + offset, before_image + offset, 8) == 0)
+        {
+            offset += 8;
+            continue;
+        }
+        uint64_t end = offset + 8;
+        for (uint64_t next = end; next < static_cast<uint64_t>(page_size) && next - end <= max_segment_gap; next += 8)
+        {
+            if (std::memcmp(page + next, before_image + next, 8) != 0)
+                end = next + 8;
+        }
+        Segment segment{static_cast<uint32_t>(offset), static_cast<uint32_t>(end - offset)};
+        const char *segment_bytes = reinterpret_cast<const char *>(&segment);
+        payload.insert(payload.end(), segment_bytes, segment_bytes + sizeof(Segment));
+        payload.insert(payload.end(), before_image + offset, before_image + end);
+        payload.insert(payload.end(), page + offset, page + end);
+        offset = end;
+    }
+    if (payload.empty())
+        return 0;
+
+    uint64_t lsn = append(UPDATE, header->page_id, payload.data(), payload.size());
+    header->set_lsn(lsn);
+    std::memcpy(before_image, page, page_size);
+    return lsn;
+}
+
+uint64_t WriteAheadLog::append_allocate(uint64_t page_id)
+{
+    return append(ALLOCATE, page_id, nullptr, 0);
+}
+
+uint64_t WriteAheadLog::append_free(uint64_t page_id, const char *page)
+{
+    return append(FREE, page_id, page, page_size);
+}
+
+uint64_t WriteAheadLog::append_root(uint64_t old_root_id, uint64_t new_root_id)
+{
+    return append(ROOT, new_root_id, reinterpret_cast<const char *>(&old_root_id), sizeof(uint64_t));
+}
+
+void WriteAheadLog::end_operation()
+{
+    uint64_t lsn = append(END, 0, nullptr, 0);
+    if (commit_interval == 0)
+        wait_durable(lsn);
+}
+
+void WriteAheadLog::wait_durable(uint64_t lsn)
+{
+    if (durable_lsn > lsn)
+        return;
+    std::unique_lock<std::mutex> lock(log_mutex);
+    while (durable_lsn <= lsn)
+    {
+        // the first thread that finds no commit running commits everything that is pending, including the records of the others
+        if (!committing)
+            commit_pending(lock);
+        else
+            durable_condition.wait(lock);
+    }
+}
+
+void WriteAheadLog::commit_pending(std::unique_lock<std::mutex> &lock)
+{
+    if (committing || pending_records.empty())
+        return;
+    committing = true;
+    std::vector<char> records;
+    records.reserve(max_group_size);
+    records.swap(pending_records);
+    uint64_t lsn = pending_lsn;
+    uint64_t record_count = pending_record_count;
+    pending_lsn += records.size();
+    pending_record_count = 0;
+    lock.unlock();
+    write_records(records, lsn);
+    lock.lock();
+    committing = false;
+    durable_lsn = lsn + records.size();
+    committed_record_count += record_count;
+    durable_condition.notify_all();
+}
+
+void WriteAheadLog::run_writer()
+{
+    std::unique_lock<std::mutex> lock(log_mutex);
+    while (!stop_writer)
+    {
+        writer_condition.wait_for(lock, std::chrono::microseconds(commit_interval), [this]
+                                  { return stop_writer || pending_records.size() >= max_group_size; });
+        commit_pending(lock);
+    }
+}
+
+void WriteAheadLog::write_records(const std::vector<char> &records, uint64_t lsn)
+{
+    uint64_t written = 0;
+    while (written < records.size())
+    {
+        ssize_t result = pwrite(log_fd, records.data() + written, records.size() - written, lsn + written);
+        if (result == -1 && errno == EINTR)
+            continue;
+        if (result == -1)
+        {
+            logger->error("Writing the log failed: {}", std::strerror(errno));
+            exit(1);
+        }
+        written += result;
+    }
+    if (fdatasync(log_fd) == -1)
+    {
+        logger->error("Synchronizing the log failed: {}", std::strerror(errno));
+        exit(1);
+    }
+    commit_count++;
+}
+
+void WriteAheadLog::write_checkpoint(uint64_t redo_lsn, const std::vector<char> &state)
+{
+    std::vector<char> payload(sizeof(uint64_t));
+    std::memcpy(payload.data(), &redo_lsn, sizeof(uint64_t));
+    payload.insert(payload.end(), state.begin(), state.end());
+    uint64_t lsn = append(CHECKPOINT, 0, payload.data(), payload.size());
+    wait_durable(lsn);
+    checkpoint_lsn = lsn;
+    write_header();
+
+    // recovery never reads in front of the redo position, the blocks there are given back to the file system
+    uint64_t first_needed_block = std::min(redo_lsn, lsn) / header_size * header_size;
+    if (first_needed_block > header_size)
+        fallocate(log_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, header_size, first_needed_block - header_size);
+}
+
+void WriteAheadLog::apply_update(char *page, const char *payload, uint32_t size, bool after)
+{
+    uint32_t position = 0;
+    while (position < size)
+    {
+        Segment segment;
+        std::memcpy(&segment, payload + position, sizeof(Segment));
+        const char *content = payload + position + sizeof(Segment) + (after ? segment.length : 0);
+        std::memcpy(page + segment.offset, content, segment.length);
+        position += sizeof(Segment) + 2 * segment.length;
+    }
+}
+
+bool WriteAheadLog::recover(StorageManager *storage_manager)
+{
+    if (checkpoint_lsn == 0)
+        return false;
+
+    struct stat file_stat;
+    fstat(log_fd, &file_stat);
+    uint64_t file_size = file_stat.st_size;
+
+    LogRecord checkpoint;
+    if (pread(log_fd, &checkpoint, sizeof(LogRecord), checkpoint_lsn) != sizeof(LogRecord) || checkpoint.lsn != checkpoint_lsn || checkpoint.type != CHECKPOINT)
+    {
+        logger->error("The checkpoint in {} is damaged", path.string());
+        exit(1);
+    }
+    std::vector<char> checkpoint_payload(checkpoint.size);
+    if (pread(log_fd, checkpoint_payload.data(), checkpoint.size, checkpoint_lsn + sizeof(LogRecord)) != checkpoint.size)
+    {
+        logger->error("The checkpoint in {} is damaged", path.string());
+        exit(1);
+    }
+    uint64_t redo_lsn;
+    std::memcpy(&redo_lsn, checkpoint_payload.data(), sizeof(uint64_t));
+    storage_manager->restore_state(checkpoint_payload.data() + sizeof(uint64_t));
+    uint64_t root_id = storage_manager->get_root_id();
+
+    // everything from the redo position to the end of the file is read at once, checkpoints keep it short
+    uint64_t start = std::min(redo_lsn, checkpoint_lsn.load());
+    std::vector<char> log(file_size - start);
+    for (uint64_t read = 0; read < log.size();)
+    {
+        ssize_t result = pread(log_fd, log.data() + read, log.size() - read, start + read);
+        if (result == -1 && errno == EINTR)
+            continue;
+        if (result <= 0)
+        {
+            logger->error("Reading the log failed: {}", result == 0 ? "unexpected end of file" : std::strerror(errno));
+            exit(1);
+        }
+        read += result;
+    }
+
+    // pages are changed in memory and written once at the end
+    std::unordered_map<uint64_t, std::unique_ptr<char, decltype(&free)>> pages;
+    auto get_page = [&](uint64_t page_id, bool load = true) -> BHeader *
+    {
+        auto it = pages.find(page_id);
+        if (it == pages.end())
+        {
+            std::unique_ptr<char, decltype(&free)> page(static_cast<char *>(std::aligned_alloc(4096, (page_size + 4095) / 4096 * 4096)), &free);
+            if (load && storage_manager->has_page(page_id))
+                storage_manager->load_page(reinterpret_cast<BHeader *>(page.get()), page_id);
+            else
+                std::memset(page.get(), 0, page_size);
+            it = pages.emplace(page_id, std::move(page)).first;
+        }
+        return reinterpret_cast<BHeader *>(it->second.get());
+    };
+
+    // redo repeats every change the data file might miss, the records of the last operation are remembered until its end shows up
+    redone_count = 0;
+    undone_count = 0;
+    std::vector<const LogRecord *> incomplete;
+    uint64_t position = 0;
+    while (position + sizeof(LogRecord) <= log.size())
+    {
+        const LogRecord *record = reinterpret_cast<const LogRecord *>(log.data() + position);
+        // the last group might not have been written completely before the crash
+        if (record->lsn != start + position || record->type < UPDATE || record->type > FREE || position + sizeof(LogRecord) + record->size > log.size())
+            break;
+        const char *payload = log.data() + position + sizeof(LogRecord);
+        switch (record->type)
+        {
+        case UPDATE:
+        {
+            BHeader *header = get_page(record->page_id);
+            if (header->get_lsn() < record->lsn)
+            {
+                apply_update(reinterpret_cast<char *>(header), payload, record->size, true);
+                header->set_lsn(record->lsn);
+                redone_count++;
+            }
+            incomplete.push_back(record);
+        }
+        break;
+        case ALLOCATE:
+        {
+            // the page starts empty and every later change is in the log, so whatever the file contains at its position is replaced
+            storage_manager->allocate_page(record->page_id);
+            BHeader *header = get_page(record->page_id, false);
+            std::memset(reinterpret_cast<char *>(header), 0, page_size);
+            header->page_id = record->page_id;
+            header->set_lsn(record->lsn);
+            redone_count++;
+            incomplete.push_back(record);
+        }
+        break;
+        case FREE:
+            // whatever the page contained is not needed anymore
+            storage_manager->delete_page(record->page_id);
+            pages.erase(record->page_id);
+            redone_count++;
+            incomplete.push_back(record);
+            break;
+        case ROOT:
+            root_id = record->page_id;
+            incomplete.push_back(record);
+            break;
+        case END:
+        case CHECKPOINT:
+            incomplete.clear();
+            break;
+        }
+        position = (position + sizeof(LogRecord) + record->size + 7) & ~uint64_t(7);
+    }
+    uint64_t end_lsn = start + std::min<uint64_t>(position, log.size());
+
+    // undo rolls back the operation that was running during the crash, newest record first, so a page id that was freed and taken again is restored in the right order
+    for (auto it = incomplete.rbegin(); it != incomplete.rend(); it++)
+    {
+        const LogRecord *record = *it;
+        const char *payload = reinterpret_cast<const char *>(record) + sizeof(LogRecord);
+        if (record->type == UPDATE)
+        {
+            apply_update(reinterpret_cast<char *>(get_page(record->page_id)), payload, record->size, false);
+        }
+        else if (record->type == ALLOCATE)
+        {
+            pages.erase(record->page_id);
+            storage_manager->delete_page(record->page_id);
+        }
+        else if (record->type == FREE)
+        {
+            storage_manager->allocate_page(record->page_id);
+            std::memcpy(reinterpret_cast<char *>(get_page(record->page_id, false)), payload, page_size);
+        }
+        else if (record->type == ROOT)
+        {
+            std::memcpy(&root_id, payload, sizeof(uint64_t));
+        }
+        undone_count++;
+    }
+
+    std::vector<BHeader *> headers;
+    for (auto &[page_id, page] : pages)
+    {
+        BHeader *header = reinterpret_cast<BHeader *>(page.get());
+        header->page_id = page_id;
+        headers.push_back(header);
+    }
+    storage_manager->save_pages(headers);
+    storage_manager->set_root_id(root_id);
+    storage_manager->sync();
+
+    // new records are appended behind the last complete record, a damaged rest is dropped
+    if (ftruncate(log_fd, end_lsn) == -1)
+    {
+        logger->error("Log truncation failed: {}", std::strerror(errno));
+        exit(1);
+    }
+    pending_lsn = end_lsn;
+    durable_lsn = end_lsn;
+    replayed_size = end_lsn - start;
+    logger->info("Recovered {} from {} bytes of the log, {} changes redone, {} undone", path.string(), replayed_size, redone_count, undone_count);
+    return true;
+}
+
+bool WriteAheadLog::needs_checkpoint()
+{
+    return get_end_lsn() - std::max(checkpoint_lsn.load(), header_size) >= checkpoint_distance;
+}
+
+uint64_t WriteAheadLog::get_durable_lsn()
+{
+    return durable_lsn;
+}
+
+uint64_t WriteAheadLog::get_end_lsn()
+{
+    std::lock_guard<std::mutex> guard(log_mutex);
+    return pending_lsn + pending_records.size();
+}
+
+uint64_t WriteAheadLog::get_checkpoint_lsn()
+{
+    return checkpoint_lsn;
+}
+
+uint64_t WriteAheadLog::get_commit_count()
+{
+    return commit_count;
+}
+
+uint64_t WriteAheadLog::get_committed_record_count()
+{
+    return committed_record_count;
+}
+
+uint64_t WriteAheadLog::get_replayed_size()
+{
+    return replayed_size;
+}
+
+uint64_t WriteAheadLog::get_redone_count()
+{
+    return redone_count;
+}
+
+uint64_t WriteAheadLog::get_undone_count()
+{
+    return undone_count;
+}
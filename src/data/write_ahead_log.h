@@ -0,0 +1,330 @@
+/**
+ * @file    write_ahead_log.h
+ *
+ * @author  Matteo Wohlrapp
+ * @date    16.10.2026
+ */
+
+#pragma once
+
+#include "../model/b_header.h"
+#include "storage_manager.h"
+#include <stdint.h>
+#include <filesystem>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include "spdlog/spdlog.h"
+
+/// forward declaration
+class WriteAheadLogTest;
+
+/**
+ * @brief Logs the changes to the pages before they reach the data file and recovers the pages after a crash. Records are committed in groups, so many records share one write and one fdatasync.
+ * The log sequence number of a record is its offset in the log file
+ */
+class WriteAheadLog
+{
+public:
+    /**
+     * @brief The kinds of records in the log
+     */
+    enum RecordType : uint32_t
+    {
+        /// changed byte ranges of a page, with the content before and after the change
+        UPDATE = 1,
+        /// a new page was taken from the free space map
+        ALLOCATE = 2,
+        /// the root of the tree changed, the payload is the previous root
+        ROOT = 3,
+        /// the operation that wrote the records since the previous end is complete
+        END = 4,
+        /// the state of the data file and the position where redo starts
+        CHECKPOINT = 5,
+        /// a page was given back to the free space map, the payload is its content so it can be restored
+        FREE = 6
+    };
+
+    /**
+     * @brief Header of every record, followed by the payload and padded to 8 bytes
+     */
+    struct LogRecord
+    {
+        /// log sequence number, the offset of the record in the log file
+        uint64_t lsn;
+        /// the kind of the record
+        uint32_t type;
+        /// size of the payload behind the header
+        uint32_t size;
+        /// the page the record belongs to, the new root for root records
+        uint64_t page_id;
+    };
+
+    /**
+     * @brief A changed byte range of a page, followed by the bytes before and the bytes after the change
+     */
+    struct Segment
+    {
+        /// offset of the range in the page
+        uint32_t offset;
+        /// length of the range
+        uint32_t length;
+    };
+
+private:
+    /**
+     * @brief Stored at the start of the log file, points to the last complete checkpoint
+     */
+    struct LogHeader
+    {
+        /// identifies a log file
+        uint64_t magic;
+        /// log sequence number of the last checkpoint, 0 if there is none
+        uint64_t checkpoint_lsn;
+    };
+
+    /// marks the log header, "RADIXWAL" with the last byte replaced by a format version
+    static constexpr uint64_t log_magic = 0x5241444958574101;
+
+    /// the records start behind the header, which takes one block so it can be overwritten on its own
+    static constexpr uint64_t header_size = 4096;
+
+    std::shared_ptr<spdlog::logger> logger;
+
+    /// path to the log file
+    std::filesystem::path path;
+
+    /// file descriptor of the log file
+    int log_fd = -1;
+
+    /// size of the pages that are logged
+    int page_size;
+
+    /// time in microseconds the writer collects records before it commits them, 0 commits the records of an operation before it finishes
+    uint64_t commit_interval;
+
+    /// protects the pending records and the sequence numbers
+    std::mutex log_mutex;
+    /// wakes up the writer
+    std::condition_variable writer_condition;
+    /// wakes up the threads that wait for their records to be durable
+    std::condition_variable durable_condition;
+
+    /// if a thread is committing records right now, the others wait for it and commit the records that arrived in the meantime as the next group
+    bool committing = false;
+
+    /// records that were appended but not written yet
+    std::vector<char> pending_records;
+
+    /// offset in the log file where the pending records are written, the sequence number of the first pending record
+    uint64_t pending_lsn = header_size;
+
+    /// number of records in the pending records
+    uint64_t pending_record_count = 0;
+
+    /// all records in front of this offset are on disc
+    std::atomic<uint64_t> durable_lsn{header_size};
+
+    /// sequence number of the last checkpoint, 0 if there is none
+    std::atomic<uint64_t> checkpoint_lsn{0};
+
+    /// commits the pending records in the background if the commit interval is larger than 0
+    std::thread writer;
+    /// tells the writer to finish
+    bool stop_writer = false;
+
+    /// number of group commits, each is one write and one fdatasync
+    std::atomic<uint64_t> commit_count{0};
+
+    /// number of records that were committed
+    std::atomic<uint64_t> committed_record_count{0};
+
+    /// bytes of the log that were read by the last recovery
+    uint64_t replayed_size = 0;
+
+    /// number of changes that were applied to pages again by the last recovery
+    uint64_t redone_count = 0;
+
+    /// number of records of an incomplete operation that were rolled back by the last recovery
+    uint64_t undone_count = 0;
+
+    /// maximum number of pending bytes before the writer commits without waiting for the interval to pass
+    static constexpr uint64_t max_group_size = 1 << 20;
+
+    /// bytes of log written since the last checkpoint after which the next checkpoint is due, bounds the log that is read during recovery
+    static constexpr uint64_t checkpoint_distance = 64 << 20;
+
+    /// unchanged bytes between two changed ranges of a page up to which both are logged as one range
+    static constexpr uint64_t max_segment_gap = 16;
+
+    /**
+     * @brief Loop of the writer thread, commits the pending records once the interval passed or the group is full
+     */
+    void run_writer();
+
+    /**
+     * @brief Takes the pending records and commits them as one group unless another thread is committing already
+     * @param lock Lock on the log mutex, released while the records are written
+     */
+    void commit_pending(std::unique_lock<std::mutex> &lock);
+
+    /**
+     * @brief Writes records to the log file and makes them durable
+     * @param records The records
+     * @param lsn The offset in the log file
+     */
+    void write_records(const std::vector<char> &records, uint64_t lsn);
+
+    /**
+     * @brief Writes the log header
+     */
+    void write_header();
+
+    /**
+     * @brief Appends a record to the pending records
+     * @param type The kind of the record
+     * @param page_id The page the record belongs to
+     * @param payload The payload
+     * @param size The size of the payload
+     * @return The sequence number of the record
+     */
+    uint64_t append(RecordType type, uint64_t page_id, const char *payload, uint32_t size);
+
+    /**
+     * @brief Copies the before or after content of the segments of an update record into a page
+     * @param page The page
+     * @param payload The payload of the update record
+     * @param size The size of the payload
+     * @param after If the content after the change is applied, otherwise the content before
+     */
+    static void apply_update(char *page, const char *payload, uint32_t size, bool after);
+
+public:
+    friend class WriteAheadLogTest;
+
+    /**
+     * @brief Constructor for the write-ahead log
+     * @param path_arg The path of the log file
+     * @param page_size_arg The size of the logged pages
+     * @param commit_interval_arg Time in microseconds records are collected before they are committed together. With 0, every operation waits until its records are durable, and records of concurrent operations are committed together
+     * @param persistent_arg If the records of an existing log file are kept for recovery, otherwise the log starts empty
+     */
+    WriteAheadLog(std::filesystem::path path_arg, int page_size_arg, uint64_t commit_interval_arg, bool persistent_arg = false);
+
+    /**
+     * @brief Logs the changes of a page since its before image was taken, sets the sequence number of the page and updates the before image
+     * @param header The changed page
+     * @param before_image The content of the page before the change, taken with the same page size
+     * @return The sequence number of the record, 0 if the page did not change
+     */
+    uint64_t append_update(BHeader *header, char *before_image);
+
+    /**
+     * @brief Logs that a page was taken from the free space map, the page starts empty
+     * @param page_id The page id
+     * @return The sequence number of the record
+     */
+    uint64_t append_allocate(uint64_t page_id);
+
+    /**
+     * @brief Logs that a page was given back to the free space map
+     * @param page_id The page id
+     * @param page The content of the page as far as it is logged, needed to bring the page back if the operation is rolled back
+     * @return The sequence number of the record
+     */
+    uint64_t append_free(uint64_t page_id, const char *page);
+
+    /**
+     * @brief Logs that the root of the tree changed
+     * @param old_root_id The previous root
+     * @param new_root_id The new root
+     * @return The sequence number of the record
+     */
+    uint64_t append_root(uint64_t old_root_id, uint64_t new_root_id);
+
+    /**
+     * @brief Marks the records since the previous end as one complete operation, waits until they are durable if the commit interval is 0
+     */
+    void end_operation();
+
+    /**
+     * @brief Waits until a record is durable
+     * @param lsn The sequence number of the record
+     */
+    void wait_durable(uint64_t lsn);
+
+    /**
+     * @brief Writes a checkpoint and makes it the starting point of the next recovery. The log in front of the redo position is not needed anymore and its space is given back
+     * @param redo_lsn Sequence number of the oldest change that might not be in the data file yet
+     * @param state The state of the data file when the checkpoint is taken
+     */
+    void write_checkpoint(uint64_t redo_lsn, const std::vector<char> &state);
+
+    /**
+     * @brief Returns if enough log was written since the last checkpoint that the next one is due
+     * @return true if a checkpoint should be written, false otherwise
+     */
+    bool needs_checkpoint();
+
+    /**
+     * @brief Brings the data file to the state after the last complete operation in the log. Changes since the last checkpoint are applied again, changes of an incomplete operation are rolled back
+     * @param storage_manager The storage manager of the data file, the pages are read and written directly
+     * @return true if a checkpoint was found and the state of the data file was restored, false if the log contains nothing to recover
+     */
+    bool recover(StorageManager *storage_manager);
+
+    /**
+     * @brief Returns the offset up to which all records are durable
+     * @return the offset
+     */
+    uint64_t get_durable_lsn();
+
+    /**
+     * @brief Returns the sequence number the next record gets
+     * @return the sequence number
+     */
+    uint64_t get_end_lsn();
+
+    /**
+     * @brief Returns the sequence number of the last checkpoint
+     * @return the sequence number, 0 if there is none
+     */
+    uint64_t get_checkpoint_lsn();
+
+    /**
+     * @brief Returns the number of group commits
+     * @return the number of commits
+     */
+    uint64_t get_commit_count();
+
+    /**
+     * @brief Returns the number of committed records
+     * @return the number of records
+     */
+    uint64_t get_committed_record_count();
+
+    /**
+     * @brief Returns the number of bytes of the log read by the last recovery
+     * @return the number of bytes
+     */
+    uint64_t get_replayed_size();
+
+    /**
+     * @brief Returns the number of changes applied again by the last recovery
+     * @return the number of changes
+     */
+    uint64_t get_redone_count();
+
+    /**
+     * @brief Returns the number of records rolled back by the last recovery
+     * @return the number of records
+     */
+    uint64_t get_undone_count();
+
+    /**
+     * @brief Commits the remaining records and stops the writer. Once the pages are on disc the log is not needed anymore, so it is emptied
+     */
+    void destroy();
+};
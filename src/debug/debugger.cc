@@ -50,7 +50,7 @@ void Debuger::traverse_bplus_tree()
                 node << "BOuterNode:  " << outer_node->header.page_id << " at address: " << (void *)outer_node << " {";
                 for (int j = 0; j < outer_node->current_index; j++)
                 {
-                    node << " (Key: " << outer_node->keys[j] << ", Value: " << outer_node->values[j] << ")";
+                    node << " (Key: " << outer_node->get_key(j) << ", Value: " << outer_node->get_value_at(j) << ")";
                 }
                 node << "; Next Leaf: " << outer_node->next_lef_id << " }";
                 logger->debug(node.str());
@@ -166,7 +166,7 @@ bool Debuger::contains_key(int64_t key)
 
             for (int j = 0; j < outer_node->current_index; j++)
             {
-                if (outer_node->keys[j] == key)
+                if (outer_node->get_key(j) == key)
                 {
                     buffer_manager->unfix_page(current_id, false);
                     return true;
@@ -12,12 +12,17 @@
 
 #include "run_suite/run_config_one.h"
 #include "run_suite/run_config_two.h"
+#include "run_suite/run_config_three.h"
+#include "run_suite/run_config_four.h"
+#include "run_suite/run_config_five.h"
+#include "run_suite/run_config_six.h"
 #include <iostream>
 #include <stdio.h>
 #include <ctype.h>
 #include <unistd.h>
 #include <memory>
 #include <regex>
+#include <sstream>
 #include <spdlog/sinks/basic_file_sink.h>
 #include <spdlog/spdlog.h>
 #include <spdlog/logger.h>
@@ -26,15 +31,13 @@
 #include "configuration.h"
 #include "run_suite/workload.h"
 #include "run_suite/workloads_script.h"
+#include "utils/page_size.h"
 #include <boost/dynamic_bitset.hpp>
 #include <getopt.h>
 
 // configuration that will be executed, default is configuration one
 std::unique_ptr<RunConfig> run;
 
-// workload that will be executed
-std::unique_ptr<Workload> workload;
-
 // contains information about all parameters
 Configuration::Configuration configuration;
 
@@ -60,11 +63,29 @@ static struct option long_options[] = {
     {"help", no_argument, 0, 'h'},
     {"coefficient", required_argument, 0, 0},
     {"script", no_argument, 0, 's'},
+    {"buffer_policy", required_argument, 0, 0},
+    {"huge_pages", no_argument, 0, 0},
+    {"clean_fraction", required_argument, 0, 0},
+    {"prefetch_depth", required_argument, 0, 0},
+    {"direct_io", no_argument, 0, 0},
+    {"io_uring", no_argument, 0, 0},
+    {"mmap", no_argument, 0, 0},
+    {"persistent", no_argument, 0, 0},
+    {"wal", no_argument, 0, 0},
+    {"wal_commit_interval", required_argument, 0, 0},
+    {"compression", no_argument, 0, 0},
+    {"packed_leaves", no_argument, 0, 0},
+    {"indexed_inner_nodes", no_argument, 0, 0},
+    {"page_size", required_argument, 0, 0},
+    {"stripes", required_argument, 0, 0},
+    {"stripe_paths", required_argument, 0, 0},
+    {"fill_factor", required_argument, 0, 0},
+    {"threads", required_argument, 0, 0},
     {0, 0, 0, 0}};
 
 void print_help()
 {
-    printf(" -r, --run_config <run config> ........... Select which run configuration you want to choose. Currently available: 1, 2\n");
+    printf(" -r, --run_config <run config> ........... Select which run configuration you want to choose. Currently available: 1, 2, 3 (page table lookup benchmark), 4 (buffer manager thread scaling benchmark), 5 (recovery time benchmark), 6 (node search benchmark)\n");
     printf(" -w, --workload .......................... Select the workload (a, b, c, e, x), If no argument is specified, the general workload with the configured parameters is executed. Be aware that because the parameter is optional, it must in the same argv element, e.g. -we.\n");
     printf(" -s, ..................................... Runs the workload script.\n");
     printf(" -c, --cache  ............................ Activate cache. Creates a radix tree that is placed in front of the b+ tree to act as a cache.\n");
@@ -72,6 +93,24 @@ void print_help()
     printf(" -v, --verbosity_level <verbosity_level> . Sets the verbosity level for the program: 'o' (off), 'e' (error), 'c' (critical), 'w' (warn), 'i' (info), 'd' (debug), 't' (trace). By default info is used\n");
     printf(" -l, --log_mode <log_mode> ............... Specifies where the logs for the program are written to: 'f' (file), 'c' (console). By default, logs are written to the console when opening the menu\n");
     printf("--buffer_size <buffer_size>............... Set the buffer size.\n");
+    printf("--buffer_policy <buffer_policy>........... Set the replacement policy of the buffer: 'clock', 'lru-k', '2q' or 'arc'. By default clock is used.\n");
+    printf("--huge_pages ............................. Back the buffer with huge pages, falls back to transparent huge pages if none are reserved.\n");
+    printf("--clean_fraction <clean_fraction>......... Fraction of the buffer a background thread keeps clean by writing dirty pages ahead of eviction. By default 0, which disables the thread.\n");
+    printf("--prefetch_depth <prefetch_depth>......... Maximum number of leaves read ahead in the background during scans. By default 0, which disables prefetching.\n");
+    printf("--direct_io .............................. Open the data file with O_DIRECT so pages bypass the page cache of the kernel, needs a page size that is a multiple of 4096.\n");
+    printf("--io_uring ............................... Read and write pages through io_uring, batches of pages are submitted with one system call. Falls back to pread and pwrite if the kernel does not support it.\n");
+    printf("--mmap ................................... Read pages from a memory mapping of the data file instead of reading them into the buffer with system calls.\n");
+    printf("--persistent ............................. Keep the database in ./db after the run and open it again in the next run instead of loading the records. Only runs without inserts, updates and deletes leave a database that can be used again.\n");
+    printf("--wal .................................... Write inserts, updates and deletes to a log in ./db before they are applied. Records are committed in groups, so they share one write and one fdatasync.\n");
+    printf("--wal_commit_interval <interval>.......... Time in microseconds log records are collected before they are committed. With 0, every operation waits until its record is durable. By default 1000.\n");
+    printf("--compression ............................ Compress pages in the data file, a page takes as many slots of 512 bytes as it needs. Pages in the buffer stay uncompressed.\n");
+    printf("--packed_leaves .......................... Store the keys in the outer nodes of the b+ tree as differences to the smallest key of the node, in as few bytes as needed, so more records fit into a leaf.\n");
+    printf("--indexed_inner_nodes .................... Keep a search index behind the keys of the inner nodes of the b+ tree, a search reads one cache line per level of the index instead of jumping through all keys. The nodes hold about an eighth fewer keys.\n");
+    printf("--page_size <page_size>................... Set the page size of a workload: 4096, 8192, 16384, 32768 or 65536. By default 4096. Run configurations always use 4096.\n");
+    printf("--stripes <stripes>....................... Stripe the pages across several data files, page i is written to file i %% stripes. By default 1.\n");
+    printf("--stripe_paths <folder,folder,...>........ Place the data files of the stripes in these folders, e.g. on different devices. Stripes without a folder stay in ./db, the number of stripes is at least the number of folders.\n");
+    printf("--fill_factor <fill_factor>............... Fraction of the nodes of the b+ tree that is filled when the records are loaded, between 0.5 and 1. The tree is built bottom up from the sorted records. By default 0.9.\n");
+    printf("--threads <threads>....................... Split the operations of a workload across this many threads. Reads and changes of single leaves run in parallel, splits and merges wait for the other threads. Can not be combined with -c. By default 1.\n");
     printf("--radix_tree_size <radix_tree_size>....... Set the size of the cache.\n");
     printf("--record_count <record_count>............. Set the record count for a workload.\n");
     printf("--operation_count <operation_count>....... Set the operation count for a workload.\n");
@@ -200,6 +239,49 @@ void handle_arguments(int argc, char *argsv[])
                 configuration.radix_tree_size = atoll(optarg);
             else if (std::string(long_options[option_index].name) == "measure_per_operation")
                 configuration.measure_per_operation = true;
+            else if (std::string(long_options[option_index].name) == "buffer_policy")
+                configuration.buffer_policy = optarg;
+            else if (std::string(long_options[option_index].name) == "huge_pages")
+                configuration.huge_pages = true;
+            else if (std::string(long_options[option_index].name) == "clean_fraction")
+                configuration.clean_fraction = atof(optarg);
+            else if (std::string(long_options[option_index].name) == "prefetch_depth")
+                configuration.prefetch_depth = atoll(optarg);
+            else if (std::string(long_options[option_index].name) == "direct_io")
+                configuration.direct_io = true;
+            else if (std::string(long_options[option_index].name) == "io_uring")
+                configuration.io_uring = true;
+            else if (std::string(long_options[option_index].name) == "mmap")
+                configuration.mmap = true;
+            else if (std::string(long_options[option_index].name) == "persistent")
+                configuration.persistent = true;
+            else if (std::string(long_options[option_index].name) == "wal")
+                configuration.wal = true;
+            else if (std::string(long_options[option_index].name) == "wal_commit_interval")
+                configuration.wal_commit_interval = atoll(optarg);
+            else if (std::string(long_options[option_index].name) == "compression")
+                configuration.compression = true;
+            else if (std::string(long_options[option_index].name) == "packed_leaves")
+                configuration.packed_leaves = true;
+            else if (std::string(long_options[option_index].name) == "indexed_inner_nodes")
+                configuration.indexed_inner_nodes = true;
+            else if (std::string(long_options[option_index].name) == "page_size")
+                configuration.page_size = atoi(optarg);
+            else if (std::string(long_options[option_index].name) == "stripes")
+                configuration.stripe_count = atoll(optarg);
+            else if (std::string(long_options[option_index].name) == "stripe_paths")
+            {
+                std::stringstream paths(optarg);
+                std::string path;
+                while (std::getline(paths, path, ','))
+                {
+                    configuration.stripe_paths.push_back(path);
+                }
+            }
+            else if (std::string(long_options[option_index].name) == "fill_factor")
+                configuration.fill_factor = atof(optarg);
+            else if (std::string(long_options[option_index].name) == "threads")
+                configuration.thread_count = atoll(optarg);
             else if (std::string(long_options[option_index].name) == "coefficient")
                 configuration.coefficient = atof(optarg);
             break;
@@ -243,6 +325,19 @@ void handle_arguments(int argc, char *argsv[])
                     break;
                 case 2:
                     run.reset(new RunConfigTwo(configuration.buffer_size, configuration.cache, configuration.radix_tree_size));
+                    break;
+                case 3:
+                    run.reset(new RunConfigThree(configuration.buffer_size, configuration.cache, configuration.radix_tree_size));
+                    break;
+                case 4:
+                    run.reset(new RunConfigFour(configuration.buffer_size, configuration.cache, configuration.radix_tree_size));
+                    break;
+                case 5:
+                    run.reset(new RunConfigFive(configuration.buffer_size, configuration.cache, configuration.radix_tree_size));
+                    break;
+                case 6:
+                    run.reset(new RunConfigSix(configuration.buffer_size, configuration.cache, configuration.radix_tree_size));
+                    break;
                 default:
                     break;
                 }
@@ -259,33 +354,8 @@ void handle_arguments(int argc, char *argsv[])
         {
             configuration.run_workload = true;
             run_option_set = true;
-            if (optarg)
-            {
-                char arg = optarg[0];
-                switch (arg)
-                {
-                case 'a':
-                    workload.reset(new WorkloadA(configuration.buffer_size, configuration.record_count, configuration.operation_count, configuration.distribution, configuration.coefficient, configuration.cache, configuration.radix_tree_size, configuration.measure_per_operation));
-                    break;
-                case 'b':
-                    workload.reset(new WorkloadB(configuration.buffer_size, configuration.record_count, configuration.operation_count, configuration.distribution, configuration.coefficient, configuration.cache, configuration.radix_tree_size, configuration.measure_per_operation));
-                    break;
-                case 'c':
-                    workload.reset(new WorkloadC(configuration.buffer_size, configuration.record_count, configuration.operation_count, configuration.distribution, configuration.coefficient, configuration.cache, configuration.radix_tree_size, configuration.measure_per_operation));
-                    break;
-                case 'e':
-                    workload.reset(new WorkloadE(configuration.buffer_size, configuration.record_count, configuration.operation_count, configuration.distribution, configuration.coefficient, configuration.cache, configuration.radix_tree_size, configuration.measure_per_operation));
-                    break;
-                case 'x':
-                    workload.reset(new WorkloadX(configuration.buffer_size, configuration.record_count, configuration.operation_count, configuration.distribution, configuration.coefficient, configuration.cache, configuration.radix_tree_size, configuration.measure_per_operation));
-                    break;
-                }
-            }
-            else
-            {
-                workload.reset(new Workload(configuration.buffer_size, configuration.record_count, configuration.operation_count, configuration.distribution, configuration.coefficient, configuration.insert_proportion, configuration.read_proportion, configuration.update_proportion, configuration.scan_proportion, configuration.delete_proportion, configuration.cache, configuration.radix_tree_size, configuration.measure_per_operation));
-                break;
-            }
+            // the workload is created once the instantiation of the trees for its page size is known
+            configuration.workload = optarg ? optarg[0] : 0;
         }
         break;
         case 's':
@@ -306,6 +376,41 @@ void handle_arguments(int argc, char *argsv[])
     }
 }
 
+/**
+ * @brief Creates the selected workload with the configured parameters and executes it
+ */
+template <int PAGE_SIZE>
+void execute_workload()
+{
+    std::unique_ptr<Workload<PAGE_SIZE>> workload;
+    switch (configuration.workload)
+    {
+    case 'a':
+        workload.reset(new WorkloadA<PAGE_SIZE>(configuration.buffer_size, configuration.record_count, configuration.operation_count, configuration.distribution, configuration.coefficient, configuration.cache, configuration.radix_tree_size, configuration.measure_per_operation, configuration.buffer_policy, configuration.huge_pages, configuration.clean_fraction, configuration.prefetch_depth, configuration.direct_io, configuration.io_uring, configuration.mmap, configuration.persistent, configuration.wal, configuration.wal_commit_interval, configuration.compression, configuration.packed_leaves, configuration.indexed_inner_nodes, configuration.stripe_count, configuration.stripe_paths, configuration.fill_factor, configuration.thread_count));
+        break;
+    case 'b':
+        workload.reset(new WorkloadB<PAGE_SIZE>(configuration.buffer_size, configuration.record_count, configuration.operation_count, configuration.distribution, configuration.coefficient, configuration.cache, configuration.radix_tree_size, configuration.measure_per_operation, configuration.buffer_policy, configuration.huge_pages, configuration.clean_fraction, configuration.prefetch_depth, configuration.direct_io, configuration.io_uring, configuration.mmap, configuration.persistent, configuration.wal, configuration.wal_commit_interval, configuration.compression, configuration.packed_leaves, configuration.indexed_inner_nodes, configuration.stripe_count, configuration.stripe_paths, configuration.fill_factor, configuration.thread_count));
+        break;
+    case 'c':
+        workload.reset(new WorkloadC<PAGE_SIZE>(configuration.buffer_size, configuration.record_count, configuration.operation_count, configuration.distribution, configuration.coefficient, configuration.cache, configuration.radix_tree_size, configuration.measure_per_operation, configuration.buffer_policy, configuration.huge_pages, configuration.clean_fraction, configuration.prefetch_depth, configuration.direct_io, configuration.io_uring, configuration.mmap, configuration.persistent, configuration.wal, configuration.wal_commit_interval, configuration.compression, configuration.packed_leaves, configuration.indexed_inner_nodes, configuration.stripe_count, configuration.stripe_paths, configuration.fill_factor, configuration.thread_count));
+        break;
+    case 'e':
+        workload.reset(new WorkloadE<PAGE_SIZE>(configuration.buffer_size, configuration.record_count, configuration.operation_count, configuration.distribution, configuration.coefficient, configuration.cache, configuration.radix_tree_size, configuration.measure_per_operation, configuration.buffer_policy, configuration.huge_pages, configuration.clean_fraction, configuration.prefetch_depth, configuration.direct_io, configuration.io_uring, configuration.mmap, configuration.persistent, configuration.wal, configuration.wal_commit_interval, configuration.compression, configuration.packed_leaves, configuration.indexed_inner_nodes, configuration.stripe_count, configuration.stripe_paths, configuration.fill_factor, configuration.thread_count));
+        break;
+    case 'x':
+        workload.reset(new WorkloadX<PAGE_SIZE>(configuration.buffer_size, configuration.record_count, configuration.operation_count, configuration.distribution, configuration.coefficient, configuration.cache, configuration.radix_tree_size, configuration.measure_per_operation, configuration.buffer_policy, configuration.huge_pages, configuration.clean_fraction, configuration.prefetch_depth, configuration.direct_io, configuration.io_uring, configuration.mmap, configuration.persistent, configuration.wal, configuration.wal_commit_interval, configuration.compression, configuration.packed_leaves, configuration.indexed_inner_nodes, configuration.stripe_count, configuration.stripe_paths, configuration.fill_factor, configuration.thread_count));
+        break;
+    case 0:
+        workload.reset(new Workload<PAGE_SIZE>(configuration.buffer_size, configuration.record_count, configuration.operation_count, configuration.distribution, configuration.coefficient, configuration.insert_proportion, configuration.read_proportion, configuration.update_proportion, configuration.scan_proportion, configuration.delete_proportion, configuration.cache, configuration.radix_tree_size, configuration.measure_per_operation, configuration.buffer_policy, configuration.huge_pages, configuration.clean_fraction, configuration.prefetch_depth, configuration.direct_io, configuration.io_uring, configuration.mmap, configuration.persistent, configuration.wal, configuration.wal_commit_interval, configuration.compression, configuration.packed_leaves, configuration.indexed_inner_nodes, configuration.stripe_count, configuration.stripe_paths, configuration.fill_factor, configuration.thread_count));
+        break;
+    default:
+        std::cerr << "Error: Workload " << configuration.workload << " does not exist" << std::endl;
+        print_help();
+        exit(1);
+    }
+    workload->execute();
+}
+
 int main(int argc, char *argsv[])
 {
     handle_logging(argc, argsv);
@@ -319,7 +424,8 @@ int main(int argc, char *argsv[])
         }
         else
         {
-            workload->execute();
+            PageSize::dispatch(configuration.page_size, [](auto page_size)
+                               { execute_workload<decltype(page_size)::value>(); });
         }
     }
     else
@@ -9,18 +9,30 @@
 
 #include "./b_header.h"
 #include <stdint.h>
+#include <atomic>
+#include <shared_mutex>
 
 /**
  * @brief Frame that wraps around a header to store additional information used by the buffer manager
  */
 struct BFrame
 {
-    /// used to fix and unfix page and protect memory access
-    uint16_t fix_count = 0;
+    /// number of users that fixed the page, a fixed page is never evicted
+    std::atomic<uint16_t> fix_count{0};
     /// specifies if it needs to be written to memory
-    bool dirty = false;
-    /// used to implement a simple heuristic for the eviction of pages
-    bool marked = false;
+    std::atomic<bool> dirty{false};
+    /// reference bit for the clock sweep, set on every access and cleared when the clock hand passes
+    std::atomic<bool> marked{false};
+    /// position of the frame in the frame array of the buffer manager, used by the replacement policy
+    uint32_t index = 0;
+    /// log sequence number of the first logged change since the page was last written, 0 if there is none
+    std::atomic<uint64_t> rec_lsn{0};
+    /// page id the frame is registered under in the page table, stays valid after the header is reset when the page is deleted
+    uint64_t page_id = 0;
+    /// protects the content of the page, shared for readers and exclusive for writers
+    std::shared_mutex latch;
+    /// version of the content of the page, odd while a writer changes it. Readers that do not latch the page compare it before and after they read, it stays in front of the header so both share a cache line
+    std::atomic<uint64_t> version{0};
     /// contains the data of the page
     BHeader header;
 };
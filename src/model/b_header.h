@@ -14,22 +14,49 @@
  */
 struct BHeader
 {
-    /// id of the page
-    uint64_t page_id;
+    /// id of the page, 32 bits leave room for the checksum
+    uint32_t page_id;
+    /// CRC32C checksum of the page as it was last written, computed without this field, see PageChecksum
+    uint32_t checksum;
     /// specifies if inner or outer node
     bool inner = false;
-    /// padding to align to 8 byte
-    char padding[7];
+    /// if the keys of an outer node are packed, see BOuterNode
+    bool packed;
+    /// upper 16 bits of the log sequence number of the last log record that changed the page, kept by the constructor without arguments
+    uint16_t lsn_high;
+    /// lower 32 bits of the log sequence number, together 48 bits fit into the space that was padding before
+    uint32_t lsn_low;
+
+    /**
+     * @brief Returns the log sequence number of the last log record that changed the page
+     * @return the log sequence number, 0 if the page was not changed under the log
+     */
+    uint64_t get_lsn() const
+    {
+        return (static_cast<uint64_t>(lsn_high) << 32) | lsn_low;
+    }
+
+    /**
+     * @brief Sets the log sequence number of the last log record that changed the page
+     * @param lsn The log sequence number, only the lower 48 bits are kept
+     */
+    void set_lsn(uint64_t lsn)
+    {
+        lsn_high = static_cast<uint16_t>(lsn >> 32);
+        lsn_low = static_cast<uint32_t>(lsn);
+    }
 
     /**
      * @brief Constructor for the header
      * @param page_id_arg unique id for the page
      * @param inner_arg specifies if it will be an inner or outer node - all pages are nodes in this implementation
      */
-    BHeader(uint64_t page_id_arg, bool inner_arg) : page_id(page_id_arg), inner(inner_arg){};
+    BHeader(uint64_t page_id_arg, bool inner_arg) : page_id(static_cast<uint32_t>(page_id_arg)), checksum(0), inner(inner_arg), packed(false), lsn_high(0), lsn_low(0){};
 
     /**
      * @brief Constructor that does not change anything, can be used when correct values are already in the right memory position
      */
     BHeader() {}
-};
\ No newline at end of file
+};
+
+static_assert(sizeof(BHeader) == 16, "The nodes reserve a fixed amount of space for the header");
@@ -0,0 +1,87 @@
+#include "run_config_five.h"
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+void RunConfigFive::execute(bool benchmark)
+{
+    auto run = [this]
+    {
+        std::filesystem::path base_path = "./db/recovery/";
+        std::filesystem::remove_all(base_path);
+
+        // the buffer holds a fraction of the tree, so the crash leaves both written and unwritten changes behind
+        int64_t record_count = 2000000;
+        uint64_t recovery_buffer_size = 10000;
+        uint64_t commit_interval = 1000;
+
+        int pipe_fds[2];
+        if (pipe(pipe_fds) == -1)
+        {
+            logger->error("Creating the pipe to the loading process failed");
+            exit(1);
+        }
+        pid_t pid = fork();
+        if (pid == -1)
+        {
+            logger->error("Starting the loading process failed");
+            exit(1);
+        }
+        if (pid == 0)
+        {
+            // the child loads the records and keeps inserting until it is killed in the middle of an operation
+            close(pipe_fds[0]);
+            DataManager<Configuration::page_size> crashing_data_manager(recovery_buffer_size, false, 0, "clock", false, 0, 0, false, false, false, true, true, commit_interval, false, false, false, 1, {}, base_path);
+            for (int64_t key = 0; key < record_count; key++)
+            {
+                crashing_data_manager.insert(key, key);
+            }
+            char loaded = 1;
+            if (write(pipe_fds[1], &loaded, 1) != 1)
+                _exit(1);
+            for (int64_t key = record_count;; key++)
+            {
+                crashing_data_manager.insert(key, key);
+            }
+        }
+
+        close(pipe_fds[1]);
+        char loaded = 0;
+        if (read(pipe_fds[0], &loaded, 1) != 1)
+        {
+            logger->error("The loading process failed");
+            exit(1);
+        }
+        close(pipe_fds[0]);
+        // by now the writer committed the records of the loading phase
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        DataManager<Configuration::page_size> recovered_data_manager(recovery_buffer_size, false, 0, "clock", false, 0, 0, false, false, false, true, true, commit_interval, false, false, false, 1, {}, base_path);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        int64_t missing_records = 0;
+        for (int64_t key = 0; key < record_count; key += 97)
+        {
+            if (recovered_data_manager.get_value(key) != key)
+                missing_records++;
+        }
+
+        std::cout << "Recovered: " << recovered_data_manager.is_recovered() << "\n";
+        std::cout << "Recovery time: " << std::fixed << std::setprecision(3) << std::chrono::duration<double>(end - start).count() << " s\n";
+        std::cout << "Replayed log: " << recovered_data_manager.get_log_replayed_size() << " bytes\n";
+        std::cout << "Redone changes: " << recovered_data_manager.get_log_redone_count() << "\n";
+        std::cout << "Undone records: " << recovered_data_manager.get_log_undone_count() << "\n";
+        std::cout << "Missing records: " << missing_records << "\n";
+
+        recovered_data_manager.destroy();
+        std::filesystem::remove_all(base_path);
+    };
+    this->benchmark.measure(run, benchmark);
+}
@@ -0,0 +1,25 @@
+/**
+ * @file    run_config_five.h
+ *
+ * @author  Matteo Wohlrapp
+ * @date    16.10.2026
+ */
+
+#pragma once
+
+#include "run_config.h"
+
+/**
+ * @brief Measures how long it takes to recover a database from the log after the process that changed it was killed
+ */
+class RunConfigFive : public RunConfig
+{
+public:
+    RunConfigFive(int buffer_size_arg, bool cache_arg, int radix_tree_size_arg) : RunConfig(buffer_size_arg, cache_arg, radix_tree_size_arg) {}
+
+    /**
+     * @brief Execute a specific run with different operations on the database
+     * @param benchmark If the run should be benchmarked or not
+     */
+    void execute(bool benchmark) override;
+};
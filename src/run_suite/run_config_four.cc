@@ -0,0 +1,71 @@
+#include "run_config_four.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <thread>
+
+void RunConfigFour::execute(bool benchmark)
+{
+    auto run = []
+    {
+        std::filesystem::path base_path = "./db/scaling/";
+
+        // the pages fit into the buffer, so the run measures the hit path with one very hot page like the root of the tree
+        uint64_t page_count = 10000;
+        uint64_t requests_per_thread = 2000000;
+        StorageManager storage_manager(base_path, Configuration::page_size);
+        BufferManager buffer_manager(&storage_manager, page_count, Configuration::page_size);
+        for (uint64_t i = 0; i < page_count; i++)
+        {
+            BHeader *header = buffer_manager.create_new_page();
+            buffer_manager.unfix_page(header->page_id, true);
+        }
+
+        unsigned int max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+        double single_thread_throughput = 0;
+        for (unsigned int thread_count = 1; thread_count <= max_threads; thread_count *= 2)
+        {
+            std::vector<std::thread> threads;
+            std::atomic<uint64_t> checksum = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (unsigned int t = 0; t < thread_count; t++)
+            {
+                threads.emplace_back([&, t]()
+                                     {
+                                         std::mt19937 generator(t);
+                                         std::uniform_int_distribution<uint64_t> page_dist(1, page_count);
+                                         uint64_t local_checksum = 0;
+                                         for (uint64_t i = 0; i < requests_per_thread; i++)
+                                         {
+                                             // every second request goes to the hot page
+                                             uint64_t page_id = i % 2 == 0 ? 1 : page_dist(generator);
+                                             BHeader *header = buffer_manager.request_page(page_id);
+                                             buffer_manager.latch_page(header, false);
+                                             local_checksum += header->page_id;
+                                             buffer_manager.unlatch_page(header, false);
+                                             buffer_manager.unfix_page(page_id, false);
+                                         }
+                                         checksum += local_checksum;
+                                     });
+            }
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            double seconds = std::chrono::duration<double>(end - start).count();
+            double throughput = thread_count * requests_per_thread / seconds;
+            if (thread_count == 1)
+                single_thread_throughput = throughput;
+
+            std::cout << "Threads: " << thread_count << "\n";
+            std::cout << "Throughput: " << std::fixed << std::setprecision(2) << throughput << " requests/s\n";
+            std::cout << "Speedup: " << std::fixed << std::setprecision(2) << throughput / single_thread_throughput << "x\n";
+            std::cout << "Checksum: " << checksum << "\n\n";
+        }
+        buffer_manager.destroy();
+        storage_manager.destroy();
+    };
+    this->benchmark.measure(run, benchmark);
+}
@@ -0,0 +1,25 @@
+/**
+ * @file    run_config_four.h
+ *
+ * @author  Matteo Wohlrapp
+ * @date    16.10.2026
+ */
+
+#pragma once
+
+#include "run_config.h"
+
+/**
+ * @brief Measures how the throughput of the buffer manager scales with the number of threads that request pages at the same time
+ */
+class RunConfigFour : public RunConfig
+{
+public:
+    RunConfigFour(int buffer_size_arg, bool cache_arg, int radix_tree_size_arg) : RunConfig(buffer_size_arg, cache_arg, radix_tree_size_arg) {}
+
+    /**
+     * @brief Execute a specific run with different operations on the database
+     * @param benchmark If the run should be benchmarked or not
+     */
+    void execute(bool benchmark) override;
+};
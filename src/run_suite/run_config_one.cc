@@ -8,6 +8,7 @@
 #include <iostream>
 #include <unistd.h>
 #include <unordered_set>
+#include <random>
 
 void RunConfigOne::execute(bool benchmark)
 {
@@ -0,0 +1,120 @@
+#include "run_config_six.h"
+#include "../bplus_tree/key_search.h"
+#include "../utils/page_size.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <vector>
+
+/**
+ * @brief The binary search the nodes used before, as baseline
+ * @param keys The sorted keys
+ * @param count The number of keys
+ * @param key The key to look for
+ * @return the index of the first key that is greater or equal to the key
+ */
+static int branchy_search(const int64_t *keys, int count, int64_t key)
+{
+    int left = 0, right = count;
+    while (left < right)
+    {
+        int middle = left + (right - left) / 2;
+
+        if (keys[middle] < key)
+            left = middle + 1;
+        else
+            right = middle;
+    }
+    return left;
+}
+
+void RunConfigSix::execute(bool benchmark)
+{
+    auto run = []
+    {
+        // the nodes together are larger than the caches, so the lookups pay for the misses of a real descent
+        uint64_t node_count = 1024;
+        uint64_t lookup_count = 2000000;
+
+        for (int page_size : PageSize::supported)
+        {
+            PageSize::dispatch(page_size, [&](auto size)
+                               {
+                constexpr int PAGE_SIZE = decltype(size)::value;
+                int key_count = BInnerNode<PAGE_SIZE>().max_size;
+                std::mt19937 generator(42);
+
+                // keys of a node are sorted with random gaps, like the separators of a tree that was filled randomly
+                std::vector<int64_t> keys(node_count * key_count);
+                std::uniform_int_distribution<int64_t> gap_dist(1, 100);
+                for (uint64_t node = 0; node < node_count; node++)
+                {
+                    int64_t key = 0;
+                    for (int i = 0; i < key_count; i++)
+                    {
+                        key += gap_dist(generator);
+                        keys[node * key_count + i] = key;
+                    }
+                }
+                int64_t largest = 100 * key_count;
+
+                // random lookups are spread over all keys, skewed ones hit the smallest fifth of the keys of a node in four out of five lookups
+                std::uniform_int_distribution<uint64_t> node_dist(0, node_count - 1);
+                std::uniform_int_distribution<int64_t> key_dist(0, largest);
+                std::uniform_int_distribution<int64_t> hot_dist(0, largest / 5);
+                std::bernoulli_distribution hot(0.8);
+                std::vector<std::pair<uint64_t, int64_t>> random_lookups(lookup_count);
+                std::vector<std::pair<uint64_t, int64_t>> skewed_lookups(lookup_count);
+                for (uint64_t i = 0; i < lookup_count; i++)
+                {
+                    random_lookups[i] = {node_dist(generator) * key_count, key_dist(generator)};
+                    skewed_lookups[i] = {node_dist(generator) * key_count, hot(generator) ? hot_dist(generator) : key_dist(generator)};
+                }
+
+                std::cout << "Page size: " << PAGE_SIZE << ", keys per node: " << key_count << "\n";
+                auto measure = [&](const char *name, auto &&search)
+                {
+                    for (auto *lookups : {&random_lookups, &skewed_lookups})
+                    {
+                        // sum up the indexes so the searches can not be optimized away
+                        uint64_t checksum = 0;
+                        auto start = std::chrono::high_resolution_clock::now();
+                        for (auto &lookup : *lookups)
+                        {
+                            checksum += search(keys.data() + lookup.first, key_count, lookup.second);
+                        }
+                        auto end = std::chrono::high_resolution_clock::now();
+                        double time = std::chrono::duration<double, std::nano>(end - start).count() / lookup_count;
+                        std::cout << name << (lookups == &random_lookups ? " random: " : " skewed: ") << std::fixed << std::setprecision(2) << time << "ns (checksum " << checksum << ")\n";
+                    }
+                };
+
+                measure("Binary search", branchy_search);
+                measure("Branchless scalar", [](const int64_t *keys, int count, int64_t key)
+                        { return KeySearch::lower_bound(keys, count, key, KeySearch::Kernel::SCALAR); });
+                if (KeySearch::supports(KeySearch::Kernel::AVX2))
+                    measure("Branchless AVX2", [](const int64_t *keys, int count, int64_t key)
+                            { return KeySearch::lower_bound(keys, count, key, KeySearch::Kernel::AVX2); });
+                if (KeySearch::supports(KeySearch::Kernel::AVX512))
+                    measure("Branchless AVX-512", [](const int64_t *keys, int count, int64_t key)
+                            { return KeySearch::lower_bound(keys, count, key, KeySearch::Kernel::AVX512); });
+
+                // indexed nodes hold fewer keys, the largest ones of every node are left out and the lookups stay the same
+                int indexed_key_count = BInnerNode<PAGE_SIZE>::index_layout.capacity;
+                std::vector<char> pages(node_count * PAGE_SIZE);
+                for (uint64_t node = 0; node < node_count; node++)
+                {
+                    BInnerNode<PAGE_SIZE> *inner = new (pages.data() + node * PAGE_SIZE) BInnerNode<PAGE_SIZE>(true);
+                    std::copy(keys.data() + node * key_count, keys.data() + node * key_count + indexed_key_count, inner->keys);
+                    inner->current_index = indexed_key_count;
+                    inner->update_index();
+                }
+                std::cout << "Keys per indexed node: " << indexed_key_count << "\n";
+                measure("Indexed node", [&](const int64_t *node_keys, int, int64_t key)
+                        { return ((BInnerNode<PAGE_SIZE> *)(pages.data() + (node_keys - keys.data()) / key_count * PAGE_SIZE))->binary_search(key); });
+                std::cout << "\n"; });
+        }
+    };
+    this->benchmark.measure(run, benchmark);
+}
@@ -0,0 +1,25 @@
+/**
+ * @file    run_config_six.h
+ *
+ * @author  Matteo Wohlrapp
+ * @date    17.10.2026
+ */
+
+#pragma once
+
+#include "run_config.h"
+
+/**
+ * @brief Benchmarks the search inside the nodes of the b+ tree, the former binary search against the branchless search with every supported kernel and against indexed inner nodes
+ */
+class RunConfigSix : public RunConfig
+{
+public:
+    RunConfigSix(int buffer_size_arg, bool cache_arg, int radix_tree_size_arg) : RunConfig(buffer_size_arg, cache_arg, radix_tree_size_arg) {}
+
+    /**
+     * @brief Execute a specific run with different operations on the database
+     * @param benchmark If the run should be benchmarked or not
+     */
+    void execute(bool benchmark) override;
+};
@@ -0,0 +1,70 @@
+#include "run_config_three.h"
+#include "../data/page_table.h"
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <chrono>
+
+void RunConfigThree::execute(bool benchmark)
+{
+    auto run = []
+    {
+        uint64_t frame_counts[3] = {10000, 100000, 1000000};
+        uint64_t lookup_count = 10000000;
+        std::mt19937 generator(42);
+
+        for (auto &frame_count : frame_counts)
+        {
+            // frames are never touched, the tables only store the addresses
+            std::vector<BFrame> frames(frame_count);
+            std::map<uint64_t, BFrame *> map;
+            PageTable page_table(frame_count);
+
+            // page ids are handed out densely by the storage manager, so the buffer holds a random subset of a bigger id range
+            std::uniform_int_distribution<uint64_t> page_dist(1, frame_count * 4);
+            std::vector<uint64_t> page_ids;
+            while (page_ids.size() < frame_count)
+            {
+                uint64_t page_id = page_dist(generator);
+                if (map.count(page_id))
+                    continue;
+                map.emplace(page_id, &frames[page_ids.size()]);
+                page_table.insert(page_id, &frames[page_ids.size()]);
+                page_ids.push_back(page_id);
+            }
+
+            std::uniform_int_distribution<uint64_t> index_dist(0, frame_count - 1);
+            std::vector<uint64_t> lookups(lookup_count);
+            for (auto &lookup : lookups)
+            {
+                lookup = page_ids[index_dist(generator)];
+            }
+
+            // sum up the addresses so the lookups can not be optimized away
+            uintptr_t checksum = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (auto &lookup : lookups)
+            {
+                checksum += (uintptr_t)map.find(lookup)->second;
+            }
+            auto end = std::chrono::high_resolution_clock::now();
+            double map_time = std::chrono::duration<double, std::nano>(end - start).count() / lookup_count;
+
+            start = std::chrono::high_resolution_clock::now();
+            for (auto &lookup : lookups)
+            {
+                checksum -= (uintptr_t)page_table.find(lookup);
+            }
+            end = std::chrono::high_resolution_clock::now();
+            double page_table_time = std::chrono::duration<double, std::nano>(end - start).count() / lookup_count;
+
+            std::cout << "Frames: " << frame_count << "\n";
+            std::cout << "std::map lookup: " << std::fixed << std::setprecision(2) << map_time << "ns\n";
+            std::cout << "Page table lookup: " << std::fixed << std::setprecision(2) << page_table_time << "ns\n";
+            std::cout << "Speedup: " << std::fixed << std::setprecision(2) << map_time / page_table_time << "x\n";
+            std::cout << "Checksum: " << checksum << "\n\n";
+        }
+    };
+    this->benchmark.measure(run, benchmark);
+}
@@ -0,0 +1,25 @@
+/**
+ * @file    run_config_three.h
+ *
+ * @author  Matteo Wohlrapp
+ * @date    16.10.2026
+ */
+
+#pragma once
+
+#include "run_config.h"
+
+/**
+ * @brief Benchmarks the lookup latency of the page table of the buffer manager against a std::map
+ */
+class RunConfigThree : public RunConfig
+{
+public:
+    RunConfigThree(int buffer_size_arg, bool cache_arg, int radix_tree_size_arg) : RunConfig(buffer_size_arg, cache_arg, radix_tree_size_arg) {}
+
+    /**
+     * @brief Execute a specific run with different operations on the database
+     * @param benchmark If the run should be benchmarked or not
+     */
+    void execute(bool benchmark) override;
+};
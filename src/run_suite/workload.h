@@ -6,6 +6,8 @@
 #include <chrono>
 #include <random>
 #include <set>
+#include <thread>
+#include <atomic>
 #include "../data/data_manager.h"
 #include <sys/resource.h>
 #include <iostream>
@@ -13,6 +15,7 @@
 /**
  * @brief General abstraction for the YCSB workload
  */
+template <int PAGE_SIZE>
 class Workload
 {
 private:
@@ -27,9 +30,11 @@ private:
     double delete_proportion;
     bool measure_per_operation;
     int max_scan_range = 100;
+    double fill_factor; /// fraction of the nodes that is filled when the records are loaded
+    uint64_t thread_count; /// number of threads the operations are split across
 
     std::shared_ptr<spdlog::logger> logger;
-    DataManager<Configuration::page_size> data_manager;
+    DataManager<PAGE_SIZE> data_manager;
     std::vector<std::vector<double>> times;
     std::set<int64_t> records_set;
     std::vector<int64_t> records_vector; /// entries inserted into the DB
@@ -38,7 +43,13 @@ private:
     std::function<uint64_t()> index_distribution;
     std::uniform_int_distribution<int64_t> value_distribution;
     std::mt19937 generator;
-    int insert_index = 0; /// offset at the end of records that specifies where current insert operations draw elements from
+    std::atomic<uint64_t> insert_index{0}; /// offset at the end of records that specifies where current insert operations draw elements from
+    uint64_t evictions = 0; /// pages evicted from the buffer while running the operations
+    uint64_t dirty_evictions = 0; /// evicted pages that were written by the operation that evicted them
+    uint64_t prefetches = 0;      /// pages read ahead while running the operations
+    uint64_t prefetch_hits = 0;   /// requests that were served from a prefetched page
+    uint64_t prefetch_misses = 0; /// prefetched pages that were dropped before they were requested
+    uint64_t log_commits = 0;     /// group commits of the log while running the operations
 
     /**
      * @brief enumeration for the different kinds of operation possible
@@ -66,9 +77,11 @@ private:
         switch (op)
         {
         case INSERT:
-            data_manager.insert(records_vector[insert_index], records_vector[insert_index]);
-            insert_index++;
-            break;
+        {
+            uint64_t record_index = insert_index++;
+            data_manager.insert(records_vector[record_index], records_vector[record_index]);
+        }
+        break;
         case READ:
         {
             data_manager.get_value(records_vector[indice_vector[index]]);
@@ -164,11 +177,27 @@ private:
 
         records_set.clear();
 
-        // Inserting all elements
+        if (data_manager.is_reopened())
+        {
+            // the records are generated with a fixed seed, so a database loaded with the same record count contains them already
+            if (data_manager.get_record_count() != record_count)
+            {
+                logger->error("The existing database does not contain the {} records of this workload, remove ./db to load it again", record_count);
+                exit(1);
+            }
+            logger->info("Using the {} records of the existing database", record_count);
+            return;
+        }
+
+        // the records come sorted out of the set, so the tree is built bottom up instead of inserting them one by one
+        std::vector<std::pair<int64_t, int64_t>> entries;
+        entries.reserve(record_count);
         for (uint64_t i = 0; i < record_count; i++)
         {
-            data_manager.insert(records_vector[i], records_vector[i]);
+            entries.emplace_back(records_vector[i], records_vector[i]);
         }
+        data_manager.bulk_load(entries, fill_factor);
+        data_manager.set_record_count(record_count);
     }
 
     /**
@@ -182,39 +211,83 @@ private:
             exit(1);
         }
 
-        uint64_t thread_count = 1;
         uint64_t num_op_per_thread = operation_count / thread_count;
-
-        for (uint64_t t = 0; t < thread_count; t++)
+        uint64_t evictions_before_run = data_manager.get_eviction_count();
+        uint64_t dirty_evictions_before_run = data_manager.get_dirty_eviction_count();
+        uint64_t prefetches_before_run = data_manager.get_prefetch_count();
+        uint64_t prefetch_hits_before_run = data_manager.get_prefetch_hit_count();
+        uint64_t prefetch_misses_before_run = data_manager.get_prefetch_miss_count();
+        uint64_t log_commits_before_run = data_manager.get_log_commit_count();
+
+        // a changed tree can not be used as the loaded state by the next run, also not if the run crashes and the tree is recovered
+        if (insert_proportion + update_proportion + delete_proportion > 0)
+            data_manager.set_record_count(0);
+
+        // every thread runs a consecutive part of the operations and measures them on its own
+        std::vector<std::vector<std::vector<double>>> thread_times(thread_count, std::vector<std::vector<double>>(NUM_OPERATIONS));
+        auto run_operations = [this, num_op_per_thread, &thread_times](uint64_t t)
         {
+            uint64_t begin = num_op_per_thread * t;
+            uint64_t end = t + 1 == thread_count ? operation_count : begin + num_op_per_thread;
             if (measure_per_operation)
             {
-                std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
+                std::chrono::time_point<std::chrono::high_resolution_clock> start, end_time;
                 Operation op;
-                for (uint64_t i = thread_count * t; i < thread_count * t + num_op_per_thread; i++)
+                for (uint64_t i = begin; i < end; i++)
                 {
                     op = operations_vector[i];
                     start = std::chrono::high_resolution_clock::now();
                     perform_operation(op, i);
-                    end = std::chrono::high_resolution_clock::now();
-                    std::chrono::duration<double> elapsed = end - start;
-                    times[op].push_back(elapsed.count());
+                    end_time = std::chrono::high_resolution_clock::now();
+                    std::chrono::duration<double> elapsed = end_time - start;
+                    thread_times[t][op].push_back(elapsed.count());
                 }
             }
             else
             {
-                std::chrono::time_point<std::chrono::high_resolution_clock> total_start, total_end;
-
-                total_start = std::chrono::high_resolution_clock::now();
-                for (uint64_t i = thread_count * t; i < thread_count * t + num_op_per_thread; i++)
+                for (uint64_t i = begin; i < end; i++)
                 {
                     perform_operation(operations_vector[i], i);
                 }
-                total_end = std::chrono::high_resolution_clock::now();
-                std::chrono::duration<double> total_elapsed = total_end - total_start;
-                times[0].push_back(total_elapsed.count());
             }
+        };
+
+        std::chrono::time_point<std::chrono::high_resolution_clock> total_start, total_end;
+        total_start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> threads;
+        for (uint64_t t = 1; t < thread_count; t++)
+        {
+            threads.emplace_back(run_operations, t);
+        }
+        run_operations(0);
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+        total_end = std::chrono::high_resolution_clock::now();
+
+        if (measure_per_operation)
+        {
+            for (uint64_t t = 0; t < thread_count; t++)
+            {
+                for (int op = 0; op < NUM_OPERATIONS; op++)
+                {
+                    times[op].insert(times[op].end(), thread_times[t][op].begin(), thread_times[t][op].end());
+                }
+            }
+        }
+        else
+        {
+            std::chrono::duration<double> total_elapsed = total_end - total_start;
+            times[0].push_back(total_elapsed.count());
         }
+        evictions = data_manager.get_eviction_count() - evictions_before_run;
+        dirty_evictions = data_manager.get_dirty_eviction_count() - dirty_evictions_before_run;
+        prefetches = data_manager.get_prefetch_count() - prefetches_before_run;
+        prefetch_hits = data_manager.get_prefetch_hit_count() - prefetch_hits_before_run;
+        prefetch_misses = data_manager.get_prefetch_miss_count() - prefetch_misses_before_run;
+        log_commits = data_manager.get_log_commit_count() - log_commits_before_run;
+
     }
 
     /**
@@ -266,6 +339,11 @@ private:
 
             std::cout << "Total time for all operations: " << std::fixed << std::setprecision(2) << total_time << "s\n";
             std::cout << "Throughput: " << std::fixed << std::setprecision(2) << throughput << " operations/s\n";
+            std::cout << "Evictions: " << evictions << "\n";
+            std::cout << "Evictions per second: " << std::fixed << std::setprecision(2) << evictions / total_time << "\n";
+            std::cout << "Dirty evictions: " << dirty_evictions << "\n";
+            std::cout << "Prefetched pages: " << prefetches << ", hits: " << prefetch_hits << ", misses: " << prefetch_misses << "\n";
+            std::cout << "Log commits: " << log_commits << "\n";
         }
         else
         {
@@ -312,7 +390,12 @@ private:
             std::cout << "Total time: " << std::fixed << std::setprecision(10) << total_time << "s\n";
             std::cout << "Throughput: " << std::fixed << std::setprecision(10) << total_operations / total_time << "s\n";
             std::cout << "Cache Size: " << data_manager.get_cache_size() << std::endl;
-            std::cout << "Buffer Size: " << data_manager.get_current_buffer_size() * Configuration::page_size << std::endl;
+            std::cout << "Buffer Size: " << data_manager.get_current_buffer_size() * PAGE_SIZE << std::endl;
+            std::cout << "Evictions: " << evictions << "\n";
+            std::cout << "Evictions per second: " << std::fixed << std::setprecision(2) << evictions / total_time << "\n";
+            std::cout << "Dirty evictions: " << dirty_evictions << "\n";
+            std::cout << "Prefetched pages: " << prefetches << ", hits: " << prefetch_hits << ", misses: " << prefetch_misses << "\n";
+            std::cout << "Log commits: " << log_commits << std::endl;
         }
     }
 
@@ -332,16 +415,46 @@ public:
      * @param cache_arg If the cache is activated or not
      * @param radix_tree_size_arg The size of the cache
      * @param measure_per_operation_arg Decides about the type of measurements
+     * @param buffer_policy_arg The replacement policy of the buffer manager
+     * @param huge_pages_arg If the buffer should be backed by huge pages
+     * @param clean_fraction_arg Fraction of the buffer that is kept clean by the background flusher
+     * @param prefetch_depth_arg Maximum number of leaves read ahead during scans
+     * @param direct_io_arg If the data file should bypass the page cache of the kernel
+     * @param io_uring_arg If pages should be read and written through io_uring
+     * @param mmap_arg If pages should be read from a memory mapping of the data file
+     * @param persistent_arg If the database should be kept after the run and opened again by the next one
+     * @param wal_arg If inserts, updates and deletes should be written to a log before they are applied
+     * @param wal_commit_interval_arg Time in microseconds log records are collected before they are committed together
+     * @param compression_arg If pages should be compressed in the data file
+     * @param packed_leaves_arg If the keys in the outer nodes are packed
+     * @param indexed_inner_nodes_arg If the inner nodes carry a search index behind their keys
+     * @param stripe_count_arg Number of data files the pages are striped across
+     * @param stripe_paths_arg Folders of the data files, stripes without one are placed in ./db
+     * @param fill_factor_arg Fraction of the nodes of the b+ tree that is filled when the records are loaded
+     * @param thread_count_arg Number of threads the operations are split across
      */
-    Workload(uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, double insert_proportion_arg, double read_proportion_arg, double update_proportion_arg, double scan_proportion_arg, double delete_proportion_arg, bool cache_arg, uint64_t radix_tree_size_arg, bool measure_per_operation_arg) : record_count(record_count_arg), operation_count(operation_count_arg), distribution(distribution_arg), coefficient(coefficient_arg), insert_proportion(insert_proportion_arg), read_proportion(read_proportion_arg), update_proportion(update_proportion_arg), scan_proportion(scan_proportion_arg), delete_proportion(delete_proportion_arg), measure_per_operation(measure_per_operation_arg), data_manager(buffer_size_arg, cache_arg, radix_tree_size_arg)
+    Workload(uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, double insert_proportion_arg, double read_proportion_arg, double update_proportion_arg, double scan_proportion_arg, double delete_proportion_arg, bool cache_arg, uint64_t radix_tree_size_arg, bool measure_per_operation_arg, std::string buffer_policy_arg = "clock", bool huge_pages_arg = false, double clean_fraction_arg = 0, uint64_t prefetch_depth_arg = 0, bool direct_io_arg = false, bool io_uring_arg = false, bool mmap_arg = false, bool persistent_arg = false, bool wal_arg = false, uint64_t wal_commit_interval_arg = 0, bool compression_arg = false, bool packed_leaves_arg = false, bool indexed_inner_nodes_arg = false, uint64_t stripe_count_arg = 1, const std::vector<std::filesystem::path> &stripe_paths_arg = {}, double fill_factor_arg = 0.9, uint64_t thread_count_arg = 1) : record_count(record_count_arg), operation_count(operation_count_arg), distribution(distribution_arg), coefficient(coefficient_arg), insert_proportion(insert_proportion_arg), read_proportion(read_proportion_arg), update_proportion(update_proportion_arg), scan_proportion(scan_proportion_arg), delete_proportion(delete_proportion_arg), measure_per_operation(measure_per_operation_arg), fill_factor(fill_factor_arg), thread_count(thread_count_arg), data_manager(buffer_size_arg, cache_arg, radix_tree_size_arg, buffer_policy_arg, huge_pages_arg, clean_fraction_arg, prefetch_depth_arg, direct_io_arg, io_uring_arg, mmap_arg, persistent_arg, wal_arg, wal_commit_interval_arg, compression_arg, packed_leaves_arg, indexed_inner_nodes_arg, stripe_count_arg, stripe_paths_arg)
     {
         logger = spdlog::get("logger");
+        if (thread_count == 0)
+        {
+            logger->error("The operations need at least one thread");
+            exit(1);
+        }
+        // the radix tree is not safe for several threads
+        if (thread_count > 1 && cache_arg)
+        {
+            logger->error("The cache can only be used by one thread");
+            exit(1);
+        }
         times = std::vector<std::vector<double>>(NUM_OPERATIONS, std::vector<double>(0, 0.0));
         value_distribution = std::uniform_int_distribution<int64_t>(INT64_MIN + 1, INT64_MAX - 1);
         generator = std::mt19937(42);
         operations_vector.resize(operation_count_arg);
         indice_vector.resize(operation_count_arg);
         insert_index = record_count_arg;
+        // scan heavy workloads read along the leaf chain, the others mostly touch single pages
+        data_manager.advise_access(scan_proportion >= 0.5);
     }
 
     ~Workload()
@@ -371,7 +484,8 @@ public:
 /**
  * @brief Abstraction for the YCSB workload A
  */
-class WorkloadA : public Workload
+template <int PAGE_SIZE>
+class WorkloadA : public Workload<PAGE_SIZE>
 {
 public:
     /**
@@ -384,9 +498,26 @@ public:
      * @param cache_arg If the cache is activated or not
      * @param radix_tree_size_arg The size of the cache
      * @param measure_per_operation_arg Decides about the type of measurements
+     * @param buffer_policy_arg The replacement policy of the buffer manager
+     * @param huge_pages_arg If the buffer should be backed by huge pages
+     * @param clean_fraction_arg Fraction of the buffer that is kept clean by the background flusher
+     * @param prefetch_depth_arg Maximum number of leaves read ahead during scans
+     * @param direct_io_arg If the data file should bypass the page cache of the kernel
+     * @param io_uring_arg If pages should be read and written through io_uring
+     * @param mmap_arg If pages should be read from a memory mapping of the data file
+     * @param persistent_arg If the database should be kept after the run and opened again by the next one
+     * @param wal_arg If inserts, updates and deletes should be written to a log before they are applied
+     * @param wal_commit_interval_arg Time in microseconds log records are collected before they are committed together
+     * @param compression_arg If pages should be compressed in the data file
+     * @param packed_leaves_arg If the keys in the outer nodes are packed
+     * @param indexed_inner_nodes_arg If the inner nodes carry a search index behind their keys
+     * @param stripe_count_arg Number of data files the pages are striped across
+     * @param stripe_paths_arg Folders of the data files, stripes without one are placed in ./db
+     * @param fill_factor_arg Fraction of the nodes of the b+ tree that is filled when the records are loaded
+     * @param thread_count_arg Number of threads the operations are split across
      */
-    WorkloadA(uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, bool cache_arg, uint64_t radix_tree_size_arg, bool measure_per_operation_arg)
-        : Workload(buffer_size_arg, record_count_arg, operation_count_arg, distribution_arg, coefficient_arg, 0, 0.5, 0.5, 0, 0, cache_arg, radix_tree_size_arg, measure_per_operation_arg)
+    WorkloadA(uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, bool cache_arg, uint64_t radix_tree_size_arg, bool measure_per_operation_arg, std::string buffer_policy_arg = "clock", bool huge_pages_arg = false, double clean_fraction_arg = 0, uint64_t prefetch_depth_arg = 0, bool direct_io_arg = false, bool io_uring_arg = false, bool mmap_arg = false, bool persistent_arg = false, bool wal_arg = false, uint64_t wal_commit_interval_arg = 0, bool compression_arg = false, bool packed_leaves_arg = false, bool indexed_inner_nodes_arg = false, uint64_t stripe_count_arg = 1, const std::vector<std::filesystem::path> &stripe_paths_arg = {}, double fill_factor_arg = 0.9, uint64_t thread_count_arg = 1)
+        : Workload<PAGE_SIZE>(buffer_size_arg, record_count_arg, operation_count_arg, distribution_arg, coefficient_arg, 0, 0.5, 0.5, 0, 0, cache_arg, radix_tree_size_arg, measure_per_operation_arg, buffer_policy_arg, huge_pages_arg, clean_fraction_arg, prefetch_depth_arg, direct_io_arg, io_uring_arg, mmap_arg, persistent_arg, wal_arg, wal_commit_interval_arg, compression_arg, packed_leaves_arg, indexed_inner_nodes_arg, stripe_count_arg, stripe_paths_arg, fill_factor_arg, thread_count_arg)
     {
     }
 };
@@ -394,7 +525,8 @@ public:
 /**
  * @brief Abstraction for the YCSB workload B
  */
-class WorkloadB : public Workload
+template <int PAGE_SIZE>
+class WorkloadB : public Workload<PAGE_SIZE>
 {
 public:
     /**
@@ -407,9 +539,26 @@ public:
      * @param cache_arg If the cache is activated or not
      * @param radix_tree_size_arg The size of the cache
      * @param measure_per_operation_arg Decides about the type of measurements
+     * @param buffer_policy_arg The replacement policy of the buffer manager
+     * @param huge_pages_arg If the buffer should be backed by huge pages
+     * @param clean_fraction_arg Fraction of the buffer that is kept clean by the background flusher
+     * @param prefetch_depth_arg Maximum number of leaves read ahead during scans
+     * @param direct_io_arg If the data file should bypass the page cache of the kernel
+     * @param io_uring_arg If pages should be read and written through io_uring
+     * @param mmap_arg If pages should be read from a memory mapping of the data file
+     * @param persistent_arg If the database should be kept after the run and opened again by the next one
+     * @param wal_arg If inserts, updates and deletes should be written to a log before they are applied
+     * @param wal_commit_interval_arg Time in microseconds log records are collected before they are committed together
+     * @param compression_arg If pages should be compressed in the data file
+     * @param packed_leaves_arg If the keys in the outer nodes are packed
+     * @param indexed_inner_nodes_arg If the inner nodes carry a search index behind their keys
+     * @param stripe_count_arg Number of data files the pages are striped across
+     * @param stripe_paths_arg Folders of the data files, stripes without one are placed in ./db
+     * @param fill_factor_arg Fraction of the nodes of the b+ tree that is filled when the records are loaded
+     * @param thread_count_arg Number of threads the operations are split across
      */
-    WorkloadB(uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, bool cache_arg, uint64_t radix_tree_size_arg, bool measure_per_operation_arg)
-        : Workload(buffer_size_arg, record_count_arg, operation_count_arg, distribution_arg, coefficient_arg, 0, 0.95, 0.05, 0, 0, cache_arg, radix_tree_size_arg, measure_per_operation_arg)
+    WorkloadB(uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, bool cache_arg, uint64_t radix_tree_size_arg, bool measure_per_operation_arg, std::string buffer_policy_arg = "clock", bool huge_pages_arg = false, double clean_fraction_arg = 0, uint64_t prefetch_depth_arg = 0, bool direct_io_arg = false, bool io_uring_arg = false, bool mmap_arg = false, bool persistent_arg = false, bool wal_arg = false, uint64_t wal_commit_interval_arg = 0, bool compression_arg = false, bool packed_leaves_arg = false, bool indexed_inner_nodes_arg = false, uint64_t stripe_count_arg = 1, const std::vector<std::filesystem::path> &stripe_paths_arg = {}, double fill_factor_arg = 0.9, uint64_t thread_count_arg = 1)
+        : Workload<PAGE_SIZE>(buffer_size_arg, record_count_arg, operation_count_arg, distribution_arg, coefficient_arg, 0, 0.95, 0.05, 0, 0, cache_arg, radix_tree_size_arg, measure_per_operation_arg, buffer_policy_arg, huge_pages_arg, clean_fraction_arg, prefetch_depth_arg, direct_io_arg, io_uring_arg, mmap_arg, persistent_arg, wal_arg, wal_commit_interval_arg, compression_arg, packed_leaves_arg, indexed_inner_nodes_arg, stripe_count_arg, stripe_paths_arg, fill_factor_arg, thread_count_arg)
     {
     }
 };
@@ -417,7 +566,8 @@ public:
 /**
  * @brief Abstraction for the YCSB workload C
  */
-class WorkloadC : public Workload
+template <int PAGE_SIZE>
+class WorkloadC : public Workload<PAGE_SIZE>
 {
 public:
     /**
@@ -430,9 +580,26 @@ public:
      * @param cache_arg If the cache is activated or not
      * @param radix_tree_size_arg The size of the cache
      * @param measure_per_operation_arg Decides about the type of measurements
+     * @param buffer_policy_arg The replacement policy of the buffer manager
+     * @param huge_pages_arg If the buffer should be backed by huge pages
+     * @param clean_fraction_arg Fraction of the buffer that is kept clean by the background flusher
+     * @param prefetch_depth_arg Maximum number of leaves read ahead during scans
+     * @param direct_io_arg If the data file should bypass the page cache of the kernel
+     * @param io_uring_arg If pages should be read and written through io_uring
+     * @param mmap_arg If pages should be read from a memory mapping of the data file
+     * @param persistent_arg If the database should be kept after the run and opened again by the next one
+     * @param wal_arg If inserts, updates and deletes should be written to a log before they are applied
+     * @param wal_commit_interval_arg Time in microseconds log records are collected before they are committed together
+     * @param compression_arg If pages should be compressed in the data file
+     * @param packed_leaves_arg If the keys in the outer nodes are packed
+     * @param indexed_inner_nodes_arg If the inner nodes carry a search index behind their keys
+     * @param stripe_count_arg Number of data files the pages are striped across
+     * @param stripe_paths_arg Folders of the data files, stripes without one are placed in ./db
+     * @param fill_factor_arg Fraction of the nodes of the b+ tree that is filled when the records are loaded
+     * @param thread_count_arg Number of threads the operations are split across
      */
-    WorkloadC(uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, bool cache_arg, uint64_t radix_tree_size_arg, bool measure_per_operation_arg)
-        : Workload(buffer_size_arg, record_count_arg, operation_count_arg, distribution_arg, coefficient_arg, 0, 1, 0, 0, 0, cache_arg, radix_tree_size_arg, measure_per_operation_arg)
+    WorkloadC(uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, bool cache_arg, uint64_t radix_tree_size_arg, bool measure_per_operation_arg, std::string buffer_policy_arg = "clock", bool huge_pages_arg = false, double clean_fraction_arg = 0, uint64_t prefetch_depth_arg = 0, bool direct_io_arg = false, bool io_uring_arg = false, bool mmap_arg = false, bool persistent_arg = false, bool wal_arg = false, uint64_t wal_commit_interval_arg = 0, bool compression_arg = false, bool packed_leaves_arg = false, bool indexed_inner_nodes_arg = false, uint64_t stripe_count_arg = 1, const std::vector<std::filesystem::path> &stripe_paths_arg = {}, double fill_factor_arg = 0.9, uint64_t thread_count_arg = 1)
+        : Workload<PAGE_SIZE>(buffer_size_arg, record_count_arg, operation_count_arg, distribution_arg, coefficient_arg, 0, 1, 0, 0, 0, cache_arg, radix_tree_size_arg, measure_per_operation_arg, buffer_policy_arg, huge_pages_arg, clean_fraction_arg, prefetch_depth_arg, direct_io_arg, io_uring_arg, mmap_arg, persistent_arg, wal_arg, wal_commit_interval_arg, compression_arg, packed_leaves_arg, indexed_inner_nodes_arg, stripe_count_arg, stripe_paths_arg, fill_factor_arg, thread_count_arg)
     {
     }
 };
@@ -440,7 +607,8 @@ public:
 /**
  * @brief Abstraction for the YCSB workload E
  */
-class WorkloadE : public Workload
+template <int PAGE_SIZE>
+class WorkloadE : public Workload<PAGE_SIZE>
 {
 public:
     /**
@@ -453,9 +621,26 @@ public:
      * @param cache_arg If the cache is activated or not
      * @param radix_tree_size_arg The size of the cache
      * @param measure_per_operation_arg Decides about the type of measurements
+     * @param buffer_policy_arg The replacement policy of the buffer manager
+     * @param huge_pages_arg If the buffer should be backed by huge pages
+     * @param clean_fraction_arg Fraction of the buffer that is kept clean by the background flusher
+     * @param prefetch_depth_arg Maximum number of leaves read ahead during scans
+     * @param direct_io_arg If the data file should bypass the page cache of the kernel
+     * @param io_uring_arg If pages should be read and written through io_uring
+     * @param mmap_arg If pages should be read from a memory mapping of the data file
+     * @param persistent_arg If the database should be kept after the run and opened again by the next one
+     * @param wal_arg If inserts, updates and deletes should be written to a log before they are applied
+     * @param wal_commit_interval_arg Time in microseconds log records are collected before they are committed together
+     * @param compression_arg If pages should be compressed in the data file
+     * @param packed_leaves_arg If the keys in the outer nodes are packed
+     * @param indexed_inner_nodes_arg If the inner nodes carry a search index behind their keys
+     * @param stripe_count_arg Number of data files the pages are striped across
+     * @param stripe_paths_arg Folders of the data files, stripes without one are placed in ./db
+     * @param fill_factor_arg Fraction of the nodes of the b+ tree that is filled when the records are loaded
+     * @param thread_count_arg Number of threads the operations are split across
      */
-    WorkloadE(uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, bool cache_arg, uint64_t radix_tree_size_arg, bool measure_per_operation_arg)
-        : Workload(buffer_size_arg, record_count_arg, operation_count_arg, distribution_arg, coefficient_arg, 0.05, 0, 0, 0.95, 0, cache_arg, radix_tree_size_arg, measure_per_operation_arg)
+    WorkloadE(uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, bool cache_arg, uint64_t radix_tree_size_arg, bool measure_per_operation_arg, std::string buffer_policy_arg = "clock", bool huge_pages_arg = false, double clean_fraction_arg = 0, uint64_t prefetch_depth_arg = 0, bool direct_io_arg = false, bool io_uring_arg = false, bool mmap_arg = false, bool persistent_arg = false, bool wal_arg = false, uint64_t wal_commit_interval_arg = 0, bool compression_arg = false, bool packed_leaves_arg = false, bool indexed_inner_nodes_arg = false, uint64_t stripe_count_arg = 1, const std::vector<std::filesystem::path> &stripe_paths_arg = {}, double fill_factor_arg = 0.9, uint64_t thread_count_arg = 1)
+        : Workload<PAGE_SIZE>(buffer_size_arg, record_count_arg, operation_count_arg, distribution_arg, coefficient_arg, 0.05, 0, 0, 0.95, 0, cache_arg, radix_tree_size_arg, measure_per_operation_arg, buffer_policy_arg, huge_pages_arg, clean_fraction_arg, prefetch_depth_arg, direct_io_arg, io_uring_arg, mmap_arg, persistent_arg, wal_arg, wal_commit_interval_arg, compression_arg, packed_leaves_arg, indexed_inner_nodes_arg, stripe_count_arg, stripe_paths_arg, fill_factor_arg, thread_count_arg)
     {
     }
 };
@@ -463,7 +648,8 @@ public:
 /**
  * @brief Abstraction for the YCSB workload X
  */
-class WorkloadX : public Workload
+template <int PAGE_SIZE>
+class WorkloadX : public Workload<PAGE_SIZE>
 {
 public:
     /**
@@ -476,9 +662,26 @@ public:
      * @param cache_arg If the cache is activated or not
      * @param radix_tree_size_arg The size of the cache
      * @param measure_per_operation_arg Decides about the type of measurements
+     * @param buffer_policy_arg The replacement policy of the buffer manager
+     * @param huge_pages_arg If the buffer should be backed by huge pages
+     * @param clean_fraction_arg Fraction of the buffer that is kept clean by the background flusher
+     * @param prefetch_depth_arg Maximum number of leaves read ahead during scans
+     * @param direct_io_arg If the data file should bypass the page cache of the kernel
+     * @param io_uring_arg If pages should be read and written through io_uring
+     * @param mmap_arg If pages should be read from a memory mapping of the data file
+     * @param persistent_arg If the database should be kept after the run and opened again by the next one
+     * @param wal_arg If inserts, updates and deletes should be written to a log before they are applied
+     * @param wal_commit_interval_arg Time in microseconds log records are collected before they are committed together
+     * @param compression_arg If pages should be compressed in the data file
+     * @param packed_leaves_arg If the keys in the outer nodes are packed
+     * @param indexed_inner_nodes_arg If the inner nodes carry a search index behind their keys
+     * @param stripe_count_arg Number of data files the pages are striped across
+     * @param stripe_paths_arg Folders of the data files, stripes without one are placed in ./db
+     * @param fill_factor_arg Fraction of the nodes of the b+ tree that is filled when the records are loaded
+     * @param thread_count_arg Number of threads the operations are split across
      */
-    WorkloadX(uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, bool cache_arg, uint64_t radix_tree_size_arg, bool measure_per_operation_arg)
-        : Workload(buffer_size_arg, record_count_arg, operation_count_arg, distribution_arg, coefficient_arg, 0, 0.90, 0, 0, 0.1, cache_arg, radix_tree_size_arg, measure_per_operation_arg)
+    WorkloadX(uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, bool cache_arg, uint64_t radix_tree_size_arg, bool measure_per_operation_arg, std::string buffer_policy_arg = "clock", bool huge_pages_arg = false, double clean_fraction_arg = 0, uint64_t prefetch_depth_arg = 0, bool direct_io_arg = false, bool io_uring_arg = false, bool mmap_arg = false, bool persistent_arg = false, bool wal_arg = false, uint64_t wal_commit_interval_arg = 0, bool compression_arg = false, bool packed_leaves_arg = false, bool indexed_inner_nodes_arg = false, uint64_t stripe_count_arg = 1, const std::vector<std::filesystem::path> &stripe_paths_arg = {}, double fill_factor_arg = 0.9, uint64_t thread_count_arg = 1)
+        : Workload<PAGE_SIZE>(buffer_size_arg, record_count_arg, operation_count_arg, distribution_arg, coefficient_arg, 0, 0.90, 0, 0, 0.1, cache_arg, radix_tree_size_arg, measure_per_operation_arg, buffer_policy_arg, huge_pages_arg, clean_fraction_arg, prefetch_depth_arg, direct_io_arg, io_uring_arg, mmap_arg, persistent_arg, wal_arg, wal_commit_interval_arg, compression_arg, packed_leaves_arg, indexed_inner_nodes_arg, stripe_count_arg, stripe_paths_arg, fill_factor_arg, thread_count_arg)
     {
     }
 };
\ No newline at end of file
@@ -7,8 +7,10 @@
 #include <set>
 #include "../data/data_manager.h"
 #include "../utils/time.h"
+#include "../utils/page_size.h"
 #include <sys/resource.h>
 #include <iostream>
+#include <fstream>
 
 /**
  * @brief General abstraction for the YCSB workload
@@ -22,9 +24,9 @@ private:
     uint64_t operation_count = 20000000;
     uint64_t record_count = 10000000;
     int max_scan_range = 100;
+    double fill_factor = 0.9; /// fraction of the nodes that is filled when the records are loaded
 
     std::shared_ptr<spdlog::logger> logger;
-    DataManager<Configuration::page_size> data_manager;
     std::vector<std::vector<double>> times;
     std::set<int64_t> records_set;
     std::vector<int64_t> records_vector; /// entries inserted into the DB
@@ -40,6 +42,9 @@ private:
     uint64_t record_counts[5] = {2000000, 4000000, 6000000, 8000000, 10000000};
     double coefficients[4] = {0.0009, 0.009, 0.09, 0.9};
     std::vector<std::string> distributions = {"uniform", "geometric"};
+    std::vector<std::string> buffer_policies = {"clock", "lru-k", "2q", "arc"};
+    bool mmaps[2] = {false, true};
+    int64_t commit_intervals[5] = {-1, 0, 100, 1000, 10000}; /// commit intervals of the log in microseconds, -1 runs without a log
     bool caches[2] = {true, false};
     double workloads[5][5] = {
         {0, 0.5, 0.5, 0, 0}, {0, 0.95, 0.05, 0, 0}, {0, 1, 0, 0, 0}, {0.05, 0, 0, 0.95, 0}, {0, 0.90, 0, 0, 0.1}};
@@ -61,10 +66,12 @@ private:
 
     /**
      * @brief Abstraction to perform an operation on the database
+     * @param data_manager The database of the current run
      * @param op The operation
      * @param index The index of the key in the indices array
      */
-    void perform_operation(Operation op, int index)
+    template <int PAGE_SIZE>
+    void perform_operation(DataManager<PAGE_SIZE> &data_manager, Operation op, int index)
     {
         switch (op)
         {
@@ -109,8 +116,13 @@ private:
      * @param radix_tree_size_arg The size of the cache
      * @param workload_arg The workload that is run
      * @param inverse Specifies if the elements are inserted from the front or the back of the array
+     * @param buffer_policy_arg The replacement policy of the buffer manager
+     * @param mmap_arg If pages are read from a memory mapping of the data file
+     * @param commit_interval_arg Commit interval of the log in microseconds, -1 runs without a log
+     * @param packed_leaves_arg If the keys in the outer nodes are packed
+     * @param page_size_arg The size of the pages, one of PageSize::supported
      */
-    void run_workload(std::string test_name, int iteration, uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, double insert_proportion_arg, double read_proportion_arg, double update_proportion_arg, double scan_proportion_arg, double delete_proportion_arg, bool cache_arg, uint64_t radix_tree_size_arg, int workload_arg, bool inverse = false)
+    void run_workload(std::string test_name, int iteration, uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, double insert_proportion_arg, double read_proportion_arg, double update_proportion_arg, double scan_proportion_arg, double delete_proportion_arg, bool cache_arg, uint64_t radix_tree_size_arg, int workload_arg, bool inverse = false, std::string buffer_policy_arg = "clock", bool mmap_arg = false, int64_t commit_interval_arg = -1, bool packed_leaves_arg = false, int page_size_arg = Configuration::page_size)
     {
         std::cout << "Starting iteration " << iteration << " of test " << test_name << std::endl
                   << std::flush;
@@ -123,83 +135,92 @@ private:
 
         times = std::vector<std::vector<double>>(NUM_OPERATIONS, std::vector<double>(0, 0.0));
 
-        data_manager = DataManager<Configuration::page_size>(buffer_size_arg, cache_arg, radix_tree_size_arg);
+        // the trees and the data manager are instantiated for every supported page size
+        PageSize::dispatch(page_size_arg, [&](auto page_size)
+                           {
+            DataManager<decltype(page_size)::value> data_manager(buffer_size_arg, cache_arg, radix_tree_size_arg, buffer_policy_arg, false, 0, 0, false, false, mmap_arg, false, commit_interval_arg >= 0, std::max<int64_t>(commit_interval_arg, 0), false, packed_leaves_arg);
+            data_manager.advise_access(scan_proportion_arg >= 0.5);
 
-        if (distribution_arg == "uniform")
-        {
-            std::uniform_int_distribution<uint64_t> dist(0, record_count_arg - 1);
-
-            // Store the lambda function
-            index_distribution = [this, dist]() mutable -> uint64_t
-            { return dist(rd); };
-        }
-        else if (distribution_arg == "geometric")
-        {
-            std::geometric_distribution<uint64_t> dist(coefficient_arg);
+            if (distribution_arg == "uniform")
+            {
+                std::uniform_int_distribution<uint64_t> dist(0, record_count_arg - 1);
 
-            index_distribution = [this, dist, record_count_arg]() mutable -> uint64_t
+                // Store the lambda function
+                index_distribution = [this, dist]() mutable -> uint64_t
+                { return dist(rd); };
+            }
+            else if (distribution_arg == "geometric")
             {
-                uint64_t num = dist(generator);
-                if (num >= record_count_arg)
-                    num = record_count_arg - 1;
-                return num;
-            };
-        }
+                std::geometric_distribution<uint64_t> dist(coefficient_arg);
 
-        std::vector<double> weights = {insert_proportion_arg, read_proportion_arg, update_proportion_arg, scan_proportion_arg, delete_proportion_arg};
+                index_distribution = [this, dist, record_count_arg]() mutable -> uint64_t
+                {
+                    uint64_t num = dist(generator);
+                    if (num >= record_count_arg)
+                        num = record_count_arg - 1;
+                    return num;
+                };
+            }
 
-        // Use for discrete distribution
-        std::discrete_distribution<> op_dist(weights.begin(), weights.end());
+            std::vector<double> weights = {insert_proportion_arg, read_proportion_arg, update_proportion_arg, scan_proportion_arg, delete_proportion_arg};
 
-        for (uint64_t i = 0; i < operation_count_arg; i++)
-        {
-            Operation op = static_cast<Operation>(op_dist(rd));
-            operations_vector[i] = op;
+            // Use for discrete distribution
+            std::discrete_distribution<> op_dist(weights.begin(), weights.end());
 
-            int index = index_distribution();
-            indice_vector[i] = index;
-        }
-        // Inserting all elements
-        if (!inverse)
-        {
-            for (uint64_t i = 0; i < record_count_arg; i++)
+            for (uint64_t i = 0; i < operation_count_arg; i++)
             {
-                data_manager.insert(records_vector[i], records_vector[i]);
+                Operation op = static_cast<Operation>(op_dist(rd));
+                operations_vector[i] = op;
+
+                int index = index_distribution();
+                indice_vector[i] = index;
             }
-        }
-        else
-        {
-            for (uint64_t i = 0; i < record_count_arg; i++)
+            // Inserting all elements, the sorted records are bulk loaded, the inverse order measures inserts from the back
+            if (!inverse)
             {
-                data_manager.insert(records_vector[record_count_arg - i - 1], records_vector[record_count_arg - i - 1]);
+                std::vector<std::pair<int64_t, int64_t>> entries;
+                entries.reserve(record_count_arg);
+                for (uint64_t i = 0; i < record_count_arg; i++)
+                {
+                    entries.emplace_back(records_vector[i], records_vector[i]);
+                }
+                data_manager.bulk_load(entries, fill_factor);
+            }
+            else
+            {
+                for (uint64_t i = 0; i < record_count_arg; i++)
+                {
+                    data_manager.insert(records_vector[record_count_arg - i - 1], records_vector[record_count_arg - i - 1]);
+                }
             }
-        }
 
-        insert_index = record_count_arg;
+            insert_index = record_count_arg;
 
-        const int thread_count = 1;
-        int num_op_per_thread = operation_count_arg / thread_count;
+            const int thread_count = 1;
+            int num_op_per_thread = operation_count_arg / thread_count;
+            uint64_t evictions_before_run = data_manager.get_eviction_count();
 
-        for (int t = 0; t < thread_count; t++)
-        {
-            std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
-            Operation op;
-            for (int i = thread_count * t; i < thread_count * t + num_op_per_thread; i++)
+            for (int t = 0; t < thread_count; t++)
             {
-                op = operations_vector[i];
-                start = std::chrono::high_resolution_clock::now();
-                perform_operation(op, i);
-                end = std::chrono::high_resolution_clock::now();
-                std::chrono::duration<double> elapsed = end - start;
-                times[op].push_back(elapsed.count());
+                std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
+                Operation op;
+                for (int i = thread_count * t; i < thread_count * t + num_op_per_thread; i++)
+                {
+                    op = operations_vector[i];
+                    start = std::chrono::high_resolution_clock::now();
+                    perform_operation(data_manager, op, i);
+                    end = std::chrono::high_resolution_clock::now();
+                    std::chrono::duration<double> elapsed = end - start;
+                    times[op].push_back(elapsed.count());
+                }
             }
-        }
-        uint64_t cache_size = data_manager.get_cache_size();
-        uint64_t current_buffer_size = data_manager.get_current_buffer_size();
+            uint64_t cache_size = data_manager.get_cache_size();
+            uint64_t current_buffer_size = data_manager.get_current_buffer_size();
+            uint64_t evictions = data_manager.get_eviction_count() - evictions_before_run;
 
-        analyze(test_name, iteration, buffer_size_arg, record_count_arg, operation_count_arg, distribution_arg, coefficient_arg, insert_proportion_arg, read_proportion_arg, update_proportion_arg, scan_proportion_arg, delete_proportion_arg, cache_arg, radix_tree_size_arg, cache_size, current_buffer_size, workload_arg);
+            analyze(test_name, iteration, buffer_size_arg, record_count_arg, operation_count_arg, distribution_arg, coefficient_arg, insert_proportion_arg, read_proportion_arg, update_proportion_arg, scan_proportion_arg, delete_proportion_arg, cache_arg, radix_tree_size_arg, cache_size, current_buffer_size, evictions, workload_arg, buffer_policy_arg, mmap_arg, commit_interval_arg, packed_leaves_arg, page_size_arg);
 
-        data_manager.destroy();
+            data_manager.destroy(); });
     }
     /**
      * @brief Initializes the vectors for records, operations and indices
@@ -247,9 +268,15 @@ private:
      * @param radix_tree_size_arg The size of the cache
      * @param cache_size_arg The actual size of the cache
      * @param current_buffer_size_arg The size of the buffer
+     * @param evictions_arg The number of pages evicted while running the operations
      * @param workload_arg The workload that is run
+     * @param buffer_policy_arg The replacement policy of the buffer manager
+     * @param mmap_arg If pages were read from a memory mapping of the data file
+     * @param commit_interval_arg Commit interval of the log in microseconds, -1 if no log was written
+     * @param packed_leaves_arg If the keys in the outer nodes were packed
+     * @param page_size_arg The size of the pages
      */
-    void analyze(std::string test_name, int iteration, uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, double insert_proportion_arg, double read_proportion_arg, double update_proportion_arg, double scan_proportion_arg, double delete_proportion_arg, bool cache_arg, uint64_t radix_tree_size_arg, uint64_t cache_size_arg, uint64_t current_buffer_size_arg, int workload_arg)
+    void analyze(std::string test_name, int iteration, uint64_t buffer_size_arg, uint64_t record_count_arg, uint64_t operation_count_arg, std::string distribution_arg, double coefficient_arg, double insert_proportion_arg, double read_proportion_arg, double update_proportion_arg, double scan_proportion_arg, double delete_proportion_arg, bool cache_arg, uint64_t radix_tree_size_arg, uint64_t cache_size_arg, uint64_t current_buffer_size_arg, uint64_t evictions_arg, int workload_arg, std::string buffer_policy_arg, bool mmap_arg, int64_t commit_interval_arg, bool packed_leaves_arg, int page_size_arg)
     {
         std::vector<OperationResult> operation_results(NUM_OPERATIONS);
 
@@ -307,7 +334,8 @@ private:
                      << result.percentile_95 << "," << result.percentile_99 << ",";
         }
         csv_file << cache_size_arg << "," << current_buffer_size_arg << "," << std::fixed << std::setprecision(2) << total_time << ","
-                 << total_operations / total_time << "\n";
+                 << total_operations / total_time << "," << evictions_arg << "," << evictions_arg / total_time << "," << buffer_policy_arg << "," << (mmap_arg ? "mmap" : "buffer") << ","
+                 << (commit_interval_arg >= 0 ? std::to_string(commit_interval_arg) : "none") << "," << (packed_leaves_arg ? "packed" : "plain") << "," << page_size_arg << "\n";
         csv_file.close();
     }
 
@@ -315,17 +343,16 @@ public:
     /**
      * @brief Constructor for the workload script
      */
-    WorkloadScript() : data_manager(1, false, 1)
+    WorkloadScript()
     {
         logger = spdlog::get("logger");
         value_distribution = std::uniform_int_distribution<int64_t>(INT64_MIN + 1, INT64_MAX - 1);
         generator = std::mt19937(42);
         times = std::vector<std::vector<double>>(NUM_OPERATIONS, std::vector<double>(0, 0.0));
-        data_manager.destroy();
         std::string prefix = Time::getDateTime();
         results_filename = "../results/" + prefix + "test_results.csv";
         csv_file.open(results_filename, std::ios_base::app);
-        csv_file << "TestName,Iteration,BufferSize,RecordCount,OperationCount,Distribution,Workload,InsertProportion,ReadProportion,UpdateProportion,ScanProportion,DeleteProportion,Cache,RadixTreeSize,Coefficient,InsertOperationCount,InsertTotalTime,InsertMeanTime,InsertMedianTime,Insert90Percentile,Insert95Percentile,Insert99Percentile,ReadOperationCount,ReadTotalTime,ReadMeanTime,ReadMedianTime,Read90Percentile,Read95Percentile,Read99Percentile,UpdateOperationCount,UpdateTotalTime,UpdateMeanTime,UpdateMedianTime,Update90Percentile,Update95Percentile,Update99Percentile,ScanOperationCount,ScanTotalTime,ScanMeanTime,ScanMedianTime,Scan90Percentile,Scan95Percentile,Scan99Percentile,DeleteOperationCount,DeleteTotalTime,DeleteMeanTime,DeleteMedianTime,Delete90Percentile,Delete95Percentile,Delete99Percentile,CacheSize,CurrentBufferSize,TotalTime,Throughput\n";
+        csv_file << "TestName,Iteration,BufferSize,RecordCount,OperationCount,Distribution,Workload,InsertProportion,ReadProportion,UpdateProportion,ScanProportion,DeleteProportion,Cache,RadixTreeSize,Coefficient,InsertOperationCount,InsertTotalTime,InsertMeanTime,InsertMedianTime,Insert90Percentile,Insert95Percentile,Insert99Percentile,ReadOperationCount,ReadTotalTime,ReadMeanTime,ReadMedianTime,Read90Percentile,Read95Percentile,Read99Percentile,UpdateOperationCount,UpdateTotalTime,UpdateMeanTime,UpdateMedianTime,Update90Percentile,Update95Percentile,Update99Percentile,ScanOperationCount,ScanTotalTime,ScanMeanTime,ScanMedianTime,Scan90Percentile,Scan95Percentile,Scan99Percentile,DeleteOperationCount,DeleteTotalTime,DeleteMeanTime,DeleteMedianTime,Delete90Percentile,Delete95Percentile,Delete99Percentile,CacheSize,CurrentBufferSize,TotalTime,Throughput,Evictions,EvictionsPerSecond,BufferPolicy,StorageMode,CommitInterval,LeafLayout,PageSize\n";
         csv_file.close();
     }
 
@@ -394,14 +421,10 @@ public:
         {
             for (auto &memory_distribution_l : memory_distributions)
             {
-                if (memory_distribution_l[0] == 0)
+                // every split of the memory runs with both leaf layouts, packed leaves hold more records in the same buffer
+                for (bool packed_leaves_l : {false, true})
                 {
-                    run_workload("vary memory distribution", iteration, memory_distribution_l[1], record_count, operation_count, "geometric", 0.001, workloads[i][0], workloads[i][1], workloads[i][2], workloads[i][3], workloads[i][4], false, memory_distribution_l[0], i);
-                    iteration++;
-                }
-                else
-                {
-                    run_workload("vary memory distribution", iteration, memory_distribution_l[1], record_count, operation_count, "geometric", 0.001, workloads[i][0], workloads[i][1], workloads[i][2], workloads[i][3], workloads[i][4], true, memory_distribution_l[0], i);
+                    run_workload("vary memory distribution", iteration, memory_distribution_l[1], record_count, operation_count, "geometric", 0.001, workloads[i][0], workloads[i][1], workloads[i][2], workloads[i][3], workloads[i][4], memory_distribution_l[0] != 0, memory_distribution_l[0], i, false, "clock", false, -1, packed_leaves_l);
                     iteration++;
                 }
             }
@@ -409,6 +432,61 @@ public:
 
         std::cout << "Vary memory distribution tests completed..." << std::endl;
 
+        iteration = 1;
+        std::cout << "Vary buffer policy tests started..." << std::endl;
+
+        for (int i = 0; i < 5; i++)
+        {
+            for (auto &buffer_policy_l : buffer_policies)
+            {
+                run_workload("vary buffer policy", iteration, 4000, 1000000, 1000000, "geometric", 0.001, workloads[i][0], workloads[i][1], workloads[i][2], workloads[i][3], workloads[i][4], false, 0, i, true, buffer_policy_l);
+                iteration++;
+            }
+        }
+
+        std::cout << "Vary buffer policy tests completed..." << std::endl;
+
+        iteration = 1;
+        std::cout << "Vary storage mode tests started..." << std::endl;
+
+        for (int i = 0; i < 5; i++)
+        {
+            for (auto &mmap_l : mmaps)
+            {
+                run_workload("vary storage mode", iteration, 4000, 1000000, 1000000, "geometric", 0.001, workloads[i][0], workloads[i][1], workloads[i][2], workloads[i][3], workloads[i][4], false, 0, i, true, "clock", mmap_l);
+                iteration++;
+            }
+        }
+
+        std::cout << "Vary storage mode tests completed..." << std::endl;
+
+        iteration = 1;
+        std::cout << "Vary commit interval tests started..." << std::endl;
+
+        // workload A, half of the operations are updates that are logged
+        for (auto &commit_interval_l : commit_intervals)
+        {
+            run_workload("vary commit interval", iteration, 4000, 1000000, 1000000, "geometric", 0.001, workloads[0][0], workloads[0][1], workloads[0][2], workloads[0][3], workloads[0][4], false, 0, 0, true, "clock", false, commit_interval_l);
+            iteration++;
+        }
+
+        std::cout << "Vary commit interval tests completed..." << std::endl;
+
+        iteration = 1;
+        std::cout << "Vary page size tests started..." << std::endl;
+
+        for (int i = 0; i < 5; i++)
+        {
+            for (int page_size_l : PageSize::supported)
+            {
+                // the buffer gets the same memory for every page size
+                run_workload("vary page size", iteration, 4000 * Configuration::page_size / page_size_l, 1000000, 1000000, "geometric", 0.001, workloads[i][0], workloads[i][1], workloads[i][2], workloads[i][3], workloads[i][4], false, 0, i, true, "clock", false, -1, false, page_size_l);
+                iteration++;
+            }
+        }
+
+        std::cout << "Vary page size tests completed..." << std::endl;
+
         std::cout << "All tests completed!" << std::endl;
     }
 };
\ No newline at end of file
@@ -0,0 +1,52 @@
+/**
+ * @file    page_size.h
+ *
+ * @author  Matteo Wohlrapp
+ * @date    17.10.2026
+ */
+
+#pragma once
+
+#include <type_traits>
+#include <cstdlib>
+#include "spdlog/spdlog.h"
+
+/**
+ * @brief namespace that maps a page size given at runtime to the instantiation of the trees and the data manager for it
+ */
+namespace PageSize
+{
+    /// page sizes the trees and the data manager are instantiated for
+    constexpr int supported[] = {4096, 8192, 16384, 32768, 65536};
+
+    /**
+     * @brief Calls a function with the page size as a compile time constant
+     * @param page_size The page size, must be one of the supported sizes
+     * @param function Generic function that is called with a std::integral_constant holding the page size
+     */
+    template <typename Function>
+    inline void dispatch(int page_size, Function &&function)
+    {
+        switch (page_size)
+        {
+        case 4096:
+            function(std::integral_constant<int, 4096>());
+            break;
+        case 8192:
+            function(std::integral_constant<int, 8192>());
+            break;
+        case 16384:
+            function(std::integral_constant<int, 16384>());
+            break;
+        case 32768:
+            function(std::integral_constant<int, 32768>());
+            break;
+        case 65536:
+            function(std::integral_constant<int, 65536>());
+            break;
+        default:
+            spdlog::get("logger")->error("Page size {} is not supported, use 4096, 8192, 16384, 32768 or 65536", page_size);
+            exit(1);
+        }
+    }
+}
@@ -20,6 +20,19 @@ class RadixTree;
  */
 namespace TreeOperations
 {
+    /**
+     * @brief Hints the buffer manager to read ahead the leaves that follow a leaf in the leaf chain
+     * @param buffer_manager The buffer manager
+     * @param node The current leaf
+     * @param remaining The number of elements the scan needs after the current leaf
+     */
+    template <int PAGE_SIZE>
+    inline void prefetch_leaves(BufferManager *buffer_manager, BOuterNode<PAGE_SIZE> *node, int remaining)
+    {
+        if (remaining > 0 && node->next_lef_id != 0)
+            buffer_manager->prefetch_page(node->next_lef_id, (remaining - 1) / node->max_size);
+    }
+
     /**
      * @brief Start at element key and get range consecutive elements
      * @param buffer_manager The buffer manager
@@ -32,40 +45,62 @@ namespace TreeOperations
     template <int PAGE_SIZE>
     inline int64_t scan(BufferManager *buffer_manager, RadixTree<PAGE_SIZE> *cache, BHeader *header, int64_t key, int range)
     {
+        static_assert(offsetof(BOuterNode<PAGE_SIZE>, next_lef_id) == BufferManager::next_leaf_offset, "Buffer manager can not follow the leaf chain");
         BOuterNode<PAGE_SIZE> *node = (BOuterNode<PAGE_SIZE> *)header;
 
-        int index = node->binary_search(key);
+        // every leaf is read optimistically, if a writer changed it at the same time it is read again from where the scan entered it
+        uint64_t version;
+        int index;
+        int64_t found_key;
+        do
+        {
+            version = buffer_manager->read_version(header);
+            index = node->binary_search(key);
+            found_key = node->get_key(index);
+        } while (!buffer_manager->validate_version(header, version));
         int scanned = 0;
         int64_t sum = 0;
 
-        assert((node->keys[index] == key) && "Scan on key that does not exist.");
-        if (node->keys[index] == key)
+        assert((found_key == key) && "Scan on key that does not exist.");
+        if (found_key == key)
         {
             if (cache)
             {
                 cache->insert(key, header->page_id, header);
             }
-            while (scanned < range)
+            prefetch_leaves<PAGE_SIZE>(buffer_manager, node, range - (node->current_index - index));
+            bool first_leaf = true;
+            int leaf_scanned = 0;
+            int64_t leaf_sum = 0;
+            while (true)
             {
-                if (index == node->current_index)
+                while (scanned < range && index < node->current_index)
+                {
+                    sum ^= node->get_value_at(index);
+                    scanned++;
+                    index++;
+                }
+                uint64_t next_leaf_id = node->next_lef_id;
+                if (!buffer_manager->validate_version(&node->header, version))
                 {
-                    if (node->next_lef_id == 0)
-                    {
-                        buffer_manager->unfix_page(node->header.page_id, false);
-                        if (sum == INT64_MIN)
-                            return INT64_MIN + 1;
-                        else
-                            return sum;
-                    }
-                    BOuterNode<PAGE_SIZE> *temp = node;
-                    node = (BOuterNode<PAGE_SIZE> *)buffer_manager->request_page(node->next_lef_id);
-                    buffer_manager->unfix_page(temp->header.page_id, false);
-                    index = 0;
+                    version = buffer_manager->read_version(&node->header);
+                    index = first_leaf ? node->binary_search(key) : 0;
+                    scanned = leaf_scanned;
+                    sum = leaf_sum;
+                    continue;
                 }
+                if (scanned >= range || next_leaf_id == 0)
+                    break;
 
-                sum ^= node->values[index];
-                scanned++;
-                index++;
+                BOuterNode<PAGE_SIZE> *temp = node;
+                node = (BOuterNode<PAGE_SIZE> *)buffer_manager->request_page(next_leaf_id);
+                buffer_manager->unfix_page(temp->header.page_id, false);
+                version = buffer_manager->read_version(&node->header);
+                index = 0;
+                first_leaf = false;
+                leaf_scanned = scanned;
+                leaf_sum = sum;
+                prefetch_leaves<PAGE_SIZE>(buffer_manager, node, range - scanned - node->current_index);
             }
             buffer_manager->unfix_page(node->header.page_id, false);
 
@@ -74,6 +109,7 @@ namespace TreeOperations
             else
                 return sum;
         }
+        buffer_manager->unfix_page(header->page_id, false);
         return INT64_MIN;
     }
 }
\ No newline at end of file
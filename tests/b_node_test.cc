@@ -235,4 +235,122 @@ TEST_F(BNodeTest, BOuterNodeDelete)
     ASSERT_EQ(node->get_value(1), INT64_MIN);
     ASSERT_EQ(node->get_value(2), INT64_MIN);
     ASSERT_EQ(node->get_value(3), INT64_MIN);
-}
\ No newline at end of file
+}
+TEST_F(BNodeTest, BOuterNodePacked)
+{
+    BOuterNode<PAGE_SIZE> *node = new (header) BOuterNode<PAGE_SIZE>(true);
+
+    ASSERT_TRUE(node->header.packed);
+    // close keys take one byte, so the node holds more than max_size entries
+    node->insert(100, 1);
+    node->insert(120, 2);
+    node->insert(90, 3);
+    node->insert(110, 4);
+    ASSERT_EQ(node->current_index, node->max_size + 1);
+    ASSERT_EQ(node->get_key_width(), 1);
+    ASSERT_TRUE(node->is_full());
+    ASSERT_EQ(node->get_key(0), 90);
+    ASSERT_EQ(node->get_key(3), 120);
+    ASSERT_EQ(node->get_value(90), 3);
+    ASSERT_EQ(node->get_value(110), 4);
+    ASSERT_EQ(node->get_value(105), INT64_MIN);
+
+    node->delete_value(90);
+    node->delete_value(120);
+    ASSERT_EQ(node->current_index, 2);
+    ASSERT_EQ(node->get_value(100), 1);
+    ASSERT_EQ(node->get_value(110), 4);
+
+    // a key far away needs the widest keys
+    ASSERT_FALSE(node->is_full(INT64_MIN + 1));
+    node->insert(INT64_MIN + 1, 5);
+    ASSERT_EQ(node->get_key_width(), 8);
+    ASSERT_TRUE(node->is_full(INT64_MAX));
+    ASSERT_EQ(node->get_value(INT64_MIN + 1), 5);
+    ASSERT_EQ(node->get_value(100), 1);
+    node->update(110, 6);
+    ASSERT_EQ(node->get_value(110), 6);
+    ASSERT_EQ(node->binary_search(INT64_MIN), 0);
+    ASSERT_EQ(node->binary_search(105), 2);
+
+    // truncating repacks the remaining keys with the smallest width
+    node->truncate(1);
+    ASSERT_EQ(node->current_index, 1);
+    ASSERT_EQ(node->get_key_width(), 0);
+    ASSERT_EQ(node->get_value(INT64_MIN + 1), 5);
+    ASSERT_EQ(node->get_value(100), INT64_MIN);
+}
+
+TEST_F(BNodeTest, KeySearchKernels)
+{
+    // every supported kernel finds the same position as std::lower_bound, in windows of every length and across the narrowing
+    std::vector<int64_t> keys;
+    for (int i = 0; i < 100; i++)
+    {
+        keys.push_back(3 * i - 50);
+    }
+    keys.push_back(INT64_MAX);
+    keys.insert(keys.begin(), INT64_MIN);
+
+    for (auto kernel : {KeySearch::Kernel::SCALAR, KeySearch::Kernel::AVX2, KeySearch::Kernel::AVX512})
+    {
+        if (!KeySearch::supports(kernel))
+            continue;
+        for (int count = 0; count <= static_cast<int>(keys.size()); count++)
+        {
+            for (int64_t key : {INT64_MIN, int64_t(-52), int64_t(-50), int64_t(-49), int64_t(0), int64_t(1), int64_t(100), int64_t(247), int64_t(248), INT64_MAX})
+            {
+                int expected = std::lower_bound(keys.begin(), keys.begin() + count, key) - keys.begin();
+                ASSERT_EQ(KeySearch::lower_bound(keys.data(), count, key, kernel), expected);
+            }
+        }
+    }
+}
+
+TEST_F(BNodeTest, BInnerNodeIndexed)
+{
+    // the index only has levels with larger pages
+    constexpr int LARGE_PAGE_SIZE = 4096;
+    BInnerNode<LARGE_PAGE_SIZE> *node = new (malloc(LARGE_PAGE_SIZE)) BInnerNode<LARGE_PAGE_SIZE>(true);
+    auto layout = BInnerNode<LARGE_PAGE_SIZE>::index_layout;
+    ASSERT_EQ(node->max_size, layout.capacity);
+    ASSERT_EQ(layout.levels, 2);
+    ASSERT_LE(layout.capacity + (layout.capacity + 7) / 8 + (layout.capacity + 63) / 64, ((LARGE_PAGE_SIZE - 32) / 2) / 8);
+
+    // the search finds the same position as std::lower_bound while the node fills up and empties again
+    std::vector<int64_t> keys;
+    auto check = [&]()
+    {
+        for (int64_t key = -1; key <= 2 * layout.capacity + 1; key++)
+        {
+            int expected = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+            ASSERT_EQ(node->binary_search(key), expected);
+        }
+    };
+    check();
+    for (int i = 0; i < layout.capacity; i++)
+    {
+        // keys arrive from both ends, so they are inserted at different positions
+        int64_t key = i % 2 == 0 ? 2 * (i / 2) : 2 * layout.capacity - 2 * (i / 2);
+        node->insert(key, i);
+        keys.insert(std::lower_bound(keys.begin(), keys.end(), key), key);
+        if (i % 17 == 0)
+            check();
+    }
+    ASSERT_TRUE(node->is_full());
+    check();
+
+    node->exchange(keys[5], keys[5] + 1);
+    keys[5]++;
+    check();
+    for (int i = 0; i < layout.capacity / 2; i++)
+    {
+        node->delete_value(keys[i]);
+    }
+    keys.erase(keys.begin(), keys.begin() + layout.capacity / 2);
+    check();
+    node->delete_first_pair();
+    keys.erase(keys.begin());
+    check();
+    free(node);
+}
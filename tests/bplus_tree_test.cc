@@ -2,9 +2,12 @@
 #include "../src/bplus_tree/bplus_tree.h"
 #include "../src/data/buffer_manager.h"
 #include "../src/configuration.h"
+#include "../src/utils/page_size.h"
 #include <random>
 #include <queue>
 #include <unordered_set>
+#include <thread>
+#include <atomic>
 
 constexpr int PAGE_SIZE = 96;
 
@@ -32,6 +35,11 @@ protected:
     {
     }
 
+    void use_packed_leaves()
+    {
+        bplus_tree = new BPlusTree<PAGE_SIZE>(buffer_manager, nullptr, true);
+    }
+
     uint64_t get_root_id()
     {
         return bplus_tree->root_id;
@@ -42,12 +50,20 @@ protected:
         bplus_tree->root_id = new_root_id;
     }
 
+    StorageManager *get_storage_manager()
+    {
+        return buffer_manager->storage_manager;
+    }
+
     bool all_pages_unfixed()
     {
-        for (auto &pair : buffer_manager->page_id_map)
+        for (auto &shard : buffer_manager->page_id_map)
         {
-            if (pair.second->fix_count != 0)
-                return false;
+            for (auto &entry : shard->table)
+            {
+                if (entry.frame->fix_count != 0)
+                    return false;
+            }
         }
         return true;
     }
@@ -97,7 +113,7 @@ protected:
                     node << "BOuterNode:  " << outer_node->header.page_id << " {";
                     for (int j = 0; j < outer_node->current_index; j++)
                     {
-                        node << " (Key: " << outer_node->keys[j] << ", Value: " << outer_node->values[j] << ")";
+                        node << " (Key: " << outer_node->get_key(j) << ", Value: " << outer_node->get_value_at(j) << ")";
                     }
                     node << "; Next Leaf: " << outer_node->next_lef_id << " }";
                     logger->debug(node.str());
@@ -1135,4 +1151,386 @@ TEST_F(BPlusTreeTest, ScanWithSeed42)
     ASSERT_TRUE(is_ordered());
     ASSERT_TRUE(is_balanced());
     ASSERT_TRUE(all_pages_unfixed());
-}
\ No newline at end of file
+}
+
+TEST_F(BPlusTreeTest, PersistentReopen)
+{
+    std::filesystem::remove(base_path / data);
+    StorageManager *storage_manager = new StorageManager(base_path, PAGE_SIZE, false, false, false, true);
+    buffer_manager = new BufferManager(storage_manager, buffer_size, PAGE_SIZE);
+    bplus_tree = new BPlusTree<PAGE_SIZE>(buffer_manager);
+    for (int i = 0; i < 500; i++)
+    {
+        bplus_tree->insert(i, i * 2);
+    }
+    storage_manager->set_root_id(bplus_tree->get_root_id());
+    buffer_manager->destroy();
+    storage_manager->destroy();
+    delete buffer_manager;
+    delete storage_manager;
+    delete bplus_tree;
+
+    storage_manager = new StorageManager(base_path, PAGE_SIZE, false, false, false, true);
+    ASSERT_TRUE(storage_manager->is_reopened());
+    buffer_manager = new BufferManager(storage_manager, buffer_size, PAGE_SIZE);
+    bplus_tree = new BPlusTree<PAGE_SIZE>(buffer_manager, nullptr, storage_manager->get_root_id());
+    ASSERT_TRUE(is_balanced());
+    ASSERT_TRUE(is_ordered());
+    ASSERT_TRUE(is_concatenated(500));
+    for (int i = 0; i < 500; i++)
+    {
+        ASSERT_EQ(bplus_tree->get_value(i), i * 2);
+    }
+
+    // new pages do not overwrite the pages of the reopened tree
+    for (int i = 500; i < 600; i++)
+    {
+        bplus_tree->insert(i, i * 2);
+    }
+    ASSERT_TRUE(is_concatenated(600));
+    ASSERT_EQ(bplus_tree->get_value(42), 84);
+    ASSERT_TRUE(all_pages_unfixed());
+
+    buffer_manager->destroy();
+    storage_manager->destroy();
+    std::filesystem::remove(base_path / data);
+}
+
+TEST_F(BPlusTreeTest, CompactionMovesPagesToTheFront)
+{
+    for (int i = 0; i < 1000; i++)
+    {
+        bplus_tree->insert(i, i * 2);
+    }
+    // the merges free pages all over the file
+    for (int i = 0; i < 1000; i++)
+    {
+        if (i % 10 != 0)
+            bplus_tree->delete_value(i);
+    }
+    StorageManager *storage_manager = get_storage_manager();
+    uint64_t page_count = storage_manager->get_page_count();
+    ASSERT_LT(buffer_manager->peek_unused_page_id(), page_count);
+
+    bplus_tree->compact();
+    ASSERT_GT(buffer_manager->truncate(), 0);
+    ASSERT_LT(storage_manager->get_page_count(), page_count);
+    ASSERT_EQ(buffer_manager->peek_unused_page_id(), storage_manager->get_page_count());
+
+    ASSERT_TRUE(is_balanced());
+    ASSERT_TRUE(is_ordered());
+    ASSERT_TRUE(is_concatenated(100));
+    for (int i = 0; i < 1000; i += 10)
+    {
+        ASSERT_EQ(bplus_tree->get_value(i), i * 2);
+    }
+    ASSERT_TRUE(all_pages_unfixed());
+}
+
+TEST_F(BPlusTreeTest, PackedLeavesInsertAndDelete)
+{
+    use_packed_leaves();
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int64_t> dist(-1000, 1000);
+    std::unordered_set<int64_t> unique_values;
+    int64_t values[200];
+
+    for (int i = 0; i < 200; i++)
+    {
+        int64_t value;
+        do
+        {
+            // some keys are far away from the others, so leaves have to repack with wider keys
+            value = i % 17 == 0 ? dist(generator) * 1000000000000LL : dist(generator);
+        } while (unique_values.count(value) > 0);
+
+        unique_values.insert(value);
+        values[i] = value;
+        bplus_tree->insert(value, value * 2);
+    }
+
+    for (int i = 0; i < 200; i++)
+    {
+        ASSERT_EQ(bplus_tree->get_value(values[i]), values[i] * 2);
+    }
+    ASSERT_TRUE(all([](BHeader *header)
+                    { return header->inner || header->packed; }));
+    ASSERT_TRUE(is_concatenated(200));
+    ASSERT_TRUE(is_ordered());
+    ASSERT_TRUE(is_balanced());
+    ASSERT_TRUE(minimum_size());
+
+    std::vector<int64_t> sorted(values, values + 200);
+    std::sort(sorted.begin(), sorted.end());
+    int64_t sum = 0;
+    for (int i = 10; i < 110; i++)
+    {
+        sum ^= sorted[i] * 2;
+    }
+    ASSERT_EQ(bplus_tree->scan(sorted[10], 100), sum);
+
+    for (int i = 0; i < 150; i++)
+    {
+        bplus_tree->delete_value(values[i]);
+        ASSERT_EQ(bplus_tree->get_value(values[i]), INT64_MIN);
+    }
+    for (int i = 150; i < 200; i++)
+    {
+        bplus_tree->update(values[i], values[i]);
+        ASSERT_EQ(bplus_tree->get_value(values[i]), values[i]);
+    }
+    ASSERT_TRUE(is_concatenated(50));
+    ASSERT_TRUE(is_ordered());
+    ASSERT_TRUE(is_balanced());
+    ASSERT_TRUE(minimum_size());
+    ASSERT_TRUE(all_pages_unfixed());
+}
+
+TEST_F(BPlusTreeTest, BulkLoadSorted)
+{
+    // few entries leave the last leaf too empty, it takes entries from the one before it
+    for (int count : {0, 1, 4, 5, 6, 13, 1000})
+    {
+        bplus_tree = new BPlusTree<PAGE_SIZE>(buffer_manager);
+        std::vector<std::pair<int64_t, int64_t>> entries;
+        for (int i = 0; i < count; i++)
+        {
+            entries.emplace_back(i * 3, i);
+        }
+        bplus_tree->bulk_load(entries, 0.75);
+
+        ASSERT_TRUE(is_balanced());
+        ASSERT_TRUE(is_ordered());
+        ASSERT_TRUE(is_concatenated(count));
+        ASSERT_TRUE(minimum_size());
+        for (int i = 0; i < count; i++)
+        {
+            ASSERT_EQ(bplus_tree->get_value(i * 3), i);
+        }
+        ASSERT_TRUE(all_pages_unfixed());
+    }
+
+    // the leaves were created one after the other, so the leaf chain follows the pages of the data file
+    uint64_t leaf_id = find_leftmost();
+    int leaf_count = 0;
+    while (leaf_id != 0)
+    {
+        BOuterNode<PAGE_SIZE> *leaf = (BOuterNode<PAGE_SIZE> *)buffer_manager->request_page(leaf_id);
+        uint64_t next_leaf_id = leaf->next_lef_id;
+        buffer_manager->unfix_page(leaf_id, false);
+        if (leaf_count > 0 && next_leaf_id != 0)
+            ASSERT_EQ(next_leaf_id, leaf_id + 1);
+        leaf_id = next_leaf_id;
+        leaf_count++;
+    }
+    // 3 of 4 entries per leaf
+    ASSERT_EQ(leaf_count, 334);
+
+    // the free space in the nodes takes the inserts
+    for (int i = 0; i < 1000; i++)
+    {
+        bplus_tree->insert(i * 3 + 1, i);
+    }
+    for (int i = 0; i < 1000; i += 2)
+    {
+        bplus_tree->delete_value(i * 3);
+    }
+    ASSERT_TRUE(is_balanced());
+    ASSERT_TRUE(is_ordered());
+    ASSERT_TRUE(is_concatenated(1500));
+    ASSERT_TRUE(minimum_size());
+    for (int i = 0; i < 1000; i++)
+    {
+        ASSERT_EQ(bplus_tree->get_value(i * 3), i % 2 == 0 ? INT64_MIN : i);
+        ASSERT_EQ(bplus_tree->get_value(i * 3 + 1), i);
+    }
+    ASSERT_TRUE(all_pages_unfixed());
+}
+
+TEST_F(BPlusTreeTest, BulkLoadUnsortedPackedLeaves)
+{
+    use_packed_leaves();
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int64_t> dist(-1000000, 1000000);
+    std::unordered_set<int64_t> unique_values;
+    std::vector<std::pair<int64_t, int64_t>> entries;
+    while (entries.size() < 2000)
+    {
+        // some keys are far away from the others, so leaves need wider keys
+        int64_t value = entries.size() % 31 == 0 ? dist(generator) * 1000000000LL : dist(generator);
+        if (unique_values.insert(value).second)
+            entries.emplace_back(value, value * 2);
+    }
+
+    // an odd number of chunks leaves one without a partner in the merge rounds
+    bplus_tree->bulk_load_unsorted(entries, 5, 1);
+    ASSERT_TRUE(std::is_sorted(entries.begin(), entries.end()));
+
+    ASSERT_TRUE(all([](BHeader *header)
+                    { return header->inner || header->packed; }));
+    ASSERT_TRUE(is_balanced());
+    ASSERT_TRUE(is_ordered());
+    ASSERT_TRUE(is_concatenated(2000));
+    ASSERT_TRUE(minimum_size());
+    for (const auto &[key, value] : entries)
+    {
+        ASSERT_EQ(bplus_tree->get_value(key), value);
+    }
+
+    // full nodes are split by the next insert
+    for (int64_t key = 2000000; key < 2000100; key++)
+    {
+        bplus_tree->insert(key, key);
+    }
+    ASSERT_TRUE(is_balanced());
+    ASSERT_TRUE(is_ordered());
+    ASSERT_TRUE(is_concatenated(2100));
+    ASSERT_TRUE(all_pages_unfixed());
+}
+
+TEST_F(BPlusTreeTest, ConcurrentOperations)
+{
+    // every thread fixes up to two pages, a larger buffer keeps them from waiting for frames
+    buffer_manager = new BufferManager(new StorageManager(base_path / "concurrent", PAGE_SIZE), 200, PAGE_SIZE);
+    bplus_tree = new BPlusTree<PAGE_SIZE>(buffer_manager);
+    const int thread_count = 4;
+    const int keys_per_thread = 1000;
+    std::atomic<int> errors{0};
+
+    // the keys of the threads alternate, so they insert into the same leaves and split them
+    auto insert_and_read = [&](int t)
+    {
+        std::mt19937 generator(t);
+        std::vector<int64_t> keys;
+        for (int i = 0; i < keys_per_thread; i++)
+        {
+            keys.push_back(i * thread_count + t);
+        }
+        std::shuffle(keys.begin(), keys.end(), generator);
+        for (int i = 0; i < keys_per_thread; i++)
+        {
+            bplus_tree->insert(keys[i], keys[i]);
+            int64_t key = keys[std::uniform_int_distribution<int>(0, i)(generator)];
+            if (bplus_tree->get_value(key) != key)
+                errors++;
+        }
+    };
+    auto update_delete_and_scan = [&](int t)
+    {
+        for (int i = 0; i < keys_per_thread; i++)
+        {
+            int64_t key = i * thread_count + t;
+            if (i % 2 == 0)
+            {
+                bplus_tree->update(key, key * 2);
+                bplus_tree->scan(key, 10);
+            }
+            else
+            {
+                bplus_tree->delete_value(key);
+            }
+        }
+    };
+    for (auto phase : {std::function<void(int)>(insert_and_read), std::function<void(int)>(update_delete_and_scan)})
+    {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < thread_count; t++)
+        {
+            threads.emplace_back(phase, t);
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+    }
+    ASSERT_EQ(errors, 0);
+
+    ASSERT_TRUE(is_balanced());
+    ASSERT_TRUE(is_ordered());
+    ASSERT_TRUE(is_concatenated(thread_count * keys_per_thread / 2));
+    ASSERT_TRUE(minimum_size());
+    for (int64_t key = 0; key < thread_count * keys_per_thread; key++)
+    {
+        ASSERT_EQ(bplus_tree->get_value(key), (key / thread_count) % 2 == 0 ? key * 2 : INT64_MIN);
+    }
+    ASSERT_TRUE(all_pages_unfixed());
+    buffer_manager->destroy();
+    get_storage_manager()->destroy();
+    std::filesystem::remove_all(base_path / "concurrent");
+}
+
+TEST_F(BPlusTreeTest, IndexedInnerNodes)
+{
+    // inner nodes only get an index above their keys with larger pages
+    constexpr int LARGE_PAGE_SIZE = 4096;
+    StorageManager storage_manager(base_path / "indexed", LARGE_PAGE_SIZE);
+    BufferManager large_buffer_manager(&storage_manager, 20, LARGE_PAGE_SIZE);
+    BPlusTree<LARGE_PAGE_SIZE> tree(&large_buffer_manager, nullptr, false, true);
+
+    // enough keys for inner nodes to split and merge
+    std::vector<int64_t> keys(60000);
+    for (int i = 0; i < 60000; i++)
+    {
+        keys[i] = i * 3;
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937(7));
+    for (int64_t key : keys)
+    {
+        tree.insert(key, key + 1);
+    }
+    for (int i = 0; i < 60000; i++)
+    {
+        if (i % 4 != 0)
+            tree.delete_value(keys[i]);
+    }
+    for (int i = 0; i < 60000; i++)
+    {
+        ASSERT_EQ(tree.get_value(keys[i]), i % 4 == 0 ? keys[i] + 1 : INT64_MIN);
+        ASSERT_EQ(tree.get_value(keys[i] + 1), INT64_MIN);
+    }
+
+    // bulk loaded inner nodes are indexed as well
+    BPlusTree<LARGE_PAGE_SIZE> loaded(&large_buffer_manager, nullptr, false, true);
+    std::vector<std::pair<int64_t, int64_t>> entries;
+    for (int64_t i = 0; i < 100000; i++)
+    {
+        entries.emplace_back(i * 2, i);
+    }
+    loaded.bulk_load(entries, 1);
+    for (int64_t i = 0; i < 100000; i++)
+    {
+        ASSERT_EQ(loaded.get_value(i * 2), i);
+        ASSERT_EQ(loaded.get_value(i * 2 + 1), INT64_MIN);
+    }
+    large_buffer_manager.destroy();
+    storage_manager.destroy();
+    std::filesystem::remove_all(base_path / "indexed");
+}
+
+TEST_F(BPlusTreeTest, SupportedPageSizes)
+{
+    for (int page_size : PageSize::supported)
+    {
+        PageSize::dispatch(page_size, [this](auto page_size_constant)
+                           {
+            constexpr int LARGE_PAGE_SIZE = decltype(page_size_constant)::value;
+            StorageManager storage_manager(base_path / "page_size", LARGE_PAGE_SIZE);
+            BufferManager large_buffer_manager(&storage_manager, 4, LARGE_PAGE_SIZE);
+            BPlusTree<LARGE_PAGE_SIZE> tree(&large_buffer_manager);
+            for (int i = 0; i < 10000; i++)
+            {
+                tree.insert(i * 7, i);
+            }
+            for (int i = 0; i < 10000; i += 3)
+            {
+                tree.delete_value(i * 7);
+            }
+            for (int i = 0; i < 10000; i++)
+            {
+                ASSERT_EQ(tree.get_value(i * 7), i % 3 == 0 ? INT64_MIN : i);
+            }
+            large_buffer_manager.destroy();
+            storage_manager.destroy(); });
+    }
+    std::filesystem::remove_all(base_path / "page_size");
+}
@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 #include "../src/data/buffer_manager.h"
 #include "../src/configuration.h"
+#include <unistd.h>
+#include <thread>
 
 int page_size = 32;
 
@@ -26,9 +28,24 @@ protected:
         return buffer_manager->current_buffer_size;
     }
 
-    std::map<uint64_t, BFrame *> get_page_id_map()
+    BFrame *get_frame(uint64_t page_id)
     {
-        return buffer_manager->page_id_map;
+        return buffer_manager->find_frame(page_id);
+    }
+
+    char *get_arena()
+    {
+        return buffer_manager->arena;
+    }
+
+    size_t get_frame_stride()
+    {
+        return buffer_manager->frame_stride;
+    }
+
+    uint64_t get_free_frame_count()
+    {
+        return buffer_manager->free_frames.size();
     }
 };
 
@@ -37,10 +54,9 @@ TEST_F(BufferManagerTest, PageCreation)
     BHeader *header = buffer_manager->create_new_page();
     ASSERT_EQ(header->page_id, 1);
     ASSERT_EQ(get_current_buffer_size(), 1);
-    auto page_id_map = get_page_id_map();
-    std::map<uint64_t, BFrame *>::iterator it = page_id_map.find(header->page_id);
-    ASSERT_EQ(it->second->dirty, true);
-    ASSERT_EQ(it->second->marked, true);
+    BFrame *frame = get_frame(header->page_id);
+    ASSERT_EQ(frame->dirty, true);
+    ASSERT_EQ(frame->marked, true);
 
     header = buffer_manager->create_new_page();
     ASSERT_EQ(get_current_buffer_size(), 2);
@@ -59,11 +75,10 @@ TEST_F(BufferManagerTest, PageRequest)
 TEST_F(BufferManagerTest, FixAndUnfixPage)
 {
     BHeader *header = buffer_manager->create_new_page();
-    auto page_id_map = get_page_id_map();
-    std::map<uint64_t, BFrame *>::iterator it = page_id_map.find(header->page_id);
-    ASSERT_EQ(it->second->fix_count, 1);
+    BFrame *frame = get_frame(header->page_id);
+    ASSERT_EQ(frame->fix_count, 1);
     buffer_manager->unfix_page(1, true);
-    ASSERT_EQ(it->second->fix_count, 0);
+    ASSERT_EQ(frame->fix_count, 0);
 }
 
 TEST_F(BufferManagerTest, BufferFullWhenCreatingPage)
@@ -75,8 +90,7 @@ TEST_F(BufferManagerTest, BufferFullWhenCreatingPage)
     header = buffer_manager->create_new_page();
     ASSERT_EQ(get_current_buffer_size(), 2);
     ASSERT_EQ(header->page_id, 3);
-    auto page_id_map = get_page_id_map();
-    ASSERT_TRUE((page_id_map.find(1) != page_id_map.end() && page_id_map.find(2) == page_id_map.end()) || (page_id_map.find(1) == page_id_map.end() && page_id_map.find(2) != page_id_map.end()));
+    ASSERT_TRUE((get_frame(1) && !get_frame(2)) || (!get_frame(1) && get_frame(2)));
 }
 
 TEST_F(BufferManagerTest, BufferFullWhenRequestingPage)
@@ -86,17 +100,15 @@ TEST_F(BufferManagerTest, BufferFullWhenRequestingPage)
     header = buffer_manager->create_new_page();
     buffer_manager->unfix_page(header->page_id, false);
     header = buffer_manager->create_new_page();
-    auto page_id_map = get_page_id_map();
     int page_id = 1;
-    if (page_id_map.find(1) != page_id_map.end())
+    if (get_frame(1))
     {
         page_id = 2;
     }
     header = buffer_manager->request_page(page_id);
     ASSERT_EQ(get_current_buffer_size(), 2);
     ASSERT_EQ(header->page_id, page_id);
-    page_id_map = get_page_id_map();
-    ASSERT_TRUE((page_id_map.find(3) != page_id_map.end()) && (page_id_map.find(page_id) != page_id_map.end()));
+    ASSERT_TRUE(get_frame(3) && get_frame(page_id));
 }
 
 TEST_F(BufferManagerTest, DeletingPage)
@@ -104,8 +116,187 @@ TEST_F(BufferManagerTest, DeletingPage)
     BHeader *header = buffer_manager->create_new_page();
     buffer_manager->unfix_page(1, false);
 
-    auto page_id_map = get_page_id_map();
-    ASSERT_FALSE(page_id_map.find(1) == page_id_map.end());
+    ASSERT_FALSE(get_frame(1) == nullptr);
     buffer_manager->delete_page(1);
-    ASSERT_EQ(buffer_manager->request_page(1)->page_id, 0);
-}
\ No newline at end of file
+    ASSERT_EQ(header->page_id, 0);
+    ASSERT_TRUE(get_frame(1) == nullptr);
+    ASSERT_EQ(get_current_buffer_size(), 0);
+
+    // the page id and the frame are handed out again
+    BHeader *new_header = buffer_manager->create_new_page();
+    ASSERT_EQ(new_header->page_id, 1);
+    ASSERT_EQ(new_header, header);
+    ASSERT_EQ(buffer_manager->get_eviction_count(), 0);
+}
+
+TEST_F(BufferManagerTest, EvictionSkipsFixedPages)
+{
+    // page 1 stays fixed, so the clock has to pass it and evict page 2
+    buffer_manager->create_new_page();
+    BHeader *header = buffer_manager->create_new_page();
+    buffer_manager->unfix_page(header->page_id, false);
+    header = buffer_manager->create_new_page();
+
+    ASSERT_EQ(header->page_id, 3);
+    ASSERT_TRUE(get_frame(1) && !get_frame(2) && get_frame(3));
+    ASSERT_EQ(buffer_manager->get_eviction_count(), 1);
+}
+
+TEST_F(BufferManagerTest, EvictionGivesSecondChance)
+{
+    BHeader *header = buffer_manager->create_new_page();
+    buffer_manager->unfix_page(header->page_id, false);
+    header = buffer_manager->create_new_page();
+    buffer_manager->unfix_page(header->page_id, false);
+
+    // both pages are marked, the first sweep unmarks them and the hand returns to page 1
+    header = buffer_manager->create_new_page();
+    buffer_manager->unfix_page(header->page_id, false);
+    ASSERT_TRUE(!get_frame(1) && get_frame(2) && get_frame(3));
+
+    // page 2 was unmarked in the previous sweep and is evicted without another rotation
+    header = buffer_manager->create_new_page();
+    ASSERT_TRUE(!get_frame(2) && get_frame(3) && get_frame(4));
+    ASSERT_EQ(buffer_manager->get_eviction_count(), 2);
+}
+
+TEST_F(BufferManagerTest, FramesComeFromArena)
+{
+    BHeader *first = buffer_manager->create_new_page();
+    BHeader *second = buffer_manager->create_new_page();
+
+    // the arena is page aligned and the frames are handed out from its front
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(get_arena()) % sysconf(_SC_PAGESIZE), 0);
+    ASSERT_EQ(reinterpret_cast<char *>(get_frame(first->page_id)), get_arena());
+    ASSERT_EQ(reinterpret_cast<char *>(second) - reinterpret_cast<char *>(first), get_frame_stride());
+    ASSERT_EQ(get_free_frame_count(), 0);
+}
+
+TEST_F(BufferManagerTest, SharedFixes)
+{
+    BHeader *header = buffer_manager->create_new_page();
+    buffer_manager->fix_page(header->page_id);
+    ASSERT_EQ(get_frame(header->page_id)->fix_count, 2);
+
+    buffer_manager->unfix_page(header->page_id, false);
+    buffer_manager->unfix_page(header->page_id, true);
+    ASSERT_EQ(get_frame(header->page_id)->fix_count, 0);
+    ASSERT_EQ(get_frame(header->page_id)->dirty, true);
+}
+
+TEST_F(BufferManagerTest, ConcurrentRequests)
+{
+    std::filesystem::remove(base_path / data);
+    StorageManager *storage_manager = new StorageManager(base_path, page_size);
+    BufferManager concurrent_buffer_manager(storage_manager, 8, page_size);
+    uint64_t page_count = 32;
+    for (uint64_t i = 1; i <= page_count; i++)
+    {
+        BHeader *header = concurrent_buffer_manager.create_new_page();
+        reinterpret_cast<uint64_t *>(header + 1)[0] = i;
+        concurrent_buffer_manager.unfix_page(header->page_id, true);
+    }
+
+    // every thread hits page 1 constantly and misses on the other pages, the content is checked under the shared latch
+    std::atomic<bool> faulty = false;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&, t]()
+                             {
+                                 for (uint64_t i = 0; i < 2000; i++)
+                                 {
+                                     uint64_t page_id = i % 2 == 0 ? 1 : (i * 7 + t) % page_count + 1;
+                                     BHeader *header = concurrent_buffer_manager.request_page(page_id);
+                                     concurrent_buffer_manager.latch_page(header, false);
+                                     if (header->page_id != page_id || reinterpret_cast<uint64_t *>(header + 1)[0] != page_id)
+                                         faulty = true;
+                                     concurrent_buffer_manager.unlatch_page(header, false);
+                                     concurrent_buffer_manager.unfix_page(page_id, false);
+                                 }
+                             });
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+
+    ASSERT_FALSE(faulty);
+    ASSERT_EQ(concurrent_buffer_manager.get_current_buffer_size(), 8);
+    concurrent_buffer_manager.destroy();
+    storage_manager->destroy();
+    delete storage_manager;
+}
+
+TEST_F(BufferManagerTest, BackgroundFlusherCleansPages)
+{
+    std::filesystem::remove(base_path / data);
+    StorageManager *storage_manager = new StorageManager(base_path, page_size);
+    // the flusher keeps every frame clean, so evictions never have to write
+    BufferManager flushed_buffer_manager(storage_manager, 4, page_size, "clock", false, 1);
+    for (uint64_t i = 1; i <= 4; i++)
+    {
+        BHeader *header = flushed_buffer_manager.create_new_page();
+        reinterpret_cast<uint64_t *>(header + 1)[0] = i;
+        flushed_buffer_manager.unfix_page(header->page_id, true);
+    }
+    for (int i = 0; i < 1000 && flushed_buffer_manager.get_flush_count() < 4; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(flushed_buffer_manager.get_flush_count(), 4);
+
+    for (uint64_t i = 5; i <= 8; i++)
+    {
+        BHeader *header = flushed_buffer_manager.create_new_page();
+        flushed_buffer_manager.unfix_page(header->page_id, false);
+    }
+    ASSERT_EQ(flushed_buffer_manager.get_eviction_count(), 4);
+
+    // the flushed pages are read back from disc
+    for (uint64_t i = 1; i <= 4; i++)
+    {
+        BHeader *header = flushed_buffer_manager.request_page(i);
+        ASSERT_EQ(reinterpret_cast<uint64_t *>(header + 1)[0], i);
+        flushed_buffer_manager.unfix_page(i, false);
+    }
+    flushed_buffer_manager.destroy();
+    storage_manager->destroy();
+    delete storage_manager;
+}
+
+TEST_F(BufferManagerTest, PrefetchFollowsLeafChain)
+{
+    std::filesystem::remove(base_path / data);
+    StorageManager *storage_manager = new StorageManager(base_path, page_size);
+    BufferManager prefetching_buffer_manager(storage_manager, 2, page_size, "clock", false, 0, 8);
+    // leaves 1 to 6 are chained, the buffer only holds the last two
+    for (uint64_t i = 1; i <= 6; i++)
+    {
+        BHeader *header = prefetching_buffer_manager.create_new_page();
+        *reinterpret_cast<uint64_t *>(reinterpret_cast<char *>(header) + BufferManager::next_leaf_offset) = i < 6 ? i + 1 : 0;
+        prefetching_buffer_manager.unfix_page(header->page_id, true);
+    }
+
+    prefetching_buffer_manager.prefetch_page(1, 2);
+    for (int i = 0; i < 1000 && prefetching_buffer_manager.get_prefetch_count() < 3; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(prefetching_buffer_manager.get_prefetch_count(), 3);
+
+    for (uint64_t i = 1; i <= 4; i++)
+    {
+        BHeader *header = prefetching_buffer_manager.request_page(i);
+        ASSERT_EQ(header->page_id, i);
+        ASSERT_EQ(*reinterpret_cast<uint64_t *>(reinterpret_cast<char *>(header) + BufferManager::next_leaf_offset), i + 1);
+        prefetching_buffer_manager.unfix_page(i, false);
+    }
+    // page 4 was not part of the read ahead
+    ASSERT_EQ(prefetching_buffer_manager.get_prefetch_hit_count(), 3);
+    ASSERT_EQ(prefetching_buffer_manager.get_prefetch_miss_count(), 0);
+
+    prefetching_buffer_manager.destroy();
+    storage_manager->destroy();
+    delete storage_manager;
+}
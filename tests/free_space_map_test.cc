@@ -0,0 +1,109 @@
+#include "gtest/gtest.h"
+#include "../src/data/free_space_map.h"
+#include <random>
+#include <set>
+
+class FreeSpaceMapTest : public ::testing::Test
+{
+protected:
+    FreeSpaceMap free_space_map;
+};
+
+TEST_F(FreeSpaceMapTest, FindFirst)
+{
+    ASSERT_EQ(free_space_map.find_first(), 0);
+    free_space_map.set_used(0);
+    free_space_map.set_used(1);
+    ASSERT_EQ(free_space_map.find_first(), 2);
+
+    // pages behind the bitmap are free
+    ASSERT_TRUE(free_space_map.is_free(5000));
+    free_space_map.set_used(2);
+    ASSERT_EQ(free_space_map.find_first(), 3);
+    ASSERT_GE(free_space_map.get_size(), 3);
+}
+
+TEST_F(FreeSpaceMapTest, FindAcrossLevels)
+{
+    // enough pages for three levels
+    uint64_t page_count = 64 * 64 * 3;
+    free_space_map.resize(page_count);
+    for (uint64_t i = 0; i < page_count; i++)
+    {
+        free_space_map.set_used(i);
+    }
+    ASSERT_EQ(free_space_map.find_first(), page_count);
+
+    free_space_map.set_free(page_count - 10);
+    free_space_map.set_free(70);
+    ASSERT_EQ(free_space_map.find_first(), 70);
+    ASSERT_EQ(free_space_map.find_next(71), page_count - 10);
+    free_space_map.set_used(70);
+    ASSERT_EQ(free_space_map.find_first(), page_count - 10);
+}
+
+TEST_F(FreeSpaceMapTest, FindExtent)
+{
+    free_space_map.resize(200);
+    for (uint64_t i = 0; i < 200; i++)
+    {
+        free_space_map.set_used(i);
+    }
+    free_space_map.set_free(10);
+    for (uint64_t i = 60; i < 140; i++)
+    {
+        free_space_map.set_free(i);
+    }
+
+    ASSERT_EQ(free_space_map.find_extent(1), 10);
+    ASSERT_EQ(free_space_map.find_extent(2), 60);
+    // a run that spans several words
+    ASSERT_EQ(free_space_map.find_extent(80), 60);
+    // a run that does not fit into the bitmap starts behind it
+    ASSERT_EQ(free_space_map.find_extent(81), 200);
+}
+
+TEST_F(FreeSpaceMapTest, AssignWords)
+{
+    free_space_map.resize(130);
+    free_space_map.set_used(0);
+    free_space_map.set_used(129);
+    std::vector<uint64_t> words = free_space_map.get_words();
+
+    FreeSpaceMap copy;
+    copy.assign(words.data(), free_space_map.get_size());
+    ASSERT_EQ(copy.get_size(), 130);
+    ASSERT_FALSE(copy[0]);
+    ASSERT_TRUE(copy[1]);
+    ASSERT_FALSE(copy[129]);
+    ASSERT_EQ(copy.find_first(), 1);
+}
+
+TEST_F(FreeSpaceMapTest, RandomChurn)
+{
+    // the summary has to agree with a plain set of used pages after many changes
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<uint64_t> page_distribution(0, 20000);
+    std::set<uint64_t> used;
+    for (int i = 0; i < 50000; i++)
+    {
+        uint64_t page_id = page_distribution(generator);
+        if (used.count(page_id))
+        {
+            free_space_map.set_free(page_id);
+            used.erase(page_id);
+        }
+        else
+        {
+            free_space_map.set_used(page_id);
+            used.insert(page_id);
+        }
+        if (i % 1000 == 0)
+        {
+            uint64_t expected = 0;
+            while (used.count(expected))
+                expected++;
+            ASSERT_EQ(free_space_map.find_first(), expected);
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+#include "../src/data/page_codec.h"
+#include <random>
+#include <vector>
+
+class PageCodecTest : public ::testing::Test
+{
+protected:
+    std::vector<char> round_trip(const std::vector<char> &page, uint64_t &compressed_size)
+    {
+        std::vector<char> compressed(PageCodec::max_compressed_size(page.size()));
+        compressed_size = PageCodec::compress(page.data(), page.size(), compressed.data());
+        std::vector<char> decompressed(page.size());
+        PageCodec::decompress(compressed.data(), decompressed.data(), page.size());
+        return decompressed;
+    }
+};
+
+TEST_F(PageCodecTest, SortedKeysShrink)
+{
+    std::vector<char> page(4096, 0);
+    uint64_t *words = reinterpret_cast<uint64_t *>(page.data());
+    for (uint64_t i = 0; i < 256; i++)
+    {
+        words[i] = 1000000 + i * 7;
+    }
+    uint64_t compressed_size;
+    ASSERT_EQ(round_trip(page, compressed_size), page);
+    // most differences between the keys need 4 bits instead of 64 and every block of the empty half one byte
+    ASSERT_LT(compressed_size, 300);
+
+    std::vector<char> empty_page(4096, 0);
+    ASSERT_EQ(round_trip(empty_page, compressed_size), empty_page);
+    ASSERT_EQ(compressed_size, 4096 / 8 / 16);
+}
+
+TEST_F(PageCodecTest, RandomWordsAndOddSizes)
+{
+    std::mt19937_64 random(7);
+    for (uint64_t page_size : {32, 100, 4096})
+    {
+        std::vector<char> page(page_size);
+        for (char &byte : page)
+        {
+            byte = static_cast<char>(random());
+        }
+        uint64_t compressed_size;
+        ASSERT_EQ(round_trip(page, compressed_size), page);
+        ASSERT_LE(compressed_size, PageCodec::max_compressed_size(page_size));
+    }
+
+    // differences that need all 64 bits
+    std::vector<char> page(256, 0);
+    uint64_t *words = reinterpret_cast<uint64_t *>(page.data());
+    for (uint64_t i = 0; i < 32; i++)
+    {
+        words[i] = i % 2 == 0 ? 0 : UINT64_MAX / 2 + 1;
+    }
+    uint64_t compressed_size;
+    ASSERT_EQ(round_trip(page, compressed_size), page);
+}
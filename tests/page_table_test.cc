@@ -0,0 +1,110 @@
+#include "gtest/gtest.h"
+#include "../src/data/page_table.h"
+#include <random>
+#include <unordered_map>
+
+class PageTableTest : public ::testing::Test
+{
+protected:
+    PageTable *page_table;
+    std::vector<BFrame> frames;
+
+    void SetUp() override
+    {
+        page_table = new PageTable(8);
+        frames = std::vector<BFrame>(1000);
+    }
+
+    void TearDown() override
+    {
+        delete page_table;
+    }
+};
+
+TEST_F(PageTableTest, InsertAndFind)
+{
+    page_table->insert(1, &frames[1]);
+    page_table->insert(2, &frames[2]);
+
+    ASSERT_EQ(page_table->find(1), &frames[1]);
+    ASSERT_EQ(page_table->find(2), &frames[2]);
+    ASSERT_EQ(page_table->find(3), nullptr);
+    ASSERT_EQ(page_table->size(), 2);
+}
+
+TEST_F(PageTableTest, Erase)
+{
+    page_table->insert(1, &frames[1]);
+    page_table->insert(2, &frames[2]);
+
+    ASSERT_TRUE(page_table->erase(1));
+    ASSERT_FALSE(page_table->erase(1));
+    ASSERT_EQ(page_table->find(1), nullptr);
+    ASSERT_EQ(page_table->find(2), &frames[2]);
+    ASSERT_EQ(page_table->size(), 1);
+}
+
+TEST_F(PageTableTest, GrowBeyondExpectedEntries)
+{
+    for (uint64_t i = 1; i < frames.size(); i++)
+    {
+        page_table->insert(i, &frames[i]);
+    }
+
+    ASSERT_EQ(page_table->size(), frames.size() - 1);
+    for (uint64_t i = 1; i < frames.size(); i++)
+    {
+        ASSERT_EQ(page_table->find(i), &frames[i]);
+    }
+}
+
+TEST_F(PageTableTest, Iterate)
+{
+    for (uint64_t i = 1; i <= 10; i++)
+    {
+        page_table->insert(i, &frames[i]);
+    }
+    page_table->erase(5);
+
+    uint64_t count = 0;
+    for (auto &entry : *page_table)
+    {
+        ASSERT_NE(entry.page_id, 5);
+        ASSERT_EQ(entry.frame, &frames[entry.page_id]);
+        count++;
+    }
+    ASSERT_EQ(count, 9);
+}
+
+// backward shift deletion must keep every remaining entry reachable from its home slot
+TEST_F(PageTableTest, RandomInsertAndErase)
+{
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<uint64_t> dist(1, 500);
+    std::unordered_map<uint64_t, BFrame *> reference;
+
+    for (int i = 0; i < 20000; i++)
+    {
+        uint64_t page_id = dist(generator);
+        if (reference.count(page_id))
+        {
+            ASSERT_TRUE(page_table->erase(page_id));
+            reference.erase(page_id);
+        }
+        else
+        {
+            page_table->insert(page_id, &frames[page_id]);
+            reference.emplace(page_id, &frames[page_id]);
+        }
+
+        if (i % 100 == 0)
+        {
+            for (uint64_t j = 1; j <= 500; j++)
+            {
+                BFrame *expected = reference.count(j) ? reference[j] : nullptr;
+                ASSERT_EQ(page_table->find(j), expected);
+            }
+        }
+    }
+    ASSERT_EQ(page_table->size(), reference.size());
+}
@@ -6,6 +6,7 @@
 #include "../src/data/storage_manager.h"
 #include "../src/bplus_tree/bplus_tree.h"
 #include <unordered_set>
+#include <random>
 
 constexpr int PAGE_SIZE = 96;
 
@@ -0,0 +1,174 @@
+#include "gtest/gtest.h"
+#include "../src/data/replacement_policy.h"
+#include "../src/data/buffer_manager.h"
+
+class ReplacementPolicyTest : public ::testing::Test
+{
+protected:
+    uint64_t capacity = 4;
+    std::vector<BFrame> frame_storage;
+    std::vector<BFrame *> frames;
+
+    void SetUp() override
+    {
+        frame_storage = std::vector<BFrame>(capacity);
+        for (uint64_t i = 0; i < capacity; i++)
+        {
+            frame_storage[i].index = i;
+            frames.push_back(&frame_storage[i]);
+        }
+    }
+
+    // places the page into the frame the same way the buffer manager does
+    void insert(ReplacementPolicy &policy, uint64_t frame_index, uint64_t page_id)
+    {
+        frames[frame_index]->page_id = page_id;
+        policy.on_insert(frame_index, page_id);
+    }
+};
+
+TEST_F(ReplacementPolicyTest, FrameList)
+{
+    FrameList list(capacity);
+    list.push_front(0);
+    list.push_front(1);
+    list.push_front(2);
+    ASSERT_EQ(list.size(), 3);
+    ASSERT_EQ(list.back(), 0);
+
+    list.remove(0);
+    ASSERT_FALSE(list.contains(0));
+    ASSERT_EQ(list.back(), 1);
+    ASSERT_EQ(list.previous(1), 2);
+    ASSERT_EQ(list.previous(2), FrameList::none);
+}
+
+TEST_F(ReplacementPolicyTest, UnknownPolicy)
+{
+    ASSERT_EQ(create_replacement_policy("fifo", frames, capacity), nullptr);
+}
+
+TEST_F(ReplacementPolicyTest, AllPoliciesSkipFixedFrames)
+{
+    for (std::string name : {"clock", "lru-k", "2q", "arc"})
+    {
+        std::unique_ptr<ReplacementPolicy> policy = create_replacement_policy(name, frames, capacity);
+        for (uint64_t i = 0; i < capacity; i++)
+        {
+            insert(*policy, i, i + 1);
+            frames[i]->fix_count = i == 2 ? 0 : 1;
+        }
+        ASSERT_EQ(policy->choose_victim(capacity + 1), 2) << name;
+
+        insert(*policy, 2, capacity + 1);
+        frames[2]->fix_count = 1;
+        ASSERT_EQ(policy->choose_victim(capacity + 2), ReplacementPolicy::no_victim) << name;
+
+        for (BFrame *frame : frames)
+            frame->fix_count = 0;
+    }
+}
+
+TEST_F(ReplacementPolicyTest, RemovedFramesAreNoVictims)
+{
+    // the clock needs no test, it only sweeps once the buffer manager has no free frame left
+    for (std::string name : {"lru-k", "2q", "arc"})
+    {
+        std::unique_ptr<ReplacementPolicy> policy = create_replacement_policy(name, frames, capacity);
+        for (uint64_t i = 0; i < capacity; i++)
+        {
+            insert(*policy, i, i + 1);
+        }
+        for (uint64_t i = 0; i < capacity - 1; i++)
+        {
+            policy->on_remove(i);
+        }
+        ASSERT_EQ(policy->choose_victim(capacity + 1), capacity - 1) << name;
+        ASSERT_EQ(policy->choose_victim(capacity + 2), ReplacementPolicy::no_victim) << name;
+    }
+}
+
+TEST_F(ReplacementPolicyTest, LRUKPrefersPagesWithOneAccess)
+{
+    LRUKPolicy policy(frames, capacity);
+    for (uint64_t i = 0; i < capacity; i++)
+    {
+        insert(policy, i, i + 1);
+    }
+    // frame 0 is the oldest, but the only one with two accesses
+    policy.on_access(0);
+    ASSERT_EQ(policy.choose_victim(5), 1);
+
+    // the history of page 2 is retained, so it is not the next victim after it comes back and is accessed
+    insert(policy, 1, 2);
+    ASSERT_EQ(policy.choose_victim(6), 2);
+}
+
+TEST_F(ReplacementPolicyTest, TwoQPromotesPagesFromGhostList)
+{
+    TwoQPolicy policy(frames, capacity);
+    for (uint64_t i = 0; i < capacity; i++)
+    {
+        insert(policy, i, i + 1);
+    }
+    // a1_in is larger than its target size, the oldest page is evicted and remembered in a1_out
+    ASSERT_EQ(policy.choose_victim(5), 0);
+
+    // page 1 comes back and goes into a_m, so the next victims are taken from a1_in
+    insert(policy, 0, 1);
+    ASSERT_EQ(policy.choose_victim(6), 1);
+    insert(policy, 1, 6);
+    ASSERT_EQ(policy.choose_victim(7), 2);
+}
+
+TEST_F(ReplacementPolicyTest, ARCAdaptsToGhostHits)
+{
+    capacity = 2;
+    ARCPolicy policy(frames, capacity);
+    insert(policy, 0, 1);
+    insert(policy, 1, 2);
+    policy.on_access(0);
+
+    // page 1 is in t2, page 2 in t1 and t1 is above its target size 0
+    ASSERT_EQ(policy.choose_victim(3), 1);
+    insert(policy, 1, 3);
+
+    // page 2 is a ghost hit in b1, t1 grows to 1 and the victim is taken from t2
+    ASSERT_EQ(policy.choose_victim(2), 0);
+    insert(policy, 0, 2);
+
+    // page 2 is now in t2 and t1 is not above its target size anymore, so the victim is taken from t2 again
+    ASSERT_EQ(policy.choose_victim(4), 0);
+}
+
+TEST_F(ReplacementPolicyTest, BufferManagerWithAllPolicies)
+{
+    std::filesystem::path base_path = "../tests/temp/";
+    int page_size = 64;
+    for (std::string name : {"clock", "lru-k", "2q", "arc"})
+    {
+        std::filesystem::remove(base_path / "data.bin");
+        StorageManager *storage_manager = new StorageManager(base_path, page_size);
+        BufferManager buffer_manager(storage_manager, 3, page_size, name);
+
+        for (uint64_t i = 1; i <= 20; i++)
+        {
+            BHeader *header = buffer_manager.create_new_page();
+            reinterpret_cast<uint64_t *>(header + 1)[0] = i * 7;
+            buffer_manager.unfix_page(header->page_id, true);
+        }
+        for (uint64_t i = 0; i < 100; i++)
+        {
+            uint64_t page_id = (i * 13) % 20 + 1;
+            BHeader *header = buffer_manager.request_page(page_id);
+            ASSERT_EQ(header->page_id, page_id) << name;
+            ASSERT_EQ(reinterpret_cast<uint64_t *>(header + 1)[0], page_id * 7) << name;
+            buffer_manager.unfix_page(page_id, false);
+        }
+        ASSERT_EQ(buffer_manager.get_current_buffer_size(), 3);
+
+        buffer_manager.destroy();
+        storage_manager->destroy();
+        delete storage_manager;
+    }
+}
@@ -2,6 +2,9 @@
 #include "../src/data/storage_manager.h"
 #include "../src/configuration.h"
 #include "../src/utils/file.h"
+#include <cstring>
+#include <unistd.h>
+#include <random>
 
 class StorageManagerTest : public ::testing::Test
 {
@@ -20,7 +23,7 @@ protected:
         storage_manager = new StorageManager(base_path, page_size);
     }
 
-    boost::dynamic_bitset<> get_free_space_map()
+    const FreeSpaceMap &get_free_space_map()
     {
         return storage_manager->free_space_map;
     }
@@ -32,12 +35,12 @@ protected:
 
     int get_next_free_space()
     {
-        return storage_manager->next_free_space;
+        return storage_manager->free_space_map.find_first();
     }
 
-    std::fstream *get_data_fs()
+    int get_data_fd()
     {
-        return &storage_manager->data_fs;
+        return storage_manager->data_fds[0];
     }
 };
 
@@ -320,4 +323,415 @@ TEST_F(StorageManagerTest, DeleteOutOfBitmapSize)
 
     storage_manager->delete_page(2);
     ASSERT_EQ(storage_manager->get_unused_page_id(), 2);
-}
\ No newline at end of file
+}
+
+TEST_F(StorageManagerTest, SparseFileHasHoles)
+{
+    BHeader *header = (BHeader *)malloc(page_size);
+    header->page_id = 4;
+    storage_manager->save_page(header);
+
+    // the file ends after the page, the pages in between are not written
+    ASSERT_EQ(std::filesystem::file_size(base_path / data), 5 * page_size);
+    ASSERT_EQ(get_current_page_count(), 5);
+    ASSERT_GE(get_data_fd(), 0);
+    free(header);
+}
+
+TEST_F(StorageManagerTest, UnusedExtent)
+{
+    BHeader *header = (BHeader *)malloc(page_size);
+    for (int i = 1; i <= 10; i++)
+    {
+        header->page_id = i;
+        storage_manager->save_page(header);
+    }
+    storage_manager->delete_page(2);
+    storage_manager->delete_page(5);
+    storage_manager->delete_page(6);
+    storage_manager->delete_page(7);
+
+    // the gap at 2 is too small, the run from 5 to 7 fits
+    ASSERT_EQ(storage_manager->get_unused_extent(3), 5);
+    ASSERT_EQ(storage_manager->get_unused_extent(2), 11);
+    ASSERT_EQ(storage_manager->get_unused_page_id(), 2);
+    ASSERT_EQ(storage_manager->get_unused_page_id(), 13);
+    free(header);
+}
+
+TEST_F(StorageManagerTest, DirectIO)
+{
+    storage_manager->destroy();
+    delete storage_manager;
+
+    // page sizes that are not a multiple of the block size fall back to the page cache
+    storage_manager = new StorageManager(base_path, page_size, true);
+    ASSERT_FALSE(storage_manager->is_direct_io());
+    storage_manager->destroy();
+    delete storage_manager;
+
+    int direct_page_size = 4096;
+    storage_manager = new StorageManager(base_path, direct_page_size, true);
+
+    // one aligned page and one that is shifted like the pages in the frames of the buffer manager
+    char *aligned = static_cast<char *>(std::aligned_alloc(4096, direct_page_size));
+    char *shifted = static_cast<char *>(std::aligned_alloc(4096, 2 * direct_page_size));
+    char *unaligned = shifted + 64;
+    for (int i = 0; i < direct_page_size; i++)
+    {
+        aligned[i] = i % 7;
+    }
+    reinterpret_cast<BHeader *>(aligned)->page_id = 1;
+    storage_manager->save_page(reinterpret_cast<BHeader *>(aligned));
+    std::memcpy(unaligned, aligned, direct_page_size);
+    reinterpret_cast<BHeader *>(unaligned)->page_id = 2;
+    storage_manager->save_page(reinterpret_cast<BHeader *>(unaligned));
+
+    char *loaded = static_cast<char *>(std::aligned_alloc(4096, 2 * direct_page_size));
+    storage_manager->load_page(reinterpret_cast<BHeader *>(loaded + 64), 1);
+    ASSERT_EQ(reinterpret_cast<BHeader *>(loaded + 64)->page_id, 1);
+    storage_manager->load_page(reinterpret_cast<BHeader *>(loaded), 2);
+    ASSERT_EQ(reinterpret_cast<BHeader *>(loaded)->page_id, 2);
+    ASSERT_EQ(std::memcmp(loaded + sizeof(BHeader), aligned + sizeof(BHeader), direct_page_size - sizeof(BHeader)), 0);
+
+    free(aligned);
+    free(shifted);
+    free(loaded);
+}
+
+TEST_F(StorageManagerTest, SaveAndLoadPages)
+{
+    std::vector<BHeader *> headers;
+    for (int i = 1; i <= 10; i++)
+    {
+        BHeader *header = (BHeader *)malloc(page_size);
+        header->page_id = i;
+        ((char *)header)[page_size - 1] = i;
+        headers.push_back(header);
+    }
+    storage_manager->save_pages(headers);
+    ASSERT_EQ(get_current_page_count(), 11);
+    ASSERT_EQ(get_next_free_space(), 11);
+
+    std::vector<BHeader *> loaded_headers;
+    std::vector<uint64_t> page_ids;
+    for (int i = 10; i >= 1; i--)
+    {
+        loaded_headers.push_back((BHeader *)malloc(page_size));
+        page_ids.push_back(i);
+    }
+    storage_manager->load_pages(loaded_headers, page_ids);
+    for (int i = 0; i < 10; i++)
+    {
+        ASSERT_EQ(loaded_headers[i]->page_id, page_ids[i]);
+        ASSERT_EQ(((char *)loaded_headers[i])[page_size - 1], (char)page_ids[i]);
+        free(headers[i]);
+        free(loaded_headers[i]);
+    }
+}
+
+TEST_F(StorageManagerTest, TornPageIsDetected)
+{
+    BHeader *header = (BHeader *)malloc(page_size);
+    std::memset(header, 0, page_size);
+    for (int i = 1; i <= 2; i++)
+    {
+        header->page_id = i;
+        ((char *)header)[page_size - 1] = i;
+        storage_manager->save_page(header);
+    }
+
+    // only the first half of a newer version of page 2 reaches the disc, the rest is left from the old one
+    ((char *)header)[page_size - 1] = 3;
+    ((char *)header)[page_size / 2 - 1] = 3;
+    PageChecksum::seal(header, page_size);
+    ASSERT_EQ(pwrite(get_data_fd(), header, page_size / 2, 2 * page_size), page_size / 2);
+
+    BHeader *loaded_header = (BHeader *)malloc(page_size);
+    storage_manager->load_page(loaded_header, 1);
+    ASSERT_EQ(((char *)loaded_header)[page_size - 1], 1);
+    ASSERT_EXIT(storage_manager->load_page(loaded_header, 2), ::testing::ExitedWithCode(1), "");
+
+    // page 3 is a hole that was never written, it reads as zeros and is accepted
+    header->page_id = 4;
+    storage_manager->save_page(header);
+    std::vector<BHeader *> headers{loaded_header};
+    storage_manager->load_pages(headers, {3});
+    ASSERT_EQ(loaded_header->page_id, 0);
+    free(header);
+    free(loaded_header);
+}
+
+TEST_F(StorageManagerTest, IoUring)
+{
+    storage_manager->destroy();
+    delete storage_manager;
+    storage_manager = new StorageManager(base_path, page_size, false, true);
+    if (!storage_manager->is_io_uring())
+        GTEST_SKIP() << "io_uring is not available";
+
+    // more pages than fit into the ring at once
+    int page_count = 150;
+    std::vector<char> pages(page_count * page_size);
+    std::vector<BHeader *> headers;
+    for (int i = 0; i < page_count; i++)
+    {
+        BHeader *header = reinterpret_cast<BHeader *>(pages.data() + i * page_size);
+        header->page_id = i + 1;
+        pages[i * page_size + page_size - 1] = i % 100;
+        headers.push_back(header);
+    }
+    storage_manager->save_pages(headers);
+    ASSERT_EQ(std::filesystem::file_size(base_path / data), (page_count + 1) * page_size);
+
+    std::vector<char> loaded(page_count * page_size);
+    std::vector<BHeader *> loaded_headers;
+    std::vector<uint64_t> page_ids;
+    for (int i = 0; i < page_count; i++)
+    {
+        loaded_headers.push_back(reinterpret_cast<BHeader *>(loaded.data() + i * page_size));
+        page_ids.push_back(i + 1);
+    }
+    storage_manager->load_pages(loaded_headers, page_ids);
+    ASSERT_EQ(loaded, pages);
+
+    // single pages go through the ring as well
+    BHeader *header = (BHeader *)malloc(page_size);
+    storage_manager->load_page(header, 42);
+    ASSERT_EQ(header->page_id, 42);
+    header->page_id = page_count + 1;
+    storage_manager->save_page(header);
+    storage_manager->load_page(header, page_count + 1);
+    ASSERT_EQ(header->page_id, page_count + 1);
+    free(header);
+}
+
+TEST_F(StorageManagerTest, MemoryMapped)
+{
+    storage_manager->destroy();
+    delete storage_manager;
+    storage_manager = new StorageManager(base_path, page_size, true, false, true);
+    ASSERT_TRUE(storage_manager->is_mmap());
+    ASSERT_FALSE(storage_manager->is_direct_io());
+
+    BHeader *header = (BHeader *)malloc(page_size);
+    BHeader *loaded_header = (BHeader *)malloc(page_size);
+    header->page_id = 1;
+    ((char *)header)[page_size - 1] = 1;
+    storage_manager->save_page(header);
+    storage_manager->load_page(loaded_header, 1);
+    ASSERT_EQ(loaded_header->page_id, 1);
+    ASSERT_EQ(((char *)loaded_header)[page_size - 1], 1);
+
+    // pages written after the file was mapped are visible, the mapping grows with the file
+    storage_manager->advise_access(true);
+    for (int i = 2; i < 1000; i++)
+    {
+        header->page_id = i;
+        ((char *)header)[page_size - 1] = i % 100;
+        storage_manager->save_page(header);
+    }
+    header->page_id = 1;
+    ((char *)header)[page_size - 1] = 2;
+    storage_manager->save_page(header);
+
+    std::vector<BHeader *> loaded_headers = {loaded_header, (BHeader *)malloc(page_size)};
+    storage_manager->load_pages(loaded_headers, {1, 999});
+    ASSERT_EQ(loaded_headers[0]->page_id, 1);
+    ASSERT_EQ(((char *)loaded_headers[0])[page_size - 1], 2);
+    ASSERT_EQ(loaded_headers[1]->page_id, 999);
+    ASSERT_EQ(((char *)loaded_headers[1])[page_size - 1], 99);
+
+    free(header);
+    free(loaded_headers[0]);
+    free(loaded_headers[1]);
+}
+
+TEST_F(StorageManagerTest, PersistentReopen)
+{
+    storage_manager->destroy();
+    delete storage_manager;
+    storage_manager = new StorageManager(base_path, page_size, false, false, false, true);
+    ASSERT_FALSE(storage_manager->is_reopened());
+
+    // enough pages that the free space map spans several pages
+    BHeader *header = (BHeader *)malloc(page_size);
+    for (int i = 1; i <= 600; i++)
+    {
+        header->page_id = storage_manager->get_unused_page_id();
+        ((char *)header)[page_size - 1] = i % 100;
+        storage_manager->save_page(header);
+    }
+    storage_manager->delete_page(7);
+    storage_manager->set_root_id(42);
+    storage_manager->set_record_count(1000);
+    storage_manager->destroy();
+    delete storage_manager;
+
+    storage_manager = new StorageManager(base_path, page_size, false, false, false, true);
+    ASSERT_TRUE(storage_manager->is_reopened());
+    ASSERT_EQ(storage_manager->get_root_id(), 42);
+    ASSERT_EQ(storage_manager->get_record_count(), 1000);
+    ASSERT_EQ(get_current_page_count(), 601);
+    ASSERT_EQ(std::filesystem::file_size(base_path / data), 601 * page_size);
+    ASSERT_FALSE(get_free_space_map()[0]);
+    ASSERT_TRUE(get_free_space_map()[7]);
+    ASSERT_FALSE(get_free_space_map()[600]);
+    ASSERT_EQ(storage_manager->get_unused_page_id(), 7);
+    ASSERT_EQ(storage_manager->get_unused_page_id(), 601);
+
+    storage_manager->load_page(header, 599);
+    ASSERT_EQ(header->page_id, 599);
+    ASSERT_EQ(((char *)header)[page_size - 1], 99);
+    free(header);
+
+    storage_manager->destroy();
+    delete storage_manager;
+    std::filesystem::remove(base_path / data);
+    storage_manager = new StorageManager(base_path, page_size);
+}
+
+TEST_F(StorageManagerTest, StripedDataFiles)
+{
+    storage_manager->destroy();
+    delete storage_manager;
+    // the second stripe gets its own folder, the third one is placed in the base path
+    std::vector<std::filesystem::path> stripe_paths{base_path, base_path / "stripe"};
+    std::vector<std::filesystem::path> data_paths{base_path / data, base_path / "stripe" / "data.1.bin", base_path / "data.2.bin"};
+    storage_manager = new StorageManager(base_path, page_size, false, false, false, true, false, false, 3, stripe_paths);
+    ASSERT_EQ(storage_manager->get_stripe_count(), 3);
+
+    std::vector<BHeader *> headers;
+    for (int i = 1; i <= 100; i++)
+    {
+        BHeader *header = (BHeader *)malloc(page_size);
+        header->page_id = storage_manager->get_unused_page_id();
+        ((char *)header)[page_size - 1] = i;
+        headers.push_back(header);
+    }
+    storage_manager->save_pages(headers);
+    storage_manager->save_page(headers[49]);
+    ASSERT_EQ(get_current_page_count(), 101);
+    // page i lies in stripe i % 3, so the files grow one page after another
+    ASSERT_EQ(std::filesystem::file_size(data_paths[0]), 34 * page_size);
+    ASSERT_EQ(std::filesystem::file_size(data_paths[1]), 34 * page_size);
+    ASSERT_EQ(std::filesystem::file_size(data_paths[2]), 33 * page_size);
+    storage_manager->set_root_id(42);
+    storage_manager->destroy();
+    delete storage_manager;
+
+    storage_manager = new StorageManager(base_path, page_size, false, false, false, true, false, false, 3, stripe_paths);
+    ASSERT_TRUE(storage_manager->is_reopened());
+    ASSERT_EQ(storage_manager->get_root_id(), 42);
+    ASSERT_EQ(get_current_page_count(), 101);
+    std::vector<BHeader *> loaded_headers;
+    std::vector<uint64_t> page_ids;
+    for (int i = 100; i >= 1; i--)
+    {
+        loaded_headers.push_back((BHeader *)malloc(page_size));
+        page_ids.push_back(i);
+    }
+    storage_manager->load_pages(loaded_headers, page_ids);
+    for (int i = 0; i < 100; i++)
+    {
+        ASSERT_EQ(loaded_headers[i]->page_id, page_ids[i]);
+        ASSERT_EQ(((char *)loaded_headers[i])[page_size - 1], (char)page_ids[i]);
+        free(headers[i]);
+        free(loaded_headers[i]);
+    }
+    storage_manager->destroy();
+    delete storage_manager;
+
+    // compressed pages are stored in slots that can cross from one data file into the next
+    int compressed_page_size = 4096;
+    for (const std::filesystem::path &path : data_paths)
+    {
+        std::filesystem::remove(path);
+    }
+    storage_manager = new StorageManager(base_path, compressed_page_size, false, false, false, false, false, true, 3, stripe_paths);
+    std::vector<uint64_t> words(compressed_page_size / 8);
+    BHeader *header = reinterpret_cast<BHeader *>(words.data());
+    std::vector<std::vector<uint64_t>> saved_words;
+    std::mt19937_64 random(42);
+    for (uint64_t page_id = 1; page_id <= 20; page_id++)
+    {
+        // every other page does not shrink and takes a whole page of slots
+        for (uint64_t i = 2; i < words.size(); i++)
+        {
+            words[i] = page_id % 2 == 0 ? random() : (i < 100 ? page_id * 1000 + i : 0);
+        }
+        header->page_id = storage_manager->get_unused_page_id();
+        storage_manager->save_page(header);
+        saved_words.push_back(words);
+    }
+    std::vector<uint64_t> loaded_words(words.size());
+    for (uint64_t page_id = 1; page_id <= 20; page_id++)
+    {
+        storage_manager->load_page(reinterpret_cast<BHeader *>(loaded_words.data()), page_id);
+        ASSERT_EQ(loaded_words, saved_words[page_id - 1]);
+    }
+
+    storage_manager->destroy();
+    delete storage_manager;
+    for (const std::filesystem::path &path : data_paths)
+    {
+        std::filesystem::remove(path);
+    }
+    std::filesystem::remove(base_path / "stripe");
+    storage_manager = new StorageManager(base_path, page_size);
+}
+
+TEST_F(StorageManagerTest, CompressedPages)
+{
+    storage_manager->destroy();
+    delete storage_manager;
+    int compressed_page_size = 4096;
+    storage_manager = new StorageManager(base_path, compressed_page_size, false, false, false, true, false, true);
+    ASSERT_TRUE(storage_manager->is_compressed());
+
+    // the first half of a page holds sorted keys, the rest is empty like in a leaf that is half full
+    std::vector<uint64_t> words(compressed_page_size / 8, 0);
+    BHeader *header = reinterpret_cast<BHeader *>(words.data());
+    for (uint64_t page_id = 1; page_id <= 100; page_id++)
+    {
+        std::fill(words.begin(), words.end(), 0);
+        header->page_id = storage_manager->get_unused_page_id();
+        for (uint64_t i = 2; i < words.size() / 2; i++)
+        {
+            words[i] = page_id * 10000 + i * 3;
+        }
+        storage_manager->save_page(header);
+    }
+    ASSERT_LT(get_current_page_count(), 20);
+
+    // a page that does not shrink is stored as it is and takes more slots than before
+    std::mt19937_64 random(42);
+    for (uint64_t i = 2; i < words.size(); i++)
+    {
+        words[i] = random();
+    }
+    header->page_id = 5;
+    storage_manager->save_page(header);
+    std::vector<uint64_t> random_words = words;
+    storage_manager->delete_page(7);
+    storage_manager->destroy();
+    delete storage_manager;
+
+    storage_manager = new StorageManager(base_path, compressed_page_size, false, false, false, true, false, true);
+    ASSERT_TRUE(storage_manager->is_reopened());
+    ASSERT_FALSE(storage_manager->has_page(7));
+    std::vector<uint64_t> loaded_words(words.size());
+    BHeader *loaded_header = reinterpret_cast<BHeader *>(loaded_words.data());
+    storage_manager->load_page(loaded_header, 5);
+    ASSERT_EQ(loaded_words, random_words);
+    storage_manager->load_page(loaded_header, 100);
+    ASSERT_EQ(loaded_header->page_id, 100);
+    ASSERT_EQ(loaded_words[2], 100 * 10000 + 6);
+    ASSERT_EQ(loaded_words[words.size() / 2 - 1], 100 * 10000 + (words.size() / 2 - 1) * 3);
+    ASSERT_EQ(loaded_words[words.size() / 2], 0);
+
+    storage_manager->destroy();
+    delete storage_manager;
+    std::filesystem::remove(base_path / data);
+    storage_manager = new StorageManager(base_path, page_size);
+}
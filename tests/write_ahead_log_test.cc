@@ -0,0 +1,244 @@
+#include "gtest/gtest.h"
+#include "../src/data/write_ahead_log.h"
+#include <cstring>
+
+class WriteAheadLogTest : public ::testing::Test
+{
+protected:
+    std::filesystem::path base_path = "../tests/temp/";
+    std::filesystem::path path = "../tests/temp/wal.log";
+    std::string data = "data.bin";
+    int page_size = 64;
+    std::shared_ptr<spdlog::logger> logger = spdlog::get("logger");
+
+    void SetUp() override
+    {
+        std::filesystem::remove(base_path / data);
+        std::filesystem::remove(path);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove(base_path / data);
+        std::filesystem::remove(path);
+    }
+
+    uint64_t get_pending_size(WriteAheadLog &write_ahead_log)
+    {
+        std::lock_guard<std::mutex> guard(write_ahead_log.log_mutex);
+        return write_ahead_log.pending_records.size();
+    }
+};
+
+TEST_F(WriteAheadLogTest, SynchronousCommit)
+{
+    WriteAheadLog write_ahead_log(path, page_size, 0);
+    std::vector<char> page(page_size, 0);
+    std::vector<char> before_image(page);
+    BHeader *header = reinterpret_cast<BHeader *>(page.data());
+    header->page_id = 3;
+
+    uint64_t lsn = write_ahead_log.append_update(header, before_image.data());
+    ASSERT_GT(lsn, 0);
+    ASSERT_EQ(header->get_lsn(), lsn);
+    // the before image follows the page, so a second call finds no change
+    ASSERT_EQ(write_ahead_log.append_update(header, before_image.data()), 0);
+
+    page[page_size - 1] = 5;
+    uint64_t second_lsn = write_ahead_log.append_update(header, before_image.data());
+    ASSERT_GT(second_lsn, lsn);
+    ASSERT_EQ(write_ahead_log.get_durable_lsn(), lsn);
+
+    write_ahead_log.end_operation();
+    ASSERT_GT(write_ahead_log.get_durable_lsn(), second_lsn);
+    ASSERT_EQ(write_ahead_log.get_commit_count(), 1);
+    ASSERT_EQ(write_ahead_log.get_committed_record_count(), 3);
+
+    write_ahead_log.destroy();
+    ASSERT_EQ(std::filesystem::file_size(path), 4096);
+}
+
+TEST_F(WriteAheadLogTest, GroupCommit)
+{
+    // with a long interval the records stay pending until a thread waits for them
+    WriteAheadLog write_ahead_log(path, page_size, 10000000);
+
+    uint64_t lsn = 0;
+    for (uint64_t i = 1; i <= 100; i++)
+    {
+        lsn = write_ahead_log.append_allocate(i);
+        write_ahead_log.end_operation();
+    }
+    ASSERT_EQ(write_ahead_log.get_commit_count(), 0);
+    ASSERT_EQ(get_pending_size(write_ahead_log), 200 * sizeof(WriteAheadLog::LogRecord));
+
+    write_ahead_log.wait_durable(lsn);
+    ASSERT_GT(write_ahead_log.get_durable_lsn(), lsn);
+    ASSERT_EQ(write_ahead_log.get_commit_count(), 1);
+    ASSERT_EQ(write_ahead_log.get_committed_record_count(), 200);
+
+    write_ahead_log.append_allocate(101);
+    write_ahead_log.destroy();
+    ASSERT_EQ(write_ahead_log.get_committed_record_count(), 201);
+}
+
+TEST_F(WriteAheadLogTest, Checkpoint)
+{
+    StorageManager storage_manager(base_path, page_size, false, false, false, true, true);
+    {
+        WriteAheadLog write_ahead_log(path, page_size, 0, true);
+        ASSERT_FALSE(write_ahead_log.recover(&storage_manager));
+        write_ahead_log.write_checkpoint(write_ahead_log.get_end_lsn(), storage_manager.get_state());
+        ASSERT_GT(write_ahead_log.get_checkpoint_lsn(), 0);
+    }
+
+    // the checkpoint is found again after a crash and removed by a clean shutdown
+    WriteAheadLog write_ahead_log(path, page_size, 0, true);
+    ASSERT_GT(write_ahead_log.get_checkpoint_lsn(), 0);
+    write_ahead_log.destroy();
+
+    WriteAheadLog empty_write_ahead_log(path, page_size, 0, true);
+    ASSERT_EQ(empty_write_ahead_log.get_checkpoint_lsn(), 0);
+    ASSERT_FALSE(empty_write_ahead_log.recover(&storage_manager));
+    empty_write_ahead_log.destroy();
+    storage_manager.destroy();
+}
+
+TEST_F(WriteAheadLogTest, Recovery)
+{
+    std::vector<char> page(page_size, 0);
+    std::vector<char> before_image(page_size, 0);
+    BHeader *header = reinterpret_cast<BHeader *>(page.data());
+    uint64_t page_id;
+    {
+        StorageManager storage_manager(base_path, page_size, false, false, false, true, true);
+        WriteAheadLog write_ahead_log(path, page_size, 0, true);
+        write_ahead_log.write_checkpoint(write_ahead_log.get_end_lsn(), storage_manager.get_state());
+
+        // a complete operation creates the page and the root
+        page_id = storage_manager.get_unused_page_id();
+        header->set_lsn(write_ahead_log.append_allocate(page_id));
+        header->page_id = page_id;
+        std::memcpy(before_image.data(), page.data(), page_size);
+        page[page_size - 8] = 1;
+        write_ahead_log.append_update(header, before_image.data());
+        write_ahead_log.append_root(0, page_id);
+        write_ahead_log.end_operation();
+
+        // the next operation is cut off by the crash after its change reached the data file
+        page[page_size - 8] = 2;
+        page[page_size - 1] = 3;
+        write_ahead_log.wait_durable(write_ahead_log.append_update(header, before_image.data()));
+        storage_manager.save_page(header);
+    }
+
+    StorageManager storage_manager(base_path, page_size, false, false, false, true, true);
+    ASSERT_TRUE(storage_manager.is_recovery_needed());
+    WriteAheadLog write_ahead_log(path, page_size, 0, true);
+    ASSERT_TRUE(write_ahead_log.recover(&storage_manager));
+    ASSERT_FALSE(storage_manager.is_recovery_needed());
+    ASSERT_EQ(storage_manager.get_root_id(), page_id);
+    ASSERT_EQ(write_ahead_log.get_undone_count(), 1);
+
+    std::vector<char> recovered_page(page_size);
+    storage_manager.load_page(reinterpret_cast<BHeader *>(recovered_page.data()), page_id);
+    ASSERT_EQ(recovered_page[page_size - 8], 1);
+    ASSERT_EQ(recovered_page[page_size - 1], 0);
+
+    // the records appended after the recovery follow the ones that were read
+    ASSERT_GE(write_ahead_log.get_end_lsn(), write_ahead_log.get_checkpoint_lsn());
+    write_ahead_log.destroy();
+    storage_manager.destroy();
+}
+
+TEST_F(WriteAheadLogTest, FreedPageRecovery)
+{
+    std::vector<char> first_page(page_size, 0);
+    std::vector<char> second_page(page_size, 0);
+    std::vector<char> before_image(page_size, 0);
+    uint64_t first_page_id;
+    uint64_t second_page_id;
+    {
+        StorageManager storage_manager(base_path, page_size, false, false, false, true, true);
+        WriteAheadLog write_ahead_log(path, page_size, 0, true);
+        write_ahead_log.write_checkpoint(write_ahead_log.get_end_lsn(), storage_manager.get_state());
+
+        // both pages are created with some content
+        for (std::vector<char> *page : {&first_page, &second_page})
+        {
+            BHeader *header = reinterpret_cast<BHeader *>(page->data());
+            header->page_id = storage_manager.get_unused_page_id();
+            header->set_lsn(write_ahead_log.append_allocate(header->page_id));
+            std::memcpy(before_image.data(), page->data(), page_size);
+            (*page)[page_size - 1] = 7;
+            write_ahead_log.append_update(header, before_image.data());
+        }
+        write_ahead_log.end_operation();
+        first_page_id = reinterpret_cast<BHeader *>(first_page.data())->page_id;
+        second_page_id = reinterpret_cast<BHeader *>(second_page.data())->page_id;
+
+        // the first page is freed by a complete operation, the second one by the operation cut off by the crash
+        write_ahead_log.append_free(first_page_id, first_page.data());
+        storage_manager.delete_page(first_page_id);
+        write_ahead_log.end_operation();
+        write_ahead_log.wait_durable(write_ahead_log.append_free(second_page_id, second_page.data()));
+        storage_manager.delete_page(second_page_id);
+    }
+
+    StorageManager storage_manager(base_path, page_size, false, false, false, true, true);
+    WriteAheadLog write_ahead_log(path, page_size, 0, true);
+    ASSERT_TRUE(write_ahead_log.recover(&storage_manager));
+    ASSERT_EQ(write_ahead_log.get_undone_count(), 1);
+    ASSERT_EQ(storage_manager.peek_unused_page_id(), first_page_id);
+
+    std::vector<char> recovered_page(page_size);
+    storage_manager.load_page(reinterpret_cast<BHeader *>(recovered_page.data()), second_page_id);
+    ASSERT_EQ(recovered_page[page_size - 1], 7);
+    write_ahead_log.destroy();
+    storage_manager.destroy();
+}
+
+TEST_F(WriteAheadLogTest, CompressedRecovery)
+{
+    std::vector<char> page(page_size, 0);
+    std::vector<char> before_image(page_size, 0);
+    BHeader *header = reinterpret_cast<BHeader *>(page.data());
+    uint64_t page_id;
+    {
+        StorageManager storage_manager(base_path, page_size, false, false, false, true, true, true);
+        WriteAheadLog write_ahead_log(path, page_size, 0, true);
+        page_id = storage_manager.get_unused_page_id();
+        header->set_lsn(write_ahead_log.append_allocate(page_id));
+        header->page_id = page_id;
+        std::memcpy(before_image.data(), page.data(), page_size);
+        page[page_size - 8] = 1;
+        write_ahead_log.append_update(header, before_image.data());
+        write_ahead_log.append_root(0, page_id);
+        write_ahead_log.end_operation();
+        storage_manager.save_page(header);
+        storage_manager.set_root_id(page_id);
+        write_ahead_log.write_checkpoint(write_ahead_log.get_end_lsn(), storage_manager.get_state());
+
+        // the page is written to new slots after the checkpoint, the old ones stay as the checkpoint points to them
+        page[page_size - 8] = 2;
+        write_ahead_log.append_update(header, before_image.data());
+        write_ahead_log.end_operation();
+        storage_manager.save_page(header);
+        std::vector<char> other_page(page_size, 0);
+        BHeader *other_header = reinterpret_cast<BHeader *>(other_page.data());
+        other_header->page_id = storage_manager.get_unused_page_id();
+        storage_manager.save_page(other_header);
+    }
+
+    StorageManager storage_manager(base_path, page_size, false, false, false, true, true, true);
+    ASSERT_TRUE(storage_manager.is_recovery_needed());
+    WriteAheadLog write_ahead_log(path, page_size, 0, true);
+    ASSERT_TRUE(write_ahead_log.recover(&storage_manager));
+    ASSERT_EQ(storage_manager.get_root_id(), page_id);
+
+    std::vector<char> recovered_page(page_size);
+    storage_manager.load_page(reinterpret_cast<BHeader *>(recovered_page.data()), page_id);
+    ASSERT_EQ(recovered_page[page_size - 8], 2);
+    write_ahead_log.destroy();
+    storage_manager.destroy();
+}